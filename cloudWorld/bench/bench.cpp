@@ -0,0 +1,412 @@
+// cloudWorld_bench: runs named scenarios offscreen along a scripted camera path and reports
+// frame time percentiles as JSON, or compares two of those reports for regressions.
+//
+//   cloudWorld_bench [--scenario a,b] [--frames N] [--warmup N] [--size WxH] [--seed N] [--out FILE]
+//   cloudWorld_bench --list
+//   cloudWorld_bench --compare BASELINE.json CURRENT.json [--tolerance 0.10]
+//
+// Like cloudWorld it loads assets from ../cloudWorld, so run it from the build directory.
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <json.hpp>
+
+#include "../include/headless.h"
+#include "../include/scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using nlohmann::json;
+
+struct Scenario {
+	std::string name;
+	SceneConfig config;
+};
+
+// Each sweep changes one parameter of the default scene
+static std::vector<Scenario> buildScenarios() {
+	std::vector<Scenario> list;
+	SceneConfig base;
+	list.push_back({"default", base});
+
+	// planet count, the minimum separation shrinks so the larger fields actually fit in the world cube
+	const struct { int count; float minDistance; } planetSweep[] = {{100, 20.0f}, {500, 6.0f}, {2000, 1.0f}};
+	for (const auto& sweep : planetSweep) {
+		SceneConfig c = base;
+		c.numPlanets = sweep.count;
+		c.minPlanetDistance = sweep.minDistance;
+		list.push_back({"planets_" + std::to_string(sweep.count), c});
+	}
+
+	// frustum culling off, every planet goes through the camera pass (2000 planets so it shows)
+	{
+		SceneConfig c = base;
+		c.numPlanets = 2000;
+		c.minPlanetDistance = 1.0f;
+		c.frustumCulling = false;
+		list.push_back({"no_culling", c});
+	}
+
+	// levels of detail off, every planet is the full UV sphere (2000 planets so it shows)
+	{
+		SceneConfig c = base;
+		c.numPlanets = 2000;
+		c.minPlanetDistance = 1.0f;
+		c.planetLods = false;
+		list.push_back({"no_lod", c});
+	}
+
+	// UV sphere tessellation passed to createSphere (without the levels of detail)
+	for (int tess : {16, 32, 128}) {
+		SceneConfig c = base;
+		c.planetLods = false;
+		c.sphereStacks = tess;
+		c.sphereSlices = tess;
+		list.push_back({"tess_" + std::to_string(tess), c});
+	}
+
+	// shadow map resolution per cascade
+	for (int size : {512, 2048}) {
+		SceneConfig c = base;
+		c.shadowMapSize = size;
+		list.push_back({"shadow_" + std::to_string(size), c});
+	}
+
+	// shadow cascades
+	for (int cascades : {1, 2}) {
+		SceneConfig c = base;
+		c.shadowCascades = cascades;
+		list.push_back({"cascades_" + std::to_string(cascades), c});
+	}
+
+	// planets redrawn into every cascade every frame instead of the cached static shadow maps
+	{
+		SceneConfig c = base;
+		c.shadowCaching = false;
+		list.push_back({"no_shadow_cache", c});
+	}
+
+	// animated humanoids
+	for (int bots : {10, 50}) {
+		SceneConfig c = base;
+		c.numBots = bots;
+		list.push_back({"bots_" + std::to_string(bots), c});
+	}
+
+	// same crowd animated on the CPU every frame instead of the baked joint palette
+	{
+		SceneConfig c = base;
+		c.numBots = 50;
+		c.animationBakeRate = 0.0f;
+		list.push_back({"bots_50_cpu", c});
+	}
+
+	// same crowd skinned again in every pass instead of once by the transform feedback pre-pass
+	{
+		SceneConfig c = base;
+		c.numBots = 50;
+		c.skinningPrePass = false;
+		list.push_back({"bots_50_no_prepass", c});
+	}
+
+	// walkers on every planet, all of them instances of the one bot
+	{
+		SceneConfig c = base;
+		c.walkersPerPlanet = 24;
+		list.push_back({"crowd", c});
+		c.animationBakeRate = 0.0f;
+		list.push_back({"crowd_cpu", c});
+	}
+
+	// same CPU animated crowd streamed with glMapBufferRange and orphaning instead of persistent mapping
+	{
+		SceneConfig c = base;
+		c.walkersPerPlanet = 24;
+		c.animationBakeRate = 0.0f;
+		c.persistentMapping = false;
+		list.push_back({"crowd_cpu_no_persistent", c});
+	}
+	return list;
+}
+
+// Scripted fly-through: one orbit around the field center per run, bobbing up and down
+// and always looking at the center. Only depends on the frame number so every run sees the same views
+static void placeCameraOnPath(int frame, int frameCount) {
+	float t = float(frame) / float(std::max(frameCount, 1));
+	float angle = t * glm::two_pi<float>();
+	glm::vec3 eye(std::cos(angle) * 60.0f, std::sin(angle * 2.0f) * 20.0f, std::sin(angle) * 60.0f);
+
+	glm::vec3 dir = glm::normalize(-eye);
+	float yaw = std::atan2(dir.x, -dir.z);
+	float pitch = std::asin(dir.y);
+	setCamera(eye, yaw, pitch);
+}
+
+// nearest-rank percentile of an already sorted list
+static double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0.0;
+	size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+	rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+	return sorted[rank - 1];
+}
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static json runScenario(const Scenario& scenario, int frames, int warmup, unsigned int seed) {
+	sceneConfig = scenario.config;
+	std::srand(seed);	// same planet field for the scenario on every run
+	placeCameraOnPath(0, warmup + frames);	// placement wraps around the camera, start from the same spot
+
+	auto initStart = std::chrono::steady_clock::now();
+	init();
+	double initMs = msSince(initStart);
+	auto assetsStart = std::chrono::steady_clock::now();
+	waitForAssets();
+	double assetsMs = msSince(assetsStart);
+
+	const float dt = 1.0f / 60.0f;
+	std::vector<double> frameMs;
+	frameMs.reserve(frames);
+
+	for (int frame = 0; frame < warmup + frames; ++frame) {
+		auto start = std::chrono::steady_clock::now();
+		updateScene(dt);
+		placeCameraOnPath(frame, warmup + frames);
+		drawFrame();
+		// wait for the GPU, otherwise we only time command submission
+		glFinish();
+		if (frame >= warmup)
+			frameMs.push_back(msSince(start));
+	}
+
+	size_t planetCount = placedPlanetCount();
+	size_t visibleCount = visiblePlanetCount();	// from the last frame of the path
+	size_t shadowRedraws = shadowCacheRedraws();
+	size_t triangleCount = planetTriangleCount();
+	size_t drawItems = drawItemCount();
+	size_t stateChanges = stateChangeCount();
+	cleanup();
+
+	double total = 0.0;
+	for (double ms : frameMs) total += ms;
+	std::vector<double> sorted = frameMs;
+	std::sort(sorted.begin(), sorted.end());
+
+	json result;
+	result["name"] = scenario.name;
+	result["config"] = {
+		{"planets", scenario.config.numPlanets},
+		{"min_planet_distance", scenario.config.minPlanetDistance},
+		{"planet_lods", scenario.config.planetLods},
+		{"sphere_stacks", scenario.config.sphereStacks},
+		{"sphere_slices", scenario.config.sphereSlices},
+		{"shadow_map_size", scenario.config.shadowMapSize},
+		{"shadow_cascades", scenario.config.shadowCascades},
+		{"bots", scenario.config.numBots},
+		{"walkers_per_planet", scenario.config.walkersPerPlanet},
+		{"animation_bake_rate", scenario.config.animationBakeRate},
+		{"skinning_prepass", scenario.config.skinningPrePass},
+		{"persistent_mapping", scenario.config.persistentMapping},
+		{"frustum_culling", scenario.config.frustumCulling},
+		{"shadow_caching", scenario.config.shadowCaching}
+	};
+	result["planets_placed"] = planetCount;
+	result["planets_visible"] = visibleCount;
+	result["shadow_redraws"] = shadowRedraws;
+	result["planet_triangles"] = triangleCount;
+	result["draw_items"] = drawItems;
+	result["state_changes"] = stateChanges;
+	result["init_ms"] = initMs;
+	result["assets_ms"] = assetsMs;
+	result["frame_ms"] = {
+		{"mean", sorted.empty() ? 0.0 : total / sorted.size()},
+		{"min", sorted.empty() ? 0.0 : sorted.front()},
+		{"p50", percentile(sorted, 50.0)},
+		{"p95", percentile(sorted, 95.0)},
+		{"p99", percentile(sorted, 99.0)},
+		{"max", sorted.empty() ? 0.0 : sorted.back()}
+	};
+
+	std::printf("%-14s planets %6zu (%6zu drawn)  init %8.1f ms  assets %8.1f ms  p50 %8.2f  p95 %8.2f  p99 %8.2f ms\n",
+				scenario.name.c_str(), planetCount, visibleCount, initMs, assetsMs,
+				percentile(sorted, 50.0), percentile(sorted, 95.0), percentile(sorted, 99.0));
+	std::fflush(stdout);
+	return result;
+}
+
+static bool loadJson(const std::string& path, json& out) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		std::cerr << "Cannot open " << path << std::endl;
+		return false;
+	}
+	try {
+		file >> out;
+	} catch (const std::exception& e) {
+		std::cerr << "Invalid JSON in " << path << ": " << e.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Returns 0 when no scenario got slower than baseline * (1 + tolerance), 1 otherwise
+static int compareReports(const std::string& baselinePath, const std::string& currentPath, double tolerance) {
+	json baseline, current;
+	if (!loadJson(baselinePath, baseline) || !loadJson(currentPath, current))
+		return -1;
+
+	int regressions = 0;
+	std::printf("%-14s %-4s %10s %10s %8s\n", "scenario", "", "baseline", "current", "change");
+	for (const json& cur : current["scenarios"]) {
+		const std::string name = cur["name"];
+		auto base = std::find_if(baseline["scenarios"].begin(), baseline["scenarios"].end(),
+								 [&](const json& b) { return b["name"] == name; });
+		if (base == baseline["scenarios"].end()) {
+			std::printf("%-14s not in baseline, skipped\n", name.c_str());
+			continue;
+		}
+		for (const char* metric : {"p50", "p95", "p99"}) {
+			double b = (*base)["frame_ms"][metric];
+			double c = cur["frame_ms"][metric];
+			double change = b > 0.0 ? c / b - 1.0 : 0.0;
+			bool regressed = change > tolerance;
+			if (regressed) regressions++;
+			std::printf("%-14s %-4s %10.2f %10.2f %+7.1f%%%s\n", name.c_str(), metric, b, c, change * 100.0,
+						regressed ? "  REGRESSION" : "");
+		}
+	}
+
+	if (regressions > 0) {
+		std::printf("%d metric(s) regressed by more than %.1f%%\n", regressions, tolerance * 100.0);
+		return 1;
+	}
+	std::printf("No regressions above %.1f%%\n", tolerance * 100.0);
+	return 0;
+}
+
+static void printUsage(const char* program) {
+	std::cout << "Usage: " << program << " [options]\n"
+			  << "  --list                    list scenarios\n"
+			  << "  --scenario a,b            run only these scenarios (default: all)\n"
+			  << "  --frames N                measured frames per scenario (default 300)\n"
+			  << "  --warmup N                frames skipped before measuring (default 30)\n"
+			  << "  --size WxH                framebuffer size (default 1280x720)\n"
+			  << "  --seed N                  planet field seed (default 1337)\n"
+			  << "  --out FILE                JSON report (default bench.json)\n"
+			  << "  --compare BASE CUR        compare two reports instead of running\n"
+			  << "  --tolerance X             allowed slowdown for --compare, 0.10 = 10% (default)\n";
+}
+
+int main(int argc, char** argv) {
+	std::vector<Scenario> scenarios = buildScenarios();
+	std::vector<std::string> selected;
+	int frames = 300;
+	int warmup = 30;
+	int width = 1280, height = 720;
+	unsigned int seed = 1337;
+	std::string outPath = "bench.json";
+	std::string comparePaths[2];
+	bool compare = false;
+	double tolerance = 0.10;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--list") {
+			for (const Scenario& s : scenarios) std::cout << s.name << std::endl;
+			return 0;
+		} else if (arg == "--scenario" && hasValue) {
+			std::stringstream ss(argv[++i]);
+			std::string item;
+			while (std::getline(ss, item, ',')) selected.push_back(item);
+		} else if (arg == "--frames" && hasValue) {
+			frames = std::atoi(argv[++i]);
+		} else if (arg == "--warmup" && hasValue) {
+			warmup = std::atoi(argv[++i]);
+		} else if (arg == "--size" && hasValue) {
+			if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+				printUsage(argv[0]);
+				return -1;
+			}
+		} else if (arg == "--seed" && hasValue) {
+			seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (arg == "--out" && hasValue) {
+			outPath = argv[++i];
+		} else if (arg == "--compare" && i + 2 < argc) {
+			compare = true;
+			comparePaths[0] = argv[++i];
+			comparePaths[1] = argv[++i];
+		} else if (arg == "--tolerance" && hasValue) {
+			tolerance = std::atof(argv[++i]);
+		} else {
+			printUsage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (compare) {
+		return compareReports(comparePaths[0], comparePaths[1], tolerance);
+	}
+
+	if (!selected.empty()) {
+		std::vector<Scenario> filtered;
+		for (const std::string& name : selected) {
+			auto it = std::find_if(scenarios.begin(), scenarios.end(), [&](const Scenario& s) { return s.name == name; });
+			if (it == scenarios.end()) {
+				std::cerr << "Unknown scenario " << name << " (see --list)" << std::endl;
+				return -1;
+			}
+			filtered.push_back(*it);
+		}
+		scenarios = filtered;
+	}
+
+	if (frames <= 0 || warmup < 0) {
+		printUsage(argv[0]);
+		return -1;
+	}
+
+	HeadlessContext ctx;
+	if (!createHeadlessContext(ctx, width, height)) {
+		return -1;
+	}
+	setRenderTarget(ctx.framebuffer, ctx.width, ctx.height);
+	glEnable(GL_DEPTH_TEST);
+
+	json report;
+	report["renderer"] = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	report["gl_version"] = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	report["frames"] = frames;
+	report["warmup"] = warmup;
+	report["size"] = {width, height};
+	report["seed"] = seed;
+	report["scenarios"] = json::array();
+
+	for (const Scenario& scenario : scenarios) {
+		report["scenarios"].push_back(runScenario(scenario, frames, warmup, seed));
+	}
+
+	destroyHeadlessContext(ctx);
+
+	std::ofstream out(outPath);
+	if (!out.is_open()) {
+		std::cerr << "Cannot write " << outPath << std::endl;
+		return -1;
+	}
+	out << report.dump(2) << std::endl;
+	std::cout << "Wrote " << outPath << std::endl;
+	return 0;
+}
@@ -0,0 +1,358 @@
+// cloudWorld_microbench: times the CPU kernels of cloudworld_core across input sizes, no GL context needed.
+//
+//   cloudWorld_microbench [--filter name] [--min-ms N]
+//
+// Every case is repeated until it ran for at least --min-ms (default 200), the reported time is per call.
+// Animation cases run on a synthetic glTF skeleton (balanced binary tree of joints, one T/R/S channel
+// per joint) so joint and keyframe counts can go well past what bot.gltf has.
+
+#include "../include/animation.h"
+#include "../include/culling.h"
+#include "../include/mesh.h"
+#include "../include/texture_codec.h"
+#include "../include/world.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// keeps the optimizer from dropping results we never look at
+static volatile float sink = 0.0f;
+
+static double minTimeMs = 200.0;
+static std::string filter;
+
+static bool selected(const std::string& kernel, const std::string& size) {
+	return filter.empty() || (kernel + "/" + size).find(filter) != std::string::npos;
+}
+
+// Runs fn in growing batches until minTimeMs is reached, prints the time per call
+static void runCase(const std::string& kernel, const std::string& size, const std::function<void()>& fn) {
+	if (!selected(kernel, size))
+		return;
+
+	fn();	// warm up caches and allocations
+	long iterations = 1;
+	double elapsedMs = 0.0;
+	long total = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (elapsedMs < minTimeMs) {
+		for (long i = 0; i < iterations; ++i) fn();
+		total += iterations;
+		iterations *= 2;
+		elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	double nsPerCall = elapsedMs * 1e6 / total;
+	std::printf("%-28s %-18s %14.1f ns/call %10ld calls\n", kernel.c_str(), size.c_str(), nsPerCall, total);
+	std::fflush(stdout);
+}
+
+// Appends raw bytes to the model's single buffer and returns a tightly packed accessor for them
+static int addAccessor(tinygltf::Model& model, const void* data, size_t bytes, size_t count, int type) {
+	tinygltf::Buffer& buffer = model.buffers[0];
+	size_t offset = buffer.data.size();
+	buffer.data.resize(offset + bytes);
+	std::memcpy(buffer.data.data() + offset, data, bytes);
+
+	tinygltf::BufferView view;
+	view.buffer = 0;
+	view.byteOffset = offset;
+	view.byteLength = bytes;
+	model.bufferViews.push_back(view);
+
+	tinygltf::Accessor accessor;
+	accessor.bufferView = static_cast<int>(model.bufferViews.size() - 1);
+	accessor.byteOffset = 0;
+	accessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+	accessor.count = count;
+	accessor.type = type;
+	model.accessors.push_back(accessor);
+	return static_cast<int>(model.accessors.size() - 1);
+}
+
+// Skeleton with jointCount nodes (node i hangs under (i - 1) / 2) and a looping animation with
+// keyframeCount keys on translation, rotation and scale of every joint
+static tinygltf::Model makeSkeleton(int jointCount, int keyframeCount) {
+	tinygltf::Model model;
+	model.buffers.resize(1);
+	model.nodes.resize(jointCount);
+	for (int i = 0; i < jointCount; ++i) {
+		model.nodes[i].translation = {0.0, 1.0, 0.0};
+		if (i > 0) model.nodes[(i - 1) / 2].children.push_back(i);
+	}
+
+	std::vector<float> times(keyframeCount);
+	for (int k = 0; k < keyframeCount; ++k) times[k] = k / 30.0f;
+	int timeAccessor = addAccessor(model, times.data(), times.size() * sizeof(float), times.size(), TINYGLTF_TYPE_SCALAR);
+
+	tinygltf::Animation anim;
+	const char* paths[] = {"translation", "rotation", "scale"};
+	for (int j = 0; j < jointCount; ++j) {
+		for (int c = 0; c < 3; ++c) {
+			bool rotation = c == 1;
+			int components = rotation ? 4 : 3;
+			std::vector<float> values(keyframeCount * components);
+			for (int k = 0; k < keyframeCount; ++k) {
+				float a = 0.1f * k + 0.01f * j;
+				if (rotation) {
+					// unit quaternion (x, y, z, w) around z
+					values[k * 4 + 0] = 0.0f;
+					values[k * 4 + 1] = 0.0f;
+					values[k * 4 + 2] = std::sin(a * 0.5f);
+					values[k * 4 + 3] = std::cos(a * 0.5f);
+				} else {
+					for (int v = 0; v < 3; ++v) values[k * 3 + v] = 1.0f + 0.1f * std::sin(a + v);
+				}
+			}
+			int valueAccessor = addAccessor(model, values.data(), values.size() * sizeof(float), keyframeCount,
+											rotation ? TINYGLTF_TYPE_VEC4 : TINYGLTF_TYPE_VEC3);
+
+			tinygltf::AnimationSampler sampler;
+			sampler.input = timeAccessor;
+			sampler.output = valueAccessor;
+			sampler.interpolation = "LINEAR";
+			anim.samplers.push_back(sampler);
+
+			tinygltf::AnimationChannel channel;
+			channel.sampler = static_cast<int>(anim.samplers.size() - 1);
+			channel.target_node = j;
+			channel.target_path = paths[c];
+			anim.channels.push_back(channel);
+		}
+	}
+	model.animations.push_back(anim);
+	return model;
+}
+
+static void benchWorld() {
+	// wrapping every planet around the camera, done several times per planet per frame
+	for (int count : {1000, 10000, 100000}) {
+		std::vector<glm::vec3> positions(count);
+		std::srand(1);
+		for (glm::vec3& p : positions) p = randomInSphere(PLANET_FIELD_RADIUS);
+		glm::vec3 eye(13.0f, -42.0f, 77.0f);
+		runCase("wrapPlanetPosition", "planets=" + std::to_string(count), [&]() {
+			float acc = 0.0f;
+			for (const glm::vec3& p : positions) acc += wrapPlanetPosition(p, eye).x;
+			sink = acc;
+		});
+	}
+
+	// the separation (and for the huge fields the radii) shrink so larger fields still fit
+	const struct { int count; float minDistance; float radiusScale; } fields[] = {
+		{20, 40.0f, 1.0f}, {100, 20.0f, 1.0f}, {500, 6.0f, 1.0f}, {2000, 1.0f, 1.0f},
+		{10000, 1.0f, 0.2f}, {100000, 0.5f, 0.1f}
+	};
+	for (const auto& field : fields) {
+		std::string size = "planets=" + std::to_string(field.count);
+		runCase("placePlanets", size, [&]() {
+			std::srand(1337);
+			sink = static_cast<float>(placePlanets(field.count, field.minDistance, 20, field.radiusScale).size());
+		});
+
+		// every pair, so only up to 10k planets: the separation has to hold on the torus, not just inside the cube
+		if (field.count > 10000 || !selected("placePlanets", size))
+			continue;
+		std::srand(1337);
+		std::vector<Planet> planets = placePlanets(field.count, field.minDistance, 20, field.radiusScale);
+		int overlapping = 0;
+		for (size_t i = 0; i < planets.size(); ++i)
+			for (size_t j = i + 1; j < planets.size(); ++j)
+				if (wrappedDistance(planets[i].position, planets[j].position) <
+					planets[i].radius + planets[j].radius + field.minDistance)
+					++overlapping;
+		std::printf("%-28s %-18s %8zu placed %8d too close\n", "", size.c_str(), planets.size(), overlapping);
+	}
+}
+
+static void benchCulling() {
+	// the camera of the scene (100 degree FoV) looking into a field of small planets
+	glm::mat4 viewProjection = glm::perspective(glm::radians(100.0f), 4.0f / 3.0f, 0.1f, 3500.0f) *
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum frustum = Frustum::fromMatrix(viewProjection);
+	std::printf("cullSpheres uses %s\n", cullingPath());
+
+	for (int count : {1000, 10000, 100000}) {
+		BoundingSpheres spheres;
+		spheres.resize(count);
+		std::srand(1);
+		for (int i = 0; i < count; ++i)
+			spheres.set(i, randomInSphere(PLANET_FIELD_RADIUS), 0.5f + 3.0f * float(std::rand()) / RAND_MAX);
+		std::vector<uint32_t> visible;
+
+		runCase("cullSpheresScalar", "planets=" + std::to_string(count), [&]() {
+			sink = static_cast<float>(cullSpheresScalar(frustum, spheres, visible));
+		});
+		runCase("cullSpheres", "planets=" + std::to_string(count), [&]() {
+			sink = static_cast<float>(cullSpheres(frustum, spheres, visible));
+		});
+	}
+}
+
+static void benchMesh() {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	for (int tess : {16, 64, 256}) {
+		runCase("generateSphere", std::to_string(tess) + "x" + std::to_string(tess), [&]() {
+			generateSphere(tess, tess, vertices, indices);
+			sink = vertices.back().uv.x;
+		});
+	}
+	for (int subdivisions : {2, 4, 6}) {
+		runCase("generateIcosphere", std::to_string(subdivisions), [&]() {
+			generateIcosphere(subdivisions, vertices, indices);
+			sink = vertices.back().uv.x;
+		});
+	}
+
+	// vertex cache reordering, starts from the generator's order every call
+	for (int subdivisions : {2, 4, 6}) {
+		generateIcosphere(subdivisions, vertices, indices);
+		std::vector<uint32_t> optimized;
+		runCase("optimizeVertexCache", std::to_string(indices.size() / 3) + " tris", [&]() {
+			optimized = indices;
+			optimizeVertexCache(optimized, vertices.size());
+			sink = static_cast<float>(optimized[0]);
+		});
+		if (!optimized.empty())	// skipped by --filter
+			std::printf("  ACMR %.3f -> %.3f\n", vertexCacheAcmr(indices, vertices.size()),
+						vertexCacheAcmr(optimized, vertices.size()));
+	}
+}
+
+static void benchTextures() {
+	// what a texture cache miss costs on top of the decode
+	for (int size : {256, 1024, 4096}) {
+		std::vector<unsigned char> rgba(size_t(size) * size * 4);
+		std::srand(1);
+		for (unsigned char& c : rgba) c = static_cast<unsigned char>(std::rand() & 0xff);
+		std::string label = std::to_string(size) + "x" + std::to_string(size);
+
+		runCase("buildMipChain", label, [&]() {
+			sink = static_cast<float>(buildMipChain(rgba.data(), size, size).size());
+		});
+
+		std::vector<unsigned char> blocks(bc1Size(size, size));
+		runCase("compressBC1", label, [&]() {
+			compressBC1(rgba.data(), size, size, blocks.data());
+			sink = blocks[blocks.size() / 2];
+		});
+
+		runCase("fnv1a64", label, [&]() {
+			sink = static_cast<float>(fnv1a64(rgba.data(), rgba.size()) & 0xff);
+		});
+	}
+}
+
+static void benchAnimation() {
+	for (int keyframes : {8, 64, 512, 4096}) {
+		std::vector<float> times(keyframes);
+		for (int k = 0; k < keyframes; ++k) times[k] = k / 30.0f;
+		float duration = times.back();
+		runCase("findKeyframeIndex", "keys=" + std::to_string(keyframes), [&]() {
+			int acc = 0;
+			for (int i = 0; i < 256; ++i) acc += findKeyframeIndex(times, duration * (i / 256.0f));
+			sink = static_cast<float>(acc);
+		});
+	}
+
+	for (int joints : {25, 100, 1000}) {
+		tinygltf::Model model = makeSkeleton(joints, 2);
+		std::vector<glm::mat4> local(model.nodes.size()), global(model.nodes.size());
+		computeLocalNodeTransform(model, 0, local);
+		runCase("computeGlobalNodeTransform", "joints=" + std::to_string(joints), [&]() {
+			computeGlobalNodeTransform(model, local, 0, glm::mat4(1.0f), global);
+			sink = global.back()[3][1];
+		});
+
+
+		// TRS pose to global matrices, the per-frame vectors and the recursion against the flattened skeleton
+		tinygltf::Skin skin;
+		for (int j = 0; j < joints; ++j) skin.joints.push_back(j);
+		Skeleton skeleton = flattenSkeleton(model, skin);
+		std::vector<NodePose> pose(model.nodes.size());
+		for (size_t n = 0; n < pose.size(); ++n) pose[n].translation = glm::vec3(0.0f, 1.0f, 0.0f);
+		runCase("poseToGlobals", "recursive,joints=" + std::to_string(joints), [&]() {
+			std::vector<glm::mat4> locals(model.nodes.size());
+			for (size_t n = 0; n < pose.size(); ++n) locals[n] = pose[n].matrix();
+			std::vector<glm::mat4> globals(model.nodes.size());
+			computeGlobalNodeTransform(model, locals, 0, glm::mat4(1.0f), globals);
+			sink = globals.back()[3][1];
+		});
+		runCase("poseToGlobals", "flat,joints=" + std::to_string(joints), [&]() {
+			composeSkeleton(skeleton, pose, global);
+			sink = global.back()[3][1];
+		});
+	}
+
+	const struct { int joints; int keyframes; } clips[] = {{25, 32}, {25, 512}, {100, 32}, {100, 512}, {1000, 32}};
+	for (const auto& clip : clips) {
+		tinygltf::Model model = makeSkeleton(clip.joints, clip.keyframes);
+		std::vector<AnimationObject> animationObjects = prepareAnimation(model);
+		std::vector<glm::mat4> nodeTransforms(model.nodes.size());
+		float time = 0.0f;
+		runCase("updateAnimation",
+				"joints=" + std::to_string(clip.joints) + ",keys=" + std::to_string(clip.keyframes), [&]() {
+			for (glm::mat4& m : nodeTransforms) m = glm::mat4(1.0f);
+			time += 1.0f / 60.0f;
+			updateAnimation(model, model.animations[0], animationObjects[0], time, nodeTransforms);
+			sink = nodeTransforms.back()[3][1];
+		});
+
+		// same clip compiled, played forward with cursors, down to the same local matrices
+		AnimationClip compiled = compileAnimation(model, model.animations[0], animationObjects[0]);
+		std::vector<uint32_t> cursors;
+		std::vector<NodePose> pose(model.nodes.size());
+		time = 0.0f;
+		runCase("sampleClip",
+				"joints=" + std::to_string(clip.joints) + ",keys=" + std::to_string(clip.keyframes), [&]() {
+			time += 1.0f / 60.0f;
+			sampleClip(compiled, time, cursors, pose);
+			for (size_t n = 0; n < pose.size(); ++n) nodeTransforms[n] = pose[n].matrix();
+			sink = nodeTransforms.back()[3][1];
+		});
+	}
+
+	// whole clip into a joint palette at 60 poses per second, once per model at load time
+	for (int keyframes : {32, 512}) {
+		tinygltf::Model model = makeSkeleton(100, keyframes);
+		std::vector<AnimationObject> animationObjects = prepareAnimation(model);
+		AnimationClip compiled = compileAnimation(model, model.animations[0], animationObjects[0]);
+		tinygltf::Skin skin;
+		for (int j = 0; j < 100; ++j) skin.joints.push_back(j);
+		std::vector<glm::mat4> inverseBind(skin.joints.size(), glm::mat4(1.0f));
+		runCase("bakeJointPalette", "joints=100,keys=" + std::to_string(keyframes), [&]() {
+			JointPalette palette = bakeJointPalette(model, compiled, skin, inverseBind, 60.0f);
+			sink = palette.texels.back().w;
+		});
+	}
+}
+
+int main(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (arg == "--min-ms" && i + 1 < argc) {
+			minTimeMs = std::atof(argv[++i]);
+		} else {
+			std::printf("Usage: %s [--filter name] [--min-ms N]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	benchWorld();
+	benchCulling();
+	benchMesh();
+	benchTextures();
+	benchAnimation();
+	return 0;
+}
@@ -8,16 +8,44 @@
 #include <vector>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <algorithm>
+#include "include/asset_loader.h"
 #include "include/bot.h"
+#include "include/culling.h"
+#include "include/frame_data.h"
+#include "include/headless.h"
+#include "include/mesh.h"
+#include "include/profiler.h"
+#include "include/render_queue.h"
+#include "include/scene.h"
+#include "include/stream_buffer.h"
+#include "include/texture.h"
+#include "include/world.h"
 
 static GLFWwindow* window = nullptr;
 
+SceneConfig sceneConfig;
+
+// Image decodes and the glTF parse run on worker threads, drawFrame() uploads what is ready
+static AssetLoader assetLoader;
+// .cwtex files with prebuilt mip chains and the imported .cwmesh models,
+// written on the first launch (or by --bake-textures and --bake-models)
+static const char* ASSET_CACHE_DIR = "../cloudWorld/assets/cache";
+static bool compressTextures = false;   // sceneConfig.compressTextures if the GL supports BC1, set in init()
+
+// Framebuffer the camera pass draws into: 0 is the window, headless mode swaps in its own FBO
+static GLuint sceneFramebuffer = 0;
+static int framebufferWidth = 1280;
+static int framebufferHeight = 720;
+
 // Camera settings and MVP matrices
 glm::mat4 viewMatrix;
 glm::mat4 projectionMatrix;
 glm::mat4 modelMatrix;
 glm::float32 FoV   = 100.0f;
+static float aspectRatio = 4.0f / 3.0f;  // of projectionMatrix, the shadow cascades need it too
 glm::float32 zNear = 0.1f; // close near planet to approach planets
 glm::float32 zFar  = 3500.0f;
 static glm::vec3 eye_center(0.0f, 0.0f, 10.0f);
@@ -38,24 +66,28 @@ static glm::vec3 lightColor = glm::vec3(1.0f, 0.95f, 0.9f);  // white sunlight
 static glm::vec3 envColor = glm::vec3(0.4f, 0.55f, 0.65f);   // blue environment light
 
 // Shadow mapping
-static int shadowMapWidth = 4096;   // Shadow map resolution
-static int shadowMapHeight = 4096;
+static int shadowMapWidth = 1024;   // Shadow map resolution per cascade, set from sceneConfig in init()
+static int shadowMapHeight = 1024;
+static int shadowCascadeCount = 4;  // layers of the shadow map array, set from sceneConfig in init()
 static GLuint shadowFBO = 0;        // Shadow framebuffer object
-static GLuint shadowDepthTexture = 0;  // Depth texture for shadows
+static GLuint shadowDepthTexture = 0;  // Depth texture array for shadows, one layer per cascade
+static GLuint shadowStaticFBO = 0;     // the planets only, kept while the light box still fits (sceneConfig.shadowCaching)
+static GLuint shadowStaticTexture = 0;
+static size_t shadowStaticRedraws = 0;
 
-// Shadow map projection parameters
-static float depthFoV = 60.0f;      // Field of view for shadow camera
-static float depthNear = 1.0f;      // Near plane
-static float depthFar = 3500.0f;    // Far plane, I matched it with the camera farPlane to avoid render mixups
+// Shadow cascades: the camera frustum is sliced by view depth up to sceneConfig.shadowDistance, each slice gets
+// its own orthographic light box and shadow map layer, refitted every frame (fitShadowCascades())
+static float shadowBias = 0.1f;         // world units, the depth compare offset against shadow acne
+static float shadowBiasTexels = 2.0f;   // plus this many texels of the cascade, those grow with the distance
 
 // Skybox
 GLuint skyboxVAO;
 GLuint skyboxVertexBuffer;
 GLuint skyboxIndexBuffer;
 GLuint skyboxUVBuffer;
-GLuint skyboxProgramID;
-GLuint skyboxMatrixID;
+ShaderProgram skyboxProgram;
 GLuint skyboxTextureID;
+static const char* SKYBOX_TEXTURE_PATH = "../cloudWorld/assets/skybox/NebulaAtlas.png";
 
 static const GLfloat skyboxVertices[] = {
 	-1,-1, 1,  1,-1, 1,  1, 1, 1, -1, 1, 1,
@@ -102,49 +134,6 @@ static const GLuint skyboxIndices[] = {
    20,21,22, 20,22,23
 };
 
-// Practically the same as lab2 loadTextureTileBox()
-// modifications include CLAMP_TO_EDGE to prevent seams on spherical planets
-// depending on the type of file I had for the textures, it tend to fail so I added all formats I had the issue with
-GLuint LoadTexture(const char* image_path) {
-	GLuint textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load(image_path, &width, &height, &nrChannels, 0);
-	if (!data) {
-		std::cout << "Failed to load texture: " << image_path << std::endl;
-		return 0;
-	}
-
-	// Check format depending on the number of channels
-	GLenum format = GL_RGB;
-	if (nrChannels == 1) format = GL_RED;
-	else if (nrChannels == 3) format = GL_RGB;
-	else if (nrChannels == 4) format = GL_RGBA;
-
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexImage2D(
-		GL_TEXTURE_2D,
-		0,
-		format,
-		width,
-		height,
-		0,
-		format,
-		GL_UNSIGNED_BYTE,
-		data
-	);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	stbi_image_free(data);
-	return textureID;
-}
-
 // Initialize skybox cube geometry and texture based on lab2
 void initSkybox() {
 	adjustSkyboxUV();
@@ -174,40 +163,34 @@ void initSkybox() {
 
 	glBindVertexArray(0);
 
-	skyboxProgramID = LoadShadersFromFile(
+	skyboxProgram = LoadShadersFromFile(
 		"../cloudWorld/render/skybox.vert",
 		"../cloudWorld/render/skybox.frag"
 	);
 
-	skyboxMatrixID = glGetUniformLocation(skyboxProgramID, "MVP");
-	skyboxTextureID = LoadTexture("../cloudWorld/assets/skybox/NebulaAtlas.png");
+	// black until the atlas is decoded, same as space behind it
+	skyboxTextureID = createPlaceholderTexture(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	assetLoader.loadTexture(SKYBOX_TEXTURE_PATH, ASSET_CACHE_DIR, compressTextures, [](const TextureData& texture) {
+		uploadTexture(skyboxTextureID, texture);
+	});
 }
 
-// Render skybox as background
-// disabled depth writing to ensure skybox renders behind everything
-void drawSkybox(const glm::mat4& Perspective, const glm::mat4& View) {
-	glDepthMask(GL_FALSE);
-	glUseProgram(skyboxProgramID);
-
-	glm::mat4 ViewNoTranslation = glm::mat4(glm::mat3(View));
-	glm::mat4 skyboxMVP = Perspective * ViewNoTranslation * glm::mat4(1.0f);
-
-	glUniformMatrix4fv(skyboxMatrixID, 1, GL_FALSE, &skyboxMVP[0][0]);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, skyboxTextureID);
-
-	glBindVertexArray(skyboxVAO);
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
-
-	glUseProgram(0);
-	glDepthMask(GL_TRUE);
+// Skybox as background: the shader puts it on the far plane and it goes after everything opaque,
+// so the depth test (GL_LEQUAL against the cleared depth) only shades the pixels nothing else covered.
+// No depth writes, view and projection come from the camera's FrameData, the shader drops the translation
+static void submitSkybox(RenderQueue& queue) {
+	DrawItem item;
+	item.program = &skyboxProgram;
+	item.vao = skyboxVAO;
+	item.textures[0] = { GL_TEXTURE_2D, skyboxTextureID };
+	item.depthWrite = false;
+	item.depthFunc = GL_LEQUAL;
+	item.zone = "skybox";
+	item.count = 36;
+	item.indexType = GL_UNSIGNED_INT;
+	queue.submit(item, LAYER_SKY, 1.0f);
 }
 
-//For infinity camera movement
-static const float WORLD_SIZE = 200.0f;		// infinite world cube size
-
 // Convert yaw and pitch angles to 3D direction vectors
 static glm::vec3 forwardDir() {
 	return glm::normalize(glm::vec3(
@@ -222,51 +205,24 @@ static glm::vec3 rightDir() {
 	return glm::normalize(glm::cross(forwardDir(), up));
 }
 
-// Infinite world wrapping functions
-// objects wrap around when they exceed world boundaries
-
-// Wrap a single coordinate value within [-period/2, period/2]
-static float wrapFloat(float value, float period) {
-	float half = period * 0.5f;
-	value = fmod(value + half, period);
-	if (value < 0.0f) value += period;
-	return value - half;
-}
-
-// Wrap 3D position within world cube
-static void wrapPosition(glm::vec3& p, float size) {
-	p.x = wrapFloat(p.x, size);
-	p.y = wrapFloat(p.y, size);
-	p.z = wrapFloat(p.z, size);
-}
-
-// Wrap planet position relative to camera for infinite illusion
-// Planets appear to wrap around as camera moves through world
-glm::vec3 wrapPlanetPosition(const glm::vec3& planetPos) {
-	glm::vec3 p = planetPos;
-	p.x = wrapFloat(p.x - eye_center.x, WORLD_SIZE) + eye_center.x;
-	p.y = wrapFloat(p.y - eye_center.y, WORLD_SIZE) + eye_center.y;
-	p.z = wrapFloat(p.z - eye_center.z, WORLD_SIZE) + eye_center.z;
-	return p;
-}
-
-// Initialize shadow framebuffer for shadow mapping
+// Depth-only framebuffer with a depth texture array, one layer per cascade
 // same as lab3
-static void initShadowFBO() {
+static void createShadowTarget(GLuint& fbo, GLuint& depthTexture) {
 	// Generate framebuffer
-	glGenFramebuffers(1, &shadowFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
-	// Create depth texture
-	glGenTextures(1, &shadowDepthTexture);
-	glBindTexture(GL_TEXTURE_2D, shadowDepthTexture);
+	// Create depth texture, one layer per cascade
+	glGenTextures(1, &depthTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
 
-	glTexImage2D(
-		GL_TEXTURE_2D,
+	glTexImage3D(
+		GL_TEXTURE_2D_ARRAY,
 		0,
 		GL_DEPTH_COMPONENT,
 		shadowMapWidth,
 		shadowMapHeight,
+		shadowCascadeCount,
 		0,
 		GL_DEPTH_COMPONENT,
 		GL_FLOAT,
@@ -274,20 +230,20 @@ static void initShadowFBO() {
 	);
 
 	// Texture parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
 	float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
 
-	// Attach depth texture to FBO
-	glFramebufferTexture2D(
+	// Attach the first layer to the FBO, the shadow pass switches layers per cascade
+	glFramebufferTextureLayer(
 		GL_FRAMEBUFFER,
 		GL_DEPTH_ATTACHMENT,
-		GL_TEXTURE_2D,
-		shadowDepthTexture,
+		depthTexture,
+		0,
 		0
 	);
 
@@ -303,40 +259,125 @@ static void initShadowFBO() {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+// Initialize shadow framebuffers for shadow mapping: the one the shaders sample and the cached planets
+static void initShadowFBO() {
+	createShadowTarget(shadowFBO, shadowDepthTexture);
+	if (sceneConfig.shadowCaching)
+		createShadowTarget(shadowStaticFBO, shadowStaticTexture);
+}
 
-struct Vertex {
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec2 uv;
-};
 
 GLuint sphereVAO;
 GLuint sphereVBO;
 GLuint sphereEBO;
-GLsizei sphereIndexCount = 0;
+
+// Planet meshes, every level of detail in the one vertex and index buffer, 0 is the finest
+// (sceneConfig.planetLods, otherwise a single UV sphere of sphereStacks x sphereSlices)
+static const int MAX_PLANET_LODS = 5;
+struct SphereLod {
+	GLsizei indexCount = 0;
+	size_t firstIndex = 0;
+	GLint baseVertex = 0;
+};
+static std::vector<SphereLod> sphereLods;
+static GLenum sphereIndexType = GL_UNSIGNED_INT;	// 16 bit when every level has few enough vertices
+static size_t sphereIndexSize = sizeof(uint32_t);
+// largest projected radius each level is good for, in pixels for the camera and in shadow map texels
+static std::vector<float> cameraLodRadius;
+static std::vector<float> shadowLodRadius;
 
 // Procedural planets
-GLuint planetProgramID;
-GLuint planetMatrixID;
-GLuint planetModelID;
-//Planet creation and positions
-static const int NUM_PLANETS = 20;
-static const float PLANET_FIELD_RADIUS = 220.0f;
-static const float MIN_PLANET_DISTANCE = 80.0f;		// Minimum separation
+ShaderProgram planetProgram;
 //Textures
 static const int NUM_PLANET_TEXTURES = 20;
-GLuint planetTextures[NUM_PLANET_TEXTURES];
-GLuint planetTextureSampler;
-
-struct Planet {
-	glm::vec3 position;
+// Total of 20 textures, could be too much but given the randomness in each run, sometimes it can give cool combinations
+// Planet::textureIndex is the layer in planetTextures
+static const char* const planetTexturePaths[NUM_PLANET_TEXTURES] = {
+	"../cloudWorld/assets/textures/aerialRock.jpg",
+	"../cloudWorld/assets/textures/wafflePiqueCotton.jpg",
+	"../cloudWorld/assets/textures/jerseyMelange.jpg",
+	"../cloudWorld/assets/textures/lichenRock.jpg",
+	"../cloudWorld/assets/textures/rockBoulderDry.jpg",
+	"../cloudWorld/assets/textures/quatrefoilJacquardFabric.jpg",
+	"../cloudWorld/assets/textures/snowField.jpg",
+	"../cloudWorld/assets/textures/mossyBrick.jpg",
+	"../cloudWorld/assets/textures/redSlateRoofTiles.jpg",
+	"../cloudWorld/assets/textures/aerialRocks04.jpg",
+	"../cloudWorld/assets/textures/brokenBrickWall.jpg",
+	"../cloudWorld/assets/textures/ginghamCheck.jpg",
+	"../cloudWorld/assets/textures/rockBump.jpg",
+	"../cloudWorld/assets/textures/rockPitted.jpg",
+	"../cloudWorld/assets/textures/cliffSide.jpg",
+	"../cloudWorld/assets/textures/terryCloth.jpg",
+	"../cloudWorld/assets/textures/velourVelvet.jpg",
+	"../cloudWorld/assets/textures/rock06.jpg",
+	"../cloudWorld/assets/textures/oldLinoleumFlooring.jpg",
+	"../cloudWorld/assets/textures/rocksGround05.jpg",
+};
+static TextureArray planetTextures;
+// layers are grey while their image is still loading, black if it failed to load
+// (black is also what the old unbound texture gave for missing files)
+static const glm::vec4 planetTexturePlaceholder(0.5f, 0.5f, 0.5f, 1.0f);
+static const glm::vec4 planetTextureMissing(0.0f, 0.0f, 0.0f, 1.0f);
+
+// Per planet vertex attributes, all planets go out in one instanced draw per pass
+struct PlanetInstance {
+	glm::mat4 model;
 	float radius;
-	int textureIndex;			// chosen texture for planet
-	glm::mat4 modelMatrix;
-	glm::vec3 rotationAxis;		// Random rotation axis
-	float rotationSpeed;		// angular velocity
-	float rotationAngle;		// rotation angle for planet rotation effect
+	float textureLayer;
+};
+static StreamBuffer planetInstanceStream;		// a region per frame, updatePlanetInstances() writes the next one
+static std::vector<PlanetInstance> planetInstances;
+
+// Planet bounding spheres (wrapped around the camera), the ones inside the camera frustum this frame
+// and per shadow cascade the ones that can cast a shadow onto those. The instance buffer holds the
+// visible planets followed by the casters of each cascade, each pass points the instance attributes at its own range.
+static BoundingSpheres planetBounds;
+static std::vector<uint32_t> visiblePlanets;
+
+// Instances of one pass grouped by level of detail, one instanced draw per level
+struct PlanetBatch {
+	size_t firstInstance[MAX_PLANET_LODS] = {};
+	size_t count[MAX_PLANET_LODS] = {};
+	float nearest[MAX_PLANET_LODS] = {};	// closest surface of the level's instances over zFar, orders the draws
 };
+static PlanetBatch cameraBatch;
+static std::vector<int8_t> planetLods;		// camera level of each planet in the last frame, for the hysteresis
+static std::vector<uint8_t> batchLods;		// scratch, level of each planet of the batch being built
+static size_t planetTriangles = 0;			// drawn by the last camera pass
+static size_t cameraDrawItems = 0;			// draw items and state changes the last camera pass executed
+static size_t cameraStateChanges = 0;
+
+// With sceneConfig.shadowCaching the planets are drawn into the static layer once, with a light box a margin
+// larger than needed, and reused while that box still covers the slice and the planets in it stay put
+// (they only spin, which does not change a sphere's shadow, or wrap around the camera). Every frame the
+// static layer is copied into the sampled one and only the humanoids are drawn on top.
+struct ShadowCascade {
+	glm::mat4 lightVP = glm::mat4(1.0f);
+	Frustum lightBox;				// to skip the humanoids outside of it
+	float splitFar = 0.0f;			// view depth where the cascade ends
+	float depthBias = 0.0f;			// in this cascade's depth units
+	float texelSize = 1.0f;			// world units per shadow map texel, picks the casters' level of detail
+	bool active = false;			// something in the slice receives shadows
+	std::vector<uint32_t> casters;
+	PlanetBatch batch;				// where the casters are in the instance buffer
+	size_t firstBot = 0;			// the humanoids inside the light box, in the bot's instance buffer
+	size_t botCount = 0;
+
+	ShadowFrustum cached;			// light box of the static layer
+	uint64_t casterHash = 0;		// of the planets drawn into it
+	bool cacheValid = false;
+	bool redraw = false;			// planets go into the layer this frame
+};
+static ShadowCascade shadowCascades[MAX_SHADOW_CASCADES];
+
+static void invalidateShadowCache() {
+	for (ShadowCascade& cascade : shadowCascades)
+		cascade.cacheValid = false;
+}
+static std::vector<glm::mat4> humanoidModels;	// this frame's model matrices, wrapped around the camera
+static std::vector<glm::vec4> humanoidBounds;	// center + radius, cast into (and receive in) every cascade
+
 std::vector<Planet> planets;
 
 // Fog settings
@@ -344,71 +385,65 @@ static bool fogEnabled = true;
 static glm::vec3 fogColor(0.02f, 0.02f, 0.08f);  // a dark blue to match space theme
 static float fogDensity = 0.005f;  // fog thickness
 
-// generate random point inside sphere for planet placement
-glm::vec3 randomInSphere(float radius) {
-	glm::vec3 p;
-	do {
-		p = glm::vec3(
-			(float(rand()) / RAND_MAX) * 2.0f - 1.0f,
-			(float(rand()) / RAND_MAX) * 2.0f - 1.0f,
-			(float(rand()) / RAND_MAX) * 2.0f - 1.0f
-		);
-	} while (glm::length(p) > 1.0f);
-	return p * radius;
+// Points the instance attributes of the (bound) sphere VAO at this frame's instances starting from instance first.
+// GL 3.3 has no base instance for glDrawElementsInstanced, so the passes move the attribute offsets instead.
+static void bindPlanetInstances(size_t first) {
+	size_t base = planetInstanceStream.offset + first * sizeof(PlanetInstance);
+	glBindBuffer(GL_ARRAY_BUFFER, planetInstanceStream.buffer);
+	for (int column = 0; column < 4; ++column) {
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(PlanetInstance),
+		                      (void*)(base + offsetof(PlanetInstance, model) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(7, 2, GL_FLOAT, GL_FALSE, sizeof(PlanetInstance),
+	                      (void*)(base + offsetof(PlanetInstance, radius)));
 }
 
-// generate procedural UV sphere geometry with parametric equations for planets
+// procedural spheres for the planets, vertices come from generateIcosphere()/generateSphere() (mesh.cpp)
+// The icosphere levels go from 4 subdivisions (5120 triangles) down to the plain icosahedron (20).
+// Each level is reordered for the post-transform cache and the vertex fetch, then packed (PackedVertex)
 void createSphere(int stacks, int slices) {
-	// Sphere formula (inspired in quiz and lighting lecture)
-	// x = sin(ϕ) * cos(θ)
-	// y = cos(ϕ)
-	// z = sin(ϕ) * sin(θ)
-	// where ϕ ∈ [0,π] (stacks - latitude) and θ ∈ [0,2π] (slices - longitude).
-	// had to look at glm::pi<float>() and glm::two_pi<float>() from stackOverflow to maintain all decimals
-    std::vector<Vertex> vertices;
+    std::vector<PackedVertex> vertices;
     std::vector<uint32_t> indices;
-
-    for (int i = 0; i <= stacks; ++i) {
-        float v = float(i) / float(stacks);
-        float phi = v * glm::pi<float>();
-
-        for (int j = 0; j <= slices; ++j) {
-            float u = float(j) / float(slices);
-            float theta = u * glm::two_pi<float>();
-
-            glm::vec3 p(
-                sin(phi) * cos(theta),
-                cos(phi),
-                sin(phi) * sin(theta)
-            );
-
-            vertices.push_back({
-                p,
-                glm::normalize(p),
-                glm::vec2(u, 1.0f - v)
-            });
-        }
-    }
-
-    for (int i = 0; i < stacks; ++i) {
-        for (int j = 0; j < slices; ++j) {
-        	// unsigned int for index buffers
-            uint32_t a = i * (slices + 1) + j;
-            uint32_t b = (i + 1) * (slices + 1) + j;
-            uint32_t c = b + 1;
-            uint32_t d = a + 1;
-
-            indices.push_back(a);
-            indices.push_back(b);
-            indices.push_back(d);
-
-            indices.push_back(d);
-            indices.push_back(b);
-            indices.push_back(c);
-        }
+    sphereLods.clear();
+    cameraLodRadius.clear();
+    shadowLodRadius.clear();
+
+    int levels = sceneConfig.planetLods ? MAX_PLANET_LODS : 1;
+    for (int lod = 0; lod < levels; ++lod) {
+        std::vector<Vertex> lodVertices;
+        std::vector<uint32_t> lodIndices;
+        if (sceneConfig.planetLods)
+            generateIcosphere(MAX_PLANET_LODS - 1 - lod, lodVertices, lodIndices);
+        else
+            generateSphere(stacks, slices, lodVertices, lodIndices);
+
+        // indices stay relative to the level's first vertex, the draws add baseVertex
+        SphereLod mesh;
+        mesh.indexCount = static_cast<GLsizei>(lodIndices.size());
+        mesh.firstIndex = indices.size();
+        mesh.baseVertex = static_cast<GLint>(vertices.size());
+        sphereLods.push_back(mesh);
+
+        float edgeAngle = maxEdgeAngle(lodVertices, lodIndices);
+        cameraLodRadius.push_back(lod == 0 ? INFINITY : sphereLodMaxRadius(edgeAngle, sceneConfig.lodPixelError));
+        shadowLodRadius.push_back(lod == 0 ? INFINITY : sphereLodMaxRadius(edgeAngle, sceneConfig.shadowLodTexelError));
+
+        float acmrBefore = vertexCacheAcmr(lodIndices, lodVertices.size());
+        optimizeVertexCache(lodIndices, lodVertices.size());
+        remapVertices(lodVertices, optimizeVertexFetch(lodIndices, lodVertices.size()));
+        std::cout << "Planet mesh " << lod << ": " << lodIndices.size() / 3 << " triangles, ACMR "
+                  << acmrBefore << " -> " << vertexCacheAcmr(lodIndices, lodVertices.size()) << std::endl;
+
+        for (const Vertex& vertex : lodVertices)
+            vertices.push_back(packVertex(vertex));
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
     }
 
-    sphereIndexCount = static_cast<GLsizei>(indices.size());
+    // the indices are relative to their level, so 16 bits are enough unless one level alone has more vertices
+    std::vector<uint16_t> shortIndices;
+    bool narrow = narrowIndices(indices, shortIndices);
+    sphereIndexType = narrow ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    sphereIndexSize = narrow ? sizeof(uint16_t) : sizeof(uint32_t);
 
     glGenVertexArrays(1, &sphereVAO);
     glBindVertexArray(sphereVAO);
@@ -416,37 +451,77 @@ void createSphere(int stacks, int slices) {
     glGenBuffers(1, &sphereVBO);
     glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
     glBufferData(GL_ARRAY_BUFFER,
-                 vertices.size() * sizeof(Vertex),
+                 vertices.size() * sizeof(PackedVertex),
                  vertices.data(),
                  GL_STATIC_DRAW);
 
     glGenBuffers(1, &sphereEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 indices.size() * sizeof(uint32_t),
-                 indices.data(),
+                 indices.size() * sphereIndexSize,
+                 narrow ? (const void*)shortIndices.data() : (const void*)indices.data(),
                  GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0); // position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)0);
 
-    glEnableVertexAttribArray(1); // normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(1); // normal, octahedral snorm16 unfolded in box.vert
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex),
+                          (void*)offsetof(PackedVertex, normal));
 
     glEnableVertexAttribArray(2); // uv
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void*)offsetof(Vertex, uv));
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          (void*)offsetof(PackedVertex, uv));
+
+    // instance data of the visible planets and every cascade's casters, refilled every frame by updatePlanetInstances()
+    planetInstanceStream.create(GL_ARRAY_BUFFER, sceneConfig.numPlanets * (1 + MAX_SHADOW_CASCADES) * sizeof(PlanetInstance));
+
+    for (int location = 3; location <= 7; ++location) { // model matrix (one vec4 per location), radius + layer
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    bindPlanetInstances(0);
 
     glBindVertexArray(0);
 }
 
-// Humanoid from lab4
+// Humanoids from lab4, all of them are instances of the one bot model
+// each runs around its own planet with its own animation time
+struct Humanoid {
+	int planetIndex = -1;					// planet designated for humanoid
+	float angle = 0.0f;						// current position angle on planet
+	float angularSpeed = 0.5f;				// speed of orbit around planet
+	float latitude = glm::radians(25.0f);	// of its path, from the planet's north pole
+	float height = 0.8f;					// distance from the planet center, in planet radii
+	float scale = 2.0f;						// size, in planet radii
+	glm::vec3 correction = glm::vec3(1, 0, 1);	// world offset found by trial and error for the lab4 humanoid
+	float playbackSpeed = 2.0f;				// animation seconds per scene second
+	float animTime = 0.0f;					// animation playback time (for bot.cpp)
+	std::vector<uint32_t> animationCursors;	// keyframe cursors for its animTime (MyBot::update())
+};
 MyBot bot;
-int humanoidPlanetIndex = -1;			// planet designated for humanoid
-float humanoidAngle = 0.0f;				// current position angle on planet
-float humanoidAngularSpeed = 0.5f;		// speed of orbit around planet
-static float botAnimTime = 0.0f;		// animation playback time (for bot.cpp)
+std::vector<Humanoid> humanoids;
+
+// Poses of all humanoids when the bot is not baked, bot.jointCount() matrices each (MyBot::uploadPoses()),
+// and the instances of the camera pass followed by the ones of each cascade (MyBot::uploadInstances()).
+// With sceneConfig.skinningPrePass every humanoid drawn at all comes once more at the end, for MyBot::skin().
+static std::vector<glm::mat3x4> humanoidPoses;
+static std::vector<BotInstance> botInstances;
+static size_t cameraBots = 0;
+static float cameraBotDepth = 0.0f;			// nearest one the camera sees, over zFar
+static size_t firstSkinnedBot = 0;
+static std::vector<int32_t> skinnedSlots;		// per humanoid, -1 if no pass draws it
+static std::vector<uint32_t> skinnedHumanoids;	// per slot
+
+// Per-frame state: slot 0 is the camera view, then one light view per shadow cascade
+enum FrameView { CAMERA_VIEW = 0, FIRST_SHADOW_VIEW = 1 };
+static UniformBlockBuffer frameBlocks;
+// Per-draw state: slot 0 is shared by all planet instances, slot 1 by all humanoids, used by both passes
+static UniformBlockBuffer drawBlocks;
+static const size_t PLANET_DRAW_SLOT = 0;
+static const size_t BOT_DRAW_SLOT = 1;
+// Draw items of the pass being rendered, each pass submits into it and executes it
+static RenderQueue renderQueue;
 
 // initialize all rendering resources
 // - Shadow framebuffer
@@ -457,360 +532,618 @@ static float botAnimTime = 0.0f;		// animation playback time (for bot.cpp)
 void init() {
 	glEnable(GL_DEPTH_TEST);
 
+	// before any StreamBuffer is created
+	if (!setPersistentMapping(sceneConfig.persistentMapping) && sceneConfig.persistentMapping)
+		std::cerr << "No GL_ARB_buffer_storage, per-frame data is streamed with glMapBufferRange" << std::endl;
+
+	// start on the file work first so it overlaps with the shader compiles below
+	compressTextures = sceneConfig.compressTextures && textureCompressionSupported();
+	if (sceneConfig.compressTextures && !compressTextures)
+		std::cerr << "No S3TC support, planet and skybox textures stay uncompressed" << std::endl;
+	assetLoader.start();
+	bot.initialize(assetLoader, ASSET_CACHE_DIR, sceneConfig.animationBakeRate);
+
 	// Projection matrix
 	projectionMatrix = glm::perspective(
 		glm::radians(FoV),
-		4.0f / 3.0f,
+		aspectRatio,
 		zNear,
 		zFar
 	);
 
+	// Shared uniform blocks
+	frameBlocks.create(sizeof(FrameData), 1 + MAX_SHADOW_CASCADES);
+	drawBlocks.create(sizeof(DrawData), 2);
+
 	// Skybox
 	initSkybox();
 
 	// Initialize shadow mapping
+	shadowMapWidth = sceneConfig.shadowMapSize;
+	shadowMapHeight = sceneConfig.shadowMapSize;
+	shadowCascadeCount = std::min(std::max(sceneConfig.shadowCascades, 1), MAX_SHADOW_CASCADES);
 	initShadowFBO();
+	invalidateShadowCache();
+	shadowStaticRedraws = 0;
 
-	createSphere(64, 64);
-	planets.clear();
-
-	for (int i = 0; i < NUM_PLANETS; ++i) {
-		Planet p;
-		bool valid = false;
-		int attempts = 0;
-		const int MAX_ATTEMPTS = 1000;  // Add safety limit if it reaches more than 1000 attempts to get a valid planet
-
-		while (!valid && attempts < MAX_ATTEMPTS) {
-			attempts++;
-			// randomly placed planets need to respect minimal distances between other already created planets
-			p.position = randomInSphere(PLANET_FIELD_RADIUS);
-			glm::vec3 pWrapped = wrapPlanetPosition(p.position);
-			float t = float(rand()) / RAND_MAX;   // [0,1]
-
-			// like the universe, I decided to make small planets common, big ones rare
-			float scaleType = float(rand()) / RAND_MAX;
-			if (scaleType < 0.7f) {
-				// Small planets/asteroids have very high change (70% chance)
-				p.radius = 1.0f + t * 5.0f;  // 1-6 units
-			} else if (scaleType < 0.95f) {
-				// Medium planets (25% chance)
-				p.radius = 8.0f + t * 8.0f;  // 8-16 units
-			} else {
-				// Gas giants (5% chance)
-				p.radius = 20.0f + t * 15.0f;  // 20-35 units
-			}
-			p.textureIndex = static_cast<int>((float(rand()) / RAND_MAX) * NUM_PLANET_TEXTURES);
-			// random rotation axis
-			p.rotationAxis = glm::normalize(randomInSphere(1.0f));
-			// random angular speed (slow)
-			p.rotationSpeed = 0.1f + (float(rand()) / RAND_MAX) * 0.3f;
-			// initial angle
-			p.rotationAngle = (float(rand()) / RAND_MAX) * glm::two_pi<float>();
-			valid = true;
-			for (const Planet& other : planets) {
-				glm::vec3 otherWrapped = wrapPlanetPosition(other.position);
-				float minDist = p.radius + other.radius + MIN_PLANET_DISTANCE;
-				if (glm::distance(pWrapped, otherWrapped) < minDist) {
-					valid = false;
-					break;
-				}
-			}
-		}
-		if (valid)  // Only add if it found valid position
-			planets.push_back(p);
-	}
+	createSphere(sceneConfig.sphereStacks, sceneConfig.sphereSlices);
+	// planet count and minimum separation come from sceneConfig
+	planets = placePlanets(sceneConfig.numPlanets, sceneConfig.minPlanetDistance, NUM_PLANET_TEXTURES,
+						   sceneConfig.planetRadiusScale);
+	planetLods.assign(planets.size(), -1);
 
-	planetProgramID = LoadShadersFromFile(
+	planetProgram = LoadShadersFromFile(
 	"../cloudWorld/render/box.vert",
 	"../cloudWorld/render/box.frag"
 	);
-	// Total of 20 textures, could be too much but given the randomness in each run, sometimes it can give cool combinations
-	planetTextures[0] = LoadTexture("../cloudWorld/assets/textures/aerialRock.jpg");
-	planetTextures[1] = LoadTexture("../cloudWorld/assets/textures/wafflePiqueCotton.jpg");
-	planetTextures[2] = LoadTexture("../cloudWorld/assets/textures/jerseyMelange.jpg");
-	planetTextures[3] = LoadTexture("../cloudWorld/assets/textures/lichenRock.jpg");
-	planetTextures[4] = LoadTexture("../cloudWorld/assets/textures/rockBoulderDry.jpg");
-	planetTextures[5] = LoadTexture("../cloudWorld/assets/textures/quatrefoilJacquardFabric.jpg");
-	planetTextures[6] = LoadTexture("../cloudWorld/assets/textures/snowField.jpg");
-	planetTextures[7] = LoadTexture("../cloudWorld/assets/textures/mossyBrick.jpg");
-	planetTextures[8] = LoadTexture("../cloudWorld/assets/textures/redSlateRoofTiles.jpg");
-	planetTextures[9] = LoadTexture("../cloudWorld/assets/textures/aerialRocks04.jpg");
-	planetTextures[10] = LoadTexture("../cloudWorld/assets/textures/brokenBrickWall.jpg");
-	planetTextures[11] = LoadTexture("../cloudWorld/assets/textures/ginghamCheck.jpg");
-	planetTextures[12] = LoadTexture("../cloudWorld/assets/textures/rockBump.jpg");
-	planetTextures[13] = LoadTexture("../cloudWorld/assets/textures/rockPitted.jpg");
-	planetTextures[14] = LoadTexture("../cloudWorld/assets/textures/cliffSide.jpg");
-	planetTextures[15] = LoadTexture("../cloudWorld/assets/textures/terryCloth.jpg");
-	planetTextures[16] = LoadTexture("../cloudWorld/assets/textures/velourVelvet.jpg");
-	planetTextures[17] = LoadTexture("../cloudWorld/assets/textures/rock06.jpg");
-	planetTextures[18] = LoadTexture("../cloudWorld/assets/textures/oldLinoleumFlooring.jpg");
-	planetTextures[19] = LoadTexture("../cloudWorld/assets/textures/rocksGround05.jpg");
-
-	planetTextureSampler = glGetUniformLocation(planetProgramID, "diffuseTexture");
-	planetMatrixID = glGetUniformLocation(planetProgramID, "MVP");
-	planetModelID  = glGetUniformLocation(planetProgramID, "M");
-
-	// humanoid init
-	bot.initialize();
-	if (humanoidPlanetIndex < 0 && !planets.empty()) {
-		humanoidPlanetIndex = rand() % planets.size();
-	}
-	humanoidAngle = 0.0f;
+	// layer size from the file (or cache) headers alone, the pixels follow from the asset loader
+	int layerSize = 1;
+	for (const char* path : planetTexturePaths)
+		layerSize = std::max(layerSize, textureSize(path, ASSET_CACHE_DIR, compressTextures));
+	planetTextures.create(std::min(layerSize, sceneConfig.planetTextureSize), NUM_PLANET_TEXTURES, planetTexturePlaceholder,
+						  compressTextures ? TEXTURE_BC1 : TEXTURE_RGBA8);
+	for (int i = 0; i < NUM_PLANET_TEXTURES; ++i) {
+		const char* path = planetTexturePaths[i];
+		assetLoader.loadTexture(path, ASSET_CACHE_DIR, compressTextures, [i, path](const TextureData& texture) {
+			if (planetTextures.setLayer(i, texture))
+				return;
+			if (texture.valid())
+				std::cerr << "Texture " << path << " does not fit the planet texture array (compressed ones need to be square)" << std::endl;
+			planetTextures.fillLayer(i, planetTextureMissing);
+		});
+	}
+
+	// everything else comes from the FrameData/DrawData blocks, only the samplers are plain uniforms
+	planetProgram.use();
+	planetProgram.set(planetProgram.uniform("diffuseTextures"), 0);
+	planetProgram.set(planetProgram.uniform("shadowMap"), 1);
+	glUseProgram(0);
+
+	// the render queue points the instance attributes of the planet and bot VAOs at each item's instance range
+	renderQueue.setInstanceBinder(INSTANCES_PLANETS, bindPlanetInstances);
+	renderQueue.setInstanceBinder(INSTANCES_BOT, [](size_t first) { bot.bindInstances(first); });
+
+	// humanoid init (the model itself is still loading, see bot.initialize() above)
+	bot.shadowDepthTexture = shadowDepthTexture;
+	humanoids.clear();
+	humanoidPoses.clear();
+	if (!planets.empty()) {
+		for (int i = 0; i < sceneConfig.numBots; ++i) {
+			Humanoid h;
+			h.planetIndex = rand() % planets.size();
+			h.animTime = i * 0.37f;		// so a crowd does not walk in lockstep
+			humanoids.push_back(h);
+		}
+		// walkers spread around every planet, smaller and each at its own pace
+		int walkers = sceneConfig.walkersPerPlanet;
+		for (size_t p = 0; p < planets.size(); ++p) {
+			for (int k = 0; k < walkers; ++k) {
+				Humanoid h;
+				h.planetIndex = static_cast<int>(p);
+				h.angle = glm::two_pi<float>() * k / walkers;
+				h.latitude = glm::radians(30.0f + 120.0f * (rand() / (float)RAND_MAX));
+				h.height = 1.0f;
+				h.scale = 0.25f;
+				h.correction = glm::vec3(0.0f);
+				h.angularSpeed = 0.2f + 0.4f * (rand() / (float)RAND_MAX);
+				h.playbackSpeed = 1.5f + (rand() / (float)RAND_MAX);
+				h.animTime = humanoids.size() * 0.37f;
+				humanoids.push_back(h);
+			}
+		}
+	}
 }
 
-void render() {
-	// light's view-projection matrix calculation
-	glm::vec3 lightPos = eye_center + glm::normalize(-lightDirection) * 200.0f;
-	glm::mat4 lightView = glm::lookAt(
-		lightPos,
-		lightPos + lightDirection,
-		glm::vec3(0.0f, 1.0f, 0.0f)
-	);
+// Humanoid model matrix on its planet, the same for the shadow pass and the camera pass
+static glm::mat4 computeHumanoidModelMatrix(const Humanoid& h) {
+	const Planet& hp = planets[h.planetIndex];
 
-	glm::mat4 lightProjection = glm::perspective(
-		glm::radians(90.0f),  // FOV
-		1.0f,                  // Aspect ratio (square shadow map)
-		1.0f,                  // Near
-		1500.0f                // Far
-	);
+	// Get wrapped planet position (same wrapping used for rendering planets)
+	glm::vec3 wrappedPlanetPos = wrapPlanetPosition(hp.position, eye_center);
 
-	glm::mat4 lightVP = lightProjection * lightView;
+	// calculate position on planet surface using spherical coordinates
+	float theta = h.angle;
+	float phi = h.latitude;  // Latitude angle on planet
 
-	// Update view matrix
-	viewMatrix = glm::lookAt(
-		eye_center,
-		lookat,
-		up
+	// position on unit sphere surface
+	glm::vec3 localSurfacePos(
+		sin(phi) * cos(theta),
+		cos(phi),
+		sin(phi) * sin(theta)
 	);
 
-	// Shadow pass
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-	glViewport(0, 0, shadowMapWidth, shadowMapHeight);
+	// Scale to planet surface and apply run radius factor
+	glm::vec3 surfaceOffset = localSurfacePos * (hp.radius * h.height);
+	// gives a little distance away off the planet so that it does not intersect with the surface and look odd
 
-	// write to depth buffer, not color
-	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-	glClear(GL_DEPTH_BUFFER_BIT);
+	// Final world position
+	glm::vec3 humanoidWorldPos = wrappedPlanetPos + surfaceOffset;
+
+	// orientation to stand upright on planet surface
+	glm::vec3 up_vector = glm::normalize(localSurfacePos);
+	glm::vec3 tangent = glm::normalize(glm::cross(glm::vec3(0, 1, 0), up_vector));
+
+	// handle edge case when up_vector aligns with world Y axis
+	if (glm::length(tangent) < 0.001f) {
+		tangent = glm::vec3(1, 0, 0);
+	}
+	glm::vec3 forward = glm::normalize(glm::cross(up_vector, tangent));
+
+	// given the orientation vectors, make the rotationMatrix for the bot to follow
+	glm::mat4 rotationMatrix = glm::mat4(1.0f);
+	rotationMatrix[0] = glm::vec4(tangent, 0.0f);
+	rotationMatrix[1] = glm::vec4(up_vector, 0.0f);
+	rotationMatrix[2] = glm::vec4(forward, 0.0f);
 
-	// render planets for shadow map
-	glUseProgram(planetProgramID);
-	for (Planet& p : planets) {
-		glm::vec3 wrappedPos = wrapPlanetPosition(p.position);
+	// Scale humanoid proportionally to planet size
+	float humanoidScale = hp.radius * h.scale; // 2x looks a little unrealistic but it's funny to see for the fantasy of the world
 
+	// calculate a correction offset (trial and error procedure, best results approach after much debugging)
+	glm::vec3 botPositionCorrection = h.correction;  // Start with zero
+
+	// correction to the humanoid's world position to bring it towards the chosen planet
+	glm::vec3 correctedHumanoidPos = humanoidWorldPos + botPositionCorrection;
+
+	return glm::translate(glm::mat4(1.0f), correctedHumanoidPos) *
+		rotationMatrix *
+		glm::scale(glm::mat4(1.0f), glm::vec3(humanoidScale));
+}
+
+// Poses of all humanoids at their animTime into humanoidPoses, nothing to do for a baked bot
+static void poseHumanoids() {
+	size_t jointCount = bot.jointCount();
+	if (bot.baked() || jointCount == 0)
+		return;
+	humanoidPoses.resize(humanoids.size() * jointCount);
+	for (size_t i = 0; i < humanoids.size(); ++i) {
+		Humanoid& h = humanoids[i];
+		bot.update(h.animTime, &h.animationCursors);
+		std::copy(bot.skinObjects[0].jointMatrices.begin(), bot.skinObjects[0].jointMatrices.end(),
+				  humanoidPoses.begin() + i * jointCount);
+	}
+}
+
+// Model matrices and bounding spheres of all humanoids
+static void placeHumanoids() {
+	// humanoids stick out of their planet (scale x its radius), the bound is generous since the model gets re-centered
+	humanoidModels.resize(humanoids.size());
+	humanoidBounds.resize(humanoids.size());
+	for (size_t i = 0; i < humanoids.size(); ++i) {
+		const Humanoid& h = humanoids[i];
+		humanoidModels[i] = computeHumanoidModelMatrix(h);
+		humanoidBounds[i] = glm::vec4(glm::vec3(humanoidModels[i][3]), planets[h.planetIndex].radius * h.scale);
+	}
+}
+
+// Model matrices and bounding spheres of all planets, then the ones the camera sees
+static void updatePlanetVisibility() {
+	PROFILE_ZONE("planet visibility");
+
+	planetBounds.resize(planets.size());
+	for (size_t i = 0; i < planets.size(); ++i) {
+		Planet& p = planets[i];
+		glm::vec3 wrappedPos = wrapPlanetPosition(p.position, eye_center);
 		p.modelMatrix =
 			glm::translate(glm::mat4(1.0f), wrappedPos) *
 			glm::rotate(glm::mat4(1.0f), p.rotationAngle, p.rotationAxis) *
 			glm::scale(glm::mat4(1.0f), glm::vec3(p.radius));
+		planetBounds.set(i, wrappedPos, p.radius);	// unit sphere mesh, so the radius bounds it
+	}
 
-		// using lightVP instead of camera MVP
-		glm::mat4 lightMVP = lightVP * p.modelMatrix;
-		glUniformMatrix4fv(planetMatrixID, 1, GL_FALSE, glm::value_ptr(lightMVP));
-		glUniformMatrix4fv(planetModelID, 1, GL_FALSE, glm::value_ptr(p.modelMatrix));
-
-		// pass LightVP to shader
-		GLuint lightVPID = glGetUniformLocation(planetProgramID, "LightVP");
-		glUniformMatrix4fv(lightVPID, 1, GL_FALSE, glm::value_ptr(lightVP));
-
-		glBindVertexArray(sphereVAO);
-		glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+	PROFILE_ZONE("frustum culling");
+	if (sceneConfig.frustumCulling) {
+		cullSpheres(Frustum::fromMatrix(projectionMatrix * viewMatrix), planetBounds, visiblePlanets);
+	} else {
+		visiblePlanets.resize(planets.size());
+		for (size_t i = 0; i < planets.size(); ++i) visiblePlanets[i] = static_cast<uint32_t>(i);
 	}
-	glBindVertexArray(0);
-	glUseProgram(0);
+}
 
-	// render bot shadow pass
-	// ***comments on each line for humanoid rendering are done in the camera pass render***
-	if (humanoidPlanetIndex >= 0 && humanoidPlanetIndex < planets.size()) {
-		const Planet& hp = planets[humanoidPlanetIndex];
-		glm::vec3 wrappedPlanetPos = wrapPlanetPosition(hp.position);
-
-		float theta = humanoidAngle;
-		float phi = glm::radians(25.0f);
-		glm::vec3 localSurfacePos(
-			sin(phi) * cos(theta),
-			cos(phi),
-			sin(phi) * sin(theta)
-		);
-		glm::vec3 surfaceOffset = localSurfacePos * (hp.radius * 0.8f);
-		glm::vec3 humanoidWorldPos = wrappedPlanetPos + surfaceOffset;
-
-		glm::vec3 up_vector = glm::normalize(localSurfacePos);
-		glm::vec3 tangent = glm::normalize(glm::cross(glm::vec3(0, 1, 0), up_vector));
-		if (glm::length(tangent) < 0.001f) {
-			tangent = glm::vec3(1, 0, 0);
+// Splits the view into the shadow cascades and fits a light box to each slice, fills shadowCascades
+static void fitShadowCascades() {
+	PROFILE_ZONE("shadow fit");
+
+	std::vector<float> splits = cascadeSplits(shadowCascadeCount, zNear, sceneConfig.shadowDistance,
+											  sceneConfig.shadowSplitLambda);
+	float sliceNear = zNear;
+	for (int c = 0; c < shadowCascadeCount; ++c) {
+		ShadowCascade& cascade = shadowCascades[c];
+		cascade.splitFar = splits[c];
+
+		glm::vec4 slice = frustumSliceSphere(viewMatrix, glm::radians(FoV), aspectRatio, sliceNear, cascade.splitFar);
+		sliceNear = cascade.splitFar;
+		ShadowFrustum needed;
+		cascade.active = fitShadowCascade(lightDirection, slice, planetBounds, visiblePlanets, humanoidBounds,
+										  shadowMapWidth, needed, cascade.casters);
+		cascade.redraw = cascade.active;
+		if (!cascade.active)
+			continue;
+
+		if (sceneConfig.shadowCaching) {
+			// the cached box still fits and holds the same planets as when it was drawn
+			// (to within a texel, wrapping around the camera does not give back the exact same floats)
+			bool reuse = cascade.cacheValid && cascade.cached.covers(needed);
+			if (reuse) {
+				cullSpheres(cascade.cached.casterBox, planetBounds, cascade.casters);
+				reuse = sphereSetHash(planetBounds, cascade.casters, cascade.cached.texelSize) == cascade.casterHash;
+			}
+			if (reuse) {
+				cascade.redraw = false;
+			} else {
+				PROFILE_ZONE("shadow cache refit");
+				fitShadowCascade(lightDirection, slice, planetBounds, visiblePlanets, humanoidBounds,
+								 shadowMapWidth, cascade.cached, cascade.casters, sceneConfig.shadowCacheMargin);
+				cascade.casterHash = sphereSetHash(planetBounds, cascade.casters, cascade.cached.texelSize);
+				cascade.cacheValid = true;
+				++shadowStaticRedraws;
+			}
+			needed = cascade.cached;
 		}
-		glm::vec3 forward = glm::normalize(glm::cross(up_vector, tangent));
 
-		glm::mat4 rotationMatrix = glm::mat4(1.0f);
-		rotationMatrix[0] = glm::vec4(tangent, 0.0f);
-		rotationMatrix[1] = glm::vec4(up_vector, 0.0f);
-		rotationMatrix[2] = glm::vec4(forward, 0.0f);
+		cascade.lightVP = needed.projection * needed.view;
+		cascade.lightBox = Frustum::fromMatrix(cascade.lightVP);
+		cascade.texelSize = needed.texelSize;
+		// orthographic depth is linear over the range
+		cascade.depthBias = (shadowBias + shadowBiasTexels * needed.texelSize) / needed.depthRange;
+	}
+}
 
-		float humanoidScale = hp.radius * 2.0f;
-		glm::vec3 botPositionCorrection = glm::vec3(1, 0, 1);
-		glm::vec3 correctedHumanoidPos = humanoidWorldPos + botPositionCorrection;
+// Appends the instances of the planets in range, grouped by their level in batchLods (counting sort)
+static void appendPlanetBatch(const std::vector<uint32_t>& range, PlanetBatch& batch) {
+	batch = PlanetBatch();
+	for (uint8_t lod : batchLods)
+		++batch.count[lod];
+	size_t next = planetInstances.size();
+	size_t cursor[MAX_PLANET_LODS];
+	for (int lod = 0; lod < MAX_PLANET_LODS; ++lod) {
+		batch.firstInstance[lod] = cursor[lod] = next;
+		next += batch.count[lod];
+	}
 
-		glm::mat4 humanoidModelMatrix =
-			glm::translate(glm::mat4(1.0f), correctedHumanoidPos) *
-			rotationMatrix *
-			glm::scale(glm::mat4(1.0f), glm::vec3(humanoidScale));
+	planetInstances.resize(next);
+	for (size_t k = 0; k < range.size(); ++k) {
+		const Planet& p = planets[range[k]];
+		PlanetInstance& instance = planetInstances[cursor[batchLods[k]]++];
+		instance.model = p.modelMatrix;
+		instance.radius = p.radius;
+		instance.textureLayer = static_cast<float>(p.textureIndex);
+	}
+}
 
-		bot.render(lightVP, humanoidModelMatrix, lightDirection, lightColor, envColor);
+// Instance data of the visible planets followed by the casters of each cascade, one upload for all passes.
+// The camera picks each planet's level of detail from its projected radius, with hysteresis; a cascade from
+// its radius in shadow map texels, which does not change while the cascade keeps its size so it needs none.
+static void updatePlanetInstances() {
+	PROFILE_ZONE("planet instances");
+
+	planetInstances.clear();
+
+	// pixels per world unit at distance 1
+	float pixelScale = projectionMatrix[1][1] * framebufferHeight * 0.5f;
+	float nearest[MAX_PLANET_LODS];
+	std::fill(nearest, nearest + MAX_PLANET_LODS, zFar);
+	batchLods.resize(visiblePlanets.size());
+	for (size_t k = 0; k < visiblePlanets.size(); ++k) {
+		uint32_t i = visiblePlanets[k];
+		glm::vec3 toPlanet = glm::vec3(planetBounds.x[i], planetBounds.y[i], planetBounds.z[i]) - eye_center;
+		float r = planetBounds.radius[i];
+		float d2 = glm::dot(toPlanet, toPlanet) - r * r;
+		float pixels = d2 > 0.0f ? r * pixelScale / std::sqrt(d2) : INFINITY;
+		planetLods[i] = static_cast<int8_t>(selectSphereLod(pixels, planetLods[i], cameraLodRadius, sceneConfig.lodHysteresis));
+		batchLods[k] = static_cast<uint8_t>(planetLods[i]);
+		nearest[planetLods[i]] = std::min(nearest[planetLods[i]], glm::length(toPlanet) - r);
+	}
+	appendPlanetBatch(visiblePlanets, cameraBatch);
+	for (int lod = 0; lod < MAX_PLANET_LODS; ++lod)
+		cameraBatch.nearest[lod] = std::max(nearest[lod], 0.0f) / zFar;
+
+	for (int c = 0; c < shadowCascadeCount; ++c) {
+		ShadowCascade& cascade = shadowCascades[c];
+		if (!cascade.redraw)
+			continue;
+		batchLods.resize(cascade.casters.size());
+		for (size_t k = 0; k < cascade.casters.size(); ++k) {
+			float texels = planetBounds.radius[cascade.casters[k]] / cascade.texelSize;
+			batchLods[k] = static_cast<uint8_t>(selectSphereLod(texels, -1, shadowLodRadius, 0.0f));
+		}
+		appendPlanetBatch(cascade.casters, cascade.batch);
 	}
-	// end of shadow pass
 
-	// Re-enable color writes
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	// into the next region, the draws of the last frames still read theirs
+	planetInstanceStream.write(planetInstances.data(), planetInstances.size() * sizeof(PlanetInstance));
+}
 
-	// Restore default framebuffer
-	// Camera pass with shadows and lighting
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	int windowWidth, windowHeight;
-	glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
-	glViewport(0, 0, windowWidth, windowHeight);
-	// end shadow pass
+// Instance data of the humanoids the camera sees followed by the ones inside each cascade's light box,
+// one upload for all passes like the planets. The poses animated on the CPU go up once for all of them.
+static void updateBotInstances() {
+	PROFILE_ZONE("bot instances");
+
+	botInstances.clear();
+	cameraBots = 0;
+	for (ShadowCascade& cascade : shadowCascades)
+		cascade.botCount = 0;
+	if (!bot.loaded())
+		return;
+
+	size_t jointCount = bot.jointCount();
+	if (!bot.baked()) {
+		// the bot finished loading after the last updateScene()
+		if (humanoidPoses.size() != humanoids.size() * jointCount)
+			poseHumanoids();
+		bot.uploadPoses(humanoidPoses);
+	}
 
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// a humanoid gets its skinned copy the first time a pass draws it
+	skinnedSlots.assign(humanoids.size(), -1);
+	skinnedHumanoids.clear();
+	auto append = [&](size_t i) {
+		if (skinnedSlots[i] < 0) {
+			skinnedSlots[i] = static_cast<int32_t>(skinnedHumanoids.size());
+			skinnedHumanoids.push_back(static_cast<uint32_t>(i));
+		}
+		BotInstance instance;
+		instance.model = humanoidModels[i];
+		instance.paletteFrame = bot.baked() ? bot.palette.frame(humanoids[i].animTime) : 0.0f;
+		instance.jointBase = bot.poseBase + static_cast<int32_t>(i * jointCount * 3);
+		instance.skinnedSlot = skinnedSlots[i];
+		botInstances.push_back(instance);
+	};
 
-	// Skybox
-	drawSkybox(projectionMatrix, viewMatrix);
-
-	// Procedural planets
-	glUseProgram(planetProgramID);
-	// Set directional light
-	glUniform3fv(glGetUniformLocation(planetProgramID, "lightDir"), 1, glm::value_ptr(lightDirection));
-	glUniform3fv(glGetUniformLocation(planetProgramID, "lightColor"), 1, glm::value_ptr(lightColor));
-	glUniform3fv(glGetUniformLocation(planetProgramID, "envColor"), 1, glm::value_ptr(envColor));
-
-	// fog inclusion
-	GLuint fogEnabledID = glGetUniformLocation(planetProgramID, "fogEnabled");
-	GLuint fogColorID = glGetUniformLocation(planetProgramID, "fogColor");
-	GLuint fogDensityID = glGetUniformLocation(planetProgramID, "fogDensity");
-	GLuint cameraPosID = glGetUniformLocation(planetProgramID, "cameraPosition");
-
-	glUniform1i(fogEnabledID, fogEnabled ? 1 : 0);
-	glUniform3fv(fogColorID, 1, glm::value_ptr(fogColor));
-	glUniform1f(fogDensityID, fogDensity);
-	glUniform3fv(cameraPosID, 1, glm::value_ptr(eye_center));
-
-	// planets rendering
-	for (Planet& p : planets) {
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D,
-					  planetTextures[p.textureIndex]);
-		glUniform1i(planetTextureSampler, 0);
-
-		glm::vec3 wrappedPos = wrapPlanetPosition(p.position);
-
-		// specific planet model matrix, stored for humanoid positioning
-		p.modelMatrix =
-			glm::translate(glm::mat4(1.0f), wrappedPos) *
-				glm::rotate(glm::mat4(1.0f), p.rotationAngle, p.rotationAxis) *
-				glm::scale(glm::mat4(1.0f), glm::vec3(p.radius));
+	Frustum view = Frustum::fromMatrix(projectionMatrix * viewMatrix);
+	float nearest = zFar;
+	for (size_t i = 0; i < humanoids.size(); ++i) {
+		if (sceneConfig.frustumCulling && !view.contains(glm::vec3(humanoidBounds[i]), humanoidBounds[i].w))
+			continue;
+		append(i);
+		nearest = std::min(nearest, glm::length(glm::vec3(humanoidBounds[i]) - eye_center) - humanoidBounds[i].w);
+	}
+	cameraBots = botInstances.size();
+	cameraBotDepth = std::max(nearest, 0.0f) / zFar;
+
+	for (int c = 0; c < shadowCascadeCount; ++c) {
+		ShadowCascade& cascade = shadowCascades[c];
+		cascade.firstBot = botInstances.size();
+		if (!cascade.active)
+			continue;
+		for (size_t i = 0; i < humanoids.size(); ++i) {
+			if (cascade.lightBox.contains(glm::vec3(humanoidBounds[i]), humanoidBounds[i].w))
+				append(i);
+		}
+		cascade.botCount = botInstances.size() - cascade.firstBot;
+	}
 
-		modelMatrix = p.modelMatrix;
+	// slot order, so instance k of this range is skinned into copy k
+	firstSkinnedBot = botInstances.size();
+	if (sceneConfig.skinningPrePass) {
+		for (uint32_t i : skinnedHumanoids)
+			append(i);
+	}
 
-		glm::mat4 MVP = projectionMatrix * viewMatrix * modelMatrix;
+	bot.uploadInstances(botInstances);
+}
 
-		glUniformMatrix4fv(planetMatrixID, 1, GL_FALSE, &MVP[0][0]);
-		glUniformMatrix4fv(planetModelID, 1, GL_FALSE, glm::value_ptr(p.modelMatrix));
+// Skinning pre-pass: every humanoid some pass draws is skinned once, the shadow cascades and the camera
+// pass draw the same copies. Without it (or if they do not fit) each pass skins again in bot.vert.
+static void skinBots() {
+	if (!sceneConfig.skinningPrePass || skinnedHumanoids.empty())
+		return;
 
-		GLuint lightVPID = glGetUniformLocation(planetProgramID, "LightVP");
-		glUniformMatrix4fv(lightVPID, 1, GL_FALSE, glm::value_ptr(lightVP));
+	PROFILE_ZONE("bot skinning");
+	PROFILE_GPU_ZONE("bot skinning");
 
-		// Bind shadow map texture
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, shadowDepthTexture);
-		glUniform1i(glGetUniformLocation(planetProgramID, "shadowMap"), 1);
+	drawBlocks.bind(DRAW_DATA_BINDING, BOT_DRAW_SLOT);
+	bot.skin(firstSkinnedBot, skinnedHumanoids.size());
+}
 
-		glBindVertexArray(sphereVAO);
-		glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+// Fills and uploads both uniform buffers, one glBufferSubData each for the whole frame
+static void updateUniformBlocks() {
+	PROFILE_ZONE("uniform upload");
+
+	FrameData& cameraView = frameBlocks.at<FrameData>(CAMERA_VIEW);
+	cameraView.viewProjection = projectionMatrix * viewMatrix;
+	cameraView.view = viewMatrix;
+	cameraView.projection = projectionMatrix;
+	for (int c = 0; c < MAX_SHADOW_CASCADES; ++c) {
+		const ShadowCascade& cascade = shadowCascades[std::min(c, shadowCascadeCount - 1)];
+		cameraView.lightVP[c] = cascade.lightVP;
+		cameraView.cascadeSplits[c] = cascade.splitFar;
+		cameraView.cascadeBias[c] = cascade.depthBias;
 	}
-	glBindVertexArray(0);
-	glUseProgram(0);
+	cameraView.cascadeCount = shadowCascadeCount;
+	cameraView.lightDir = lightDirection;
+	cameraView.fogEnabled = fogEnabled ? 1 : 0;
+	cameraView.lightColor = lightColor;
+	cameraView.envColor = envColor;
+	cameraView.fogColor = fogColor;
+	cameraView.cameraPosition = eye_center;
+
+	// the light's views only differ in what gets projected
+	for (int c = 0; c < shadowCascadeCount; ++c) {
+		FrameData& shadowView = frameBlocks.at<FrameData>(FIRST_SHADOW_VIEW + c);
+		shadowView = frameBlocks.at<FrameData>(CAMERA_VIEW);
+		shadowView.viewProjection = shadowCascades[c].lightVP;
+	}
+	frameBlocks.upload(1 + shadowCascadeCount);
+
+	// planets take their model matrix from the instance buffer, only the fog density is shared
+	DrawData& planetDraw = drawBlocks.at<DrawData>(PLANET_DRAW_SLOT);
+	planetDraw = DrawData();
+	planetDraw.M = glm::mat4(1.0f);
+	planetDraw.fogDensity = fogDensity;
+	// the humanoids take theirs from the bot's instance buffer
+	drawBlocks.at<DrawData>(BOT_DRAW_SLOT) = bot.drawData();
+	drawBlocks.upload(2);
+}
 
-	// Humanoid rendering
-	if (humanoidPlanetIndex >= 0 && humanoidPlanetIndex < planets.size()) {
-		const Planet& hp = planets[humanoidPlanetIndex];
+// One instanced draw item per level of detail of the batch. Every level shares the program, the sphere VAO and
+// the texture array, so the queue binds those once and orders the levels front to back by batch.nearest.
+// The shadow map goes on unit 1 outside the shadow pass, all planet textures on unit 0, each instance picks its layer
+static void submitPlanetBatch(RenderQueue& queue, const PlanetBatch& batch, bool shadowPass) {
+	DrawItem item;
+	item.program = &planetProgram;
+	item.vao = sphereVAO;
+	item.textures[0] = { GL_TEXTURE_2D_ARRAY, planetTextures.id };
+	// not while a layer of it is the depth attachment
+	if (!shadowPass)
+		item.textures[1] = { GL_TEXTURE_2D_ARRAY, shadowDepthTexture };
+	item.drawSlot = PLANET_DRAW_SLOT;
+	item.zone = shadowPass ? nullptr : "planet pass";
+	item.indexType = sphereIndexType;
+	item.instances = INSTANCES_PLANETS;
+	for (size_t lod = 0; lod < sphereLods.size(); ++lod) {
+		if (batch.count[lod] == 0)
+			continue;
+		const SphereLod& mesh = sphereLods[lod];
+		item.count = mesh.indexCount;
+		item.indexOffset = mesh.firstIndex * sphereIndexSize;
+		item.baseVertex = mesh.baseVertex;
+		item.firstInstance = batch.firstInstance[lod];
+		item.instanceCount = static_cast<GLsizei>(batch.count[lod]);
+		queue.submit(item, LAYER_OPAQUE, batch.nearest[lod]);
+	}
+}
 
-		// Get wrapped planet position (same wrapping used for rendering planets)
-		glm::vec3 wrappedPlanetPos = wrapPlanetPosition(hp.position);
+// Shadow pass: planets and humanoids into each cascade's layer of the shadow map, seen from the light
+static void renderShadowPass() {
+	PROFILE_ZONE("shadow pass");
+	PROFILE_GPU_ZONE("shadow pass");
 
-		// calculate position on planet surface using spherical coordinates
-		float theta = humanoidAngle;
-		float phi = glm::radians(25.0f);  // Latitude angle on planet
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+	glViewport(0, 0, shadowMapWidth, shadowMapHeight);
 
-		// position on unit sphere surface
-		glm::vec3 localSurfacePos(
-			sin(phi) * cos(theta),
-			cos(phi),
-			sin(phi) * sin(theta)
-		);
+	// write to depth buffer, not color
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
-		// Scale to planet surface and apply run radius factor
-		glm::vec3 surfaceOffset = localSurfacePos * (hp.radius * 0.8f);
-		// gives a little distance away off the planet so that it does not intersect with the surface and look odd
+	// nothing here samples the shadow map, and it must not stay bound while its layers are the depth attachment
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glActiveTexture(GL_TEXTURE0);
 
-		// Final world position
-		glm::vec3 humanoidWorldPos = wrappedPlanetPos + surfaceOffset;
+	for (int c = 0; c < shadowCascadeCount; ++c) {
+		const ShadowCascade& cascade = shadowCascades[c];
 
-		// orientation to stand upright on planet surface
-		glm::vec3 up_vector = glm::normalize(localSurfacePos);
-		glm::vec3 tangent = glm::normalize(glm::cross(glm::vec3(0, 1, 0), up_vector));
+		// viewProjection is this cascade's light box for everything drawn into it
+		frameBlocks.bind(FRAME_DATA_BINDING, FIRST_SHADOW_VIEW + c);
 
-		// handle edge case when up_vector aligns with world Y axis
-		if (glm::length(tangent) < 0.001f) {
-			tangent = glm::vec3(1, 0, 0);
+		// the planets go straight into the sampled layer, or into the static one when it has to be redrawn
+		if (cascade.redraw) {
+			PROFILE_ZONE("shadow planets");
+			if (sceneConfig.shadowCaching) {
+				glBindFramebuffer(GL_FRAMEBUFFER, shadowStaticFBO);
+				glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowStaticTexture, 0, c);
+			} else {
+				glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowDepthTexture, 0, c);
+			}
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+			// render the cascade's casters, they sit behind the visible planets in the instance buffer
+			submitPlanetBatch(renderQueue, cascade.batch, true);
+			renderQueue.execute(drawBlocks);
+			glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+		}
+
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowDepthTexture, 0, c);
+		if (!cascade.active) {
+			glClear(GL_DEPTH_BUFFER_BIT);
+			continue;
 		}
-		glm::vec3 forward = glm::normalize(glm::cross(up_vector, tangent));
-
-		// given the orientation vectors, make the rotationMatrix for the bot to follow
-		glm::mat4 rotationMatrix = glm::mat4(1.0f);
-		rotationMatrix[0] = glm::vec4(tangent, 0.0f);
-		rotationMatrix[1] = glm::vec4(up_vector, 0.0f);
-		rotationMatrix[2] = glm::vec4(forward, 0.0f);
-
-		// Scale humanoid proportionally to planet size
-		float humanoidScale = hp.radius * 2.0f; // looks a little unrealistic but it's funny to see for the fantasy of the world
-
-		// calculate a correction offset (trial and error procedure, best results approach after much debugging)
-		glm::vec3 botPositionCorrection = glm::vec3(1, 0, 1);  // Start with zero
-
-		// correction to the humanoid's world position to bring it towards the chosen planet
-		glm::vec3 correctedHumanoidPos = humanoidWorldPos + botPositionCorrection;
-
-		glm::mat4 humanoidModelMatrix =
-			glm::translate(glm::mat4(1.0f), correctedHumanoidPos) *
-			rotationMatrix *
-			glm::scale(glm::mat4(1.0f), glm::vec3(humanoidScale));
-
-		bot.cameraPosition = eye_center;  // Update camera position each frame
-		bot.lightDirection = lightDirection;
-		MyBot::lightColor = lightColor;
-		MyBot::envColor = envColor;
-		MyBot::lightVP = lightVP;
-		MyBot::shadowDepthTexture = shadowDepthTexture;
-		bot.render(projectionMatrix * viewMatrix, humanoidModelMatrix, lightDirection, lightColor, envColor);
-
-		// Debugging sphere to help place the humanoid right at the planet
-		// sphere being mapped with the box shaders was perfectly placed near the planet
-		// so I created this markerSphere to approximate the distance to the bot that had an additional offset
-		// given by the joints' set up
-		// I left the code commented instead of removing it for the importance it had during debugging
-
-		// glm::mat4 markerModel =
-		// 	glm::translate(glm::mat4(1.0f), humanoidWorldPos) *
-		// 	glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));   // relatively small
-		// glm::mat4 markerMVP = projectionMatrix * viewMatrix * markerModel;
-		// glUseProgram(planetProgramID);
-		// glUniformMatrix4fv(planetMatrixID, 1, GL_FALSE, &markerMVP[0][0]);
-		// glUniformMatrix4fv(planetModelID,  1, GL_FALSE, &markerModel[0][0]);
-		// glBindVertexArray(sphereVAO);
-		// glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
-		// glBindVertexArray(0);
-		// glUseProgram(0);
+		if (sceneConfig.shadowCaching) {
+			// start from the cached planets, the humanoids move so they are drawn every frame
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, shadowStaticFBO);
+			glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowStaticTexture, 0, c);
+			glBlitFramebuffer(0, 0, shadowMapWidth, shadowMapHeight, 0, 0, shadowMapWidth, shadowMapHeight,
+							  GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, shadowFBO);
+		}
+
+		// render bot shadow pass, the humanoids inside the light box
+		bot.submit(renderQueue, BOT_DRAW_SLOT, cascade.firstBot, cascade.botCount, 0.0f, true);
+		renderQueue.execute(drawBlocks);
 	}
+
+	// Re-enable color writes
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// Camera pass: skybox, planets and humanoids go through the queue together, so the planet levels
+// are drawn front to back and the skybox only where they left the far plane
+static void renderCameraPass() {
+	// the planet, bot and skybox items open their own CPU and GPU zones in execute()
+	PROFILE_ZONE("camera pass");
+
+	// planets rendering, only the instances that survived frustum culling, one draw per level of detail
+	submitPlanetBatch(renderQueue, cameraBatch, false);
+	planetTriangles = 0;
+	for (size_t lod = 0; lod < sphereLods.size(); ++lod)
+		planetTriangles += cameraBatch.count[lod] * sphereLods[lod].indexCount / 3;
+
+	// the humanoids that survived frustum culling, one instanced draw per primitive
+	bot.submit(renderQueue, BOT_DRAW_SLOT, 0, cameraBots, cameraBotDepth, false);
+
+	// Debugging sphere to help place the humanoid right at the planet
+	// sphere being mapped with the box shaders was perfectly placed near the planet
+	// so I created this markerSphere to approximate the distance to the bot that had an additional offset
+	// given by the joints' set up
+	// I left the code commented instead of removing it for the importance it had during debugging
+
+	// glm::mat4 markerModel =
+	// 	glm::translate(glm::mat4(1.0f), humanoidWorldPos) *
+	// 	glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));   // relatively small
+	// planetProgram.use();
+	// (markerModel goes into the instance buffer as one more planet)
+	// glBindVertexArray(sphereVAO);
+	// glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+	// glBindVertexArray(0);
+	// glUseProgram(0);
+
+	submitSkybox(renderQueue);
+	renderQueue.execute(drawBlocks);
+	cameraDrawItems = renderQueue.executedItems;
+	cameraStateChanges = renderQueue.stateChanges;
+}
+
+void render() {
+	// Update view matrix
+	viewMatrix = glm::lookAt(
+		eye_center,
+		lookat,
+		up
+	);
+
+	// what the camera sees, then the light boxes of the shadow cascades fitted to it (the sun is
+	// directional, so orthographic boxes instead of the old 90 degree perspective behind the camera)
+	updatePlanetVisibility();
+	placeHumanoids();
+	fitShadowCascades();
+
+	// everything the shaders need this frame, the passes only bind ranges of it
+	updatePlanetInstances();
+	updateBotInstances();
+	updateUniformBlocks();
+
+	// skin the humanoids once for all passes
+	skinBots();
+
+	// Shadow pass
+	renderShadowPass();
+
+	// Restore default framebuffer
+	// Camera pass with shadows and lighting
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glViewport(0, 0, framebufferWidth, framebufferHeight);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	frameBlocks.bind(FRAME_DATA_BINDING, CAMERA_VIEW);
+
+	// Skybox, procedural planets and humanoids
+	renderCameraPass();
 }
 
 void cleanup() {
+	// nothing may upload into the objects deleted below
+	assetLoader.stop();
+
 	//Cleanup for all models
 
 	// Skybox
@@ -818,18 +1151,35 @@ void cleanup() {
 	glDeleteBuffers(1, &skyboxVertexBuffer);
 	glDeleteBuffers(1, &skyboxUVBuffer);
 	glDeleteBuffers(1, &skyboxIndexBuffer);
-	glDeleteProgram(skyboxProgramID);
+	skyboxProgram.destroy();
 	glDeleteTextures(1, &skyboxTextureID);
 
 	//planets
 	glDeleteVertexArrays(1, &sphereVAO);
 	glDeleteBuffers(1, &sphereVBO);
 	glDeleteBuffers(1, &sphereEBO);
-	glDeleteProgram(planetProgramID);
-	glDeleteTextures(NUM_PLANET_TEXTURES, planetTextures);
+	planetInstanceStream.destroy();
+	planetProgram.destroy();
+	planetTextures.destroy();
+
+	// uniform blocks
+	frameBlocks.destroy();
+	drawBlocks.destroy();
+
+	// shadow map
+	glDeleteFramebuffers(1, &shadowFBO);
+	glDeleteTextures(1, &shadowDepthTexture);
+	glDeleteFramebuffers(1, &shadowStaticFBO);
+	glDeleteTextures(1, &shadowStaticTexture);
+	shadowFBO = shadowDepthTexture = shadowStaticFBO = shadowStaticTexture = 0;
+	invalidateShadowCache();
 
 	//humanoid
 	bot.cleanup();
+	humanoids.clear();
+	humanoidPoses.clear();
+	botInstances.clear();
+	skinnedHumanoids.clear();
 }
 
 // removed the scancode and mode arguments from the labs definition of key_callbacks() because they were never used
@@ -841,7 +1191,6 @@ static void key_callback(GLFWwindow* w, int key, int, int action, int) {
 	if (key == GLFW_KEY_F && action == GLFW_PRESS) {
 		// Toggle fog on/off
 		fogEnabled = !fogEnabled;
-		bot.fogEnabled = fogEnabled;
 		// can see it in the terminal
 		std::cout << "Fog " << (fogEnabled ? "enabled" : "disabled") << std::endl;
 	}
@@ -863,9 +1212,252 @@ static void key_callback(GLFWwindow* w, int key, int, int action, int) {
 	}
 }
 
-int main() {
-	// time based randomizer, got it from Google (I assume gemini) since a normal srand(i.e 42) randomizer would start getting repetitive
-	std::srand(static_cast<unsigned int>(std::time(nullptr)) ^ uintptr_t(&main));
+// advance animations and planet spin by dt (shared by the window loop, headless mode and the bench)
+void updateScene(float dt) {
+	// update humanoid animations
+	{
+		PROFILE_ZONE("animation update");
+		for (Humanoid& h : humanoids) {
+			h.angle += h.angularSpeed * dt;
+			h.animTime += dt * h.playbackSpeed;
+		}
+		// a baked bot looks the pose up by animTime while drawing
+		poseHumanoids();
+	}
+
+	// update planet rotations
+	{
+		PROFILE_ZONE("planet rotation update");
+		for (Planet& p : planets) {
+			p.rotationAngle += p.rotationSpeed * dt;
+		}
+	}
+}
+
+// keyboard camera controls, only used with a window
+static void processInput(float dt) {
+	PROFILE_ZONE("input");
+
+	// left shift key to increase speed if exploration is too slow
+	float currentSpeed = speed;
+	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+		currentSpeed *= speedBoost;
+
+	glfwPollEvents();
+
+	// camera rotation with left, right, up and down key arrows
+	if (glfwGetKey(window, GLFW_KEY_LEFT)  == GLFW_PRESS) yaw   -= 1.5f * dt;
+	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) yaw   += 1.5f * dt;
+	if (glfwGetKey(window, GLFW_KEY_UP)    == GLFW_PRESS) pitch += 1.0f * dt;
+	if (glfwGetKey(window, GLFW_KEY_DOWN)  == GLFW_PRESS) pitch -= 1.0f * dt;
+	pitch = glm::clamp(pitch, -1.3f, 1.3f); // prevents camera from flipping
+
+	// camera translation (WASD and QE)
+	glm::vec3 forward = forwardDir();
+	glm::vec3 right = rightDir();
+
+	// WASD for forward, left, backward, and right respectively
+	// QE for up and down respectively
+	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) eye_center += forward * currentSpeed * dt;
+	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) eye_center -= forward * currentSpeed * dt;
+	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) eye_center -= right * currentSpeed * dt;
+	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) eye_center += right * currentSpeed * dt;
+	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) eye_center += up  * currentSpeed * dt;
+	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) eye_center -= up  * currentSpeed * dt;
+}
+
+// clear and draw one frame into sceneFramebuffer
+void drawFrame() {
+	PROFILE_ZONE("render");
+
+	// whatever the workers finished since the last frame, as far as the budget goes
+	assetLoader.pump(sceneConfig.uploadBudgetMs);
+
+	// wrap camera position for the infinite world effect
+	wrapPosition(eye_center, WORLD_SIZE);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glViewport(0, 0, framebufferWidth, framebufferHeight);
+
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	lookat = eye_center + forwardDir();
+	render();
+}
+
+void setRenderTarget(GLuint framebuffer, int width, int height) {
+	sceneFramebuffer = framebuffer;
+	framebufferWidth = width;
+	framebufferHeight = height;
+}
+
+void setCamera(const glm::vec3& eye, float cameraYaw, float cameraPitch) {
+	eye_center = eye;
+	yaw = cameraYaw;
+	pitch = glm::clamp(cameraPitch, -1.3f, 1.3f);
+}
+
+size_t placedPlanetCount() {
+	return planets.size();
+}
+
+size_t visiblePlanetCount() {
+	return visiblePlanets.size();
+}
+
+size_t planetTriangleCount() {
+	return planetTriangles;
+}
+
+size_t shadowCacheRedraws() {
+	return shadowStaticRedraws;
+}
+
+size_t drawItemCount() {
+	return cameraDrawItems;
+}
+
+size_t stateChangeCount() {
+	return cameraStateChanges;
+}
+
+void waitForAssets() {
+	assetLoader.finish();
+}
+
+int bakeTextureCache(bool compress) {
+	std::vector<std::string> paths(planetTexturePaths, planetTexturePaths + NUM_PLANET_TEXTURES);
+	paths.push_back(SKYBOX_TEXTURE_PATH);
+
+	// same loader as a launch, the "upload" only reports, so no GL context is needed
+	int failed = 0;
+	assetLoader.start();
+	for (const std::string& path : paths) {
+		assetLoader.loadTexture(path, ASSET_CACHE_DIR, compress, [path, compress, &failed](const TextureData& texture) {
+			if (!texture.valid()) {
+				failed++;
+				return;
+			}
+			std::cout << "Cached " << path << " -> " << textureCachePath(path, ASSET_CACHE_DIR, compress)
+					  << " (" << texture.levels.size() << " levels)" << std::endl;
+		});
+	}
+	assetLoader.finish();
+	assetLoader.stop();
+	return failed;
+}
+
+int bakeModelCache() {
+	// only the bot for now, imported the way bot.initialize() does on a cache miss
+	ModelData model;
+	if (!loadModel(BOT_MODEL_PATH, ASSET_CACHE_DIR, model))
+		return 1;
+	std::cout << "Cached " << BOT_MODEL_PATH << " -> " << modelCachePath(BOT_MODEL_PATH, ASSET_CACHE_DIR) << " ("
+			  << model.primitives.size() << " primitives, " << model.clips.size() << " animations)" << std::endl;
+	return 0;
+}
+
+// cloudWorld_bench builds this file too and brings its own main()
+#ifndef CLOUDWORLD_BENCH
+
+// Offscreen run: fixed number of frames with a fixed dt, selected frames go to PNG
+// and are optionally checked against golden images.
+// Returns 0 on success, 1 if any frame differs from its golden image, HEADLESS_UNAVAILABLE without a context
+// (or the --golden-renderer), -1 on other setup errors
+static int runHeadless(const RunOptions& options) {
+	HeadlessContext ctx;
+	if (!createHeadlessContext(ctx, options.width, options.height)) {
+		return HEADLESS_UNAVAILABLE;
+	}
+	// golden images only hold on the renderer they were captured with
+	const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	if (!options.goldenRenderer.empty() && (!renderer || !std::strstr(renderer, options.goldenRenderer.c_str()))) {
+		std::cerr << "Renderer " << (renderer ? renderer : "?") << " is not " << options.goldenRenderer
+				  << ", skipping the golden comparison" << std::endl;
+		destroyHeadlessContext(ctx);
+		return HEADLESS_UNAVAILABLE;
+	}
+	setRenderTarget(ctx.framebuffer, ctx.width, ctx.height);
+
+	glEnable(GL_DEPTH_TEST);
+
+	init();
+	// frames must not depend on how fast the workers were
+	waitForAssets();
+
+	if (!options.profilePath.empty())
+		profiler.beginSession(options.profilePath);
+
+	for (int frame : options.captureFrames) {
+		if (frame < 0 || frame >= options.frames)
+			std::cerr << "Capture frame " << frame << " is outside the " << options.frames << " rendered frames" << std::endl;
+	}
+
+	int mismatches = 0;
+	bool writeFailed = false;
+	for (int frame = 0; frame < options.frames; ++frame) {
+		profiler.beginFrame();
+		updateScene(options.fixedDt);
+		drawFrame();
+		profiler.endFrame();
+
+		if (std::find(options.captureFrames.begin(), options.captureFrames.end(), frame) == options.captureFrames.end())
+			continue;
+
+		std::string name = captureFileName(frame);
+		std::string path = options.outputDir + "/" + name;
+		if (!writeFramebufferPNG(path, sceneFramebuffer, framebufferWidth, framebufferHeight)) {
+			writeFailed = true;
+			continue;
+		}
+		if (!options.goldenDir.empty() && !compareWithGolden(path, options.goldenDir + "/" + name, options)) {
+			mismatches++;
+		}
+	}
+
+	profiler.endSession();
+	cleanup();
+	destroyHeadlessContext(ctx);
+
+	if (writeFailed) {
+		return -1;
+	}
+	if (mismatches > 0) {
+		std::cerr << mismatches << " frame(s) differ from the golden images" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	RunOptions options;
+	if (!parseRunOptions(argc, argv, options)) {
+		return -1;
+	}
+
+	if (options.hasSeed || options.headless) {
+		// fixed seed, init() builds the same planet field on every run
+		std::srand(options.seed);
+	} else {
+		// time based randomizer, got it from Google (I assume gemini) since a normal srand(i.e 42) randomizer would start getting repetitive
+		std::srand(static_cast<unsigned int>(std::time(nullptr)) ^ uintptr_t(&main));
+	}
+
+	sceneConfig.compressTextures = options.compressTextures;
+	if (options.planets >= 0)
+		sceneConfig.numPlanets = options.planets;
+	if (options.planetDistance >= 0.0f)
+		sceneConfig.minPlanetDistance = options.planetDistance;
+	if (options.bakeTextures || options.bakeModels) {
+		int failed = options.bakeTextures ? bakeTextureCache(options.compressTextures) : 0;
+		failed += options.bakeModels ? bakeModelCache() : 0;
+		return failed == 0 ? 0 : 1;
+	}
+
+	if (options.headless) {
+		return runHeadless(options);
+	}
 
 	// Init GLFW
 	if (!glfwInit()) {
@@ -879,7 +1471,7 @@ int main() {
 
 	// Open window and create its OpenGL context
 	// CLion recommended using nullptr instead of NULL for the monitor and share arguments
-	window = glfwCreateWindow(1280, 720, "Space World", nullptr, nullptr);
+	window = glfwCreateWindow(options.width, options.height, "Space World", nullptr, nullptr);
 	if (!window) {
 		std::cerr << "Failed to create window\n";
 		glfwTerminate();
@@ -894,11 +1486,15 @@ int main() {
 		std::cerr << "Failed to init GLAD\n";
 		return -1;
 	}
+	loadBufferStorage(glfwGetProcAddress);
 
 	glEnable(GL_DEPTH_TEST);
 
 	init();
 
+	if (!options.profilePath.empty())
+		profiler.beginSession(options.profilePath);
+
 	double lastTime = glfwGetTime();
 
 	// frame rate tracking as in lab4
@@ -910,57 +1506,14 @@ int main() {
 		// delta time calculation
 		double now = glfwGetTime();
 		float dt = float(now - lastTime);
-
-		// update humanoid animations
-		humanoidAngle += humanoidAngularSpeed * dt;
-		botAnimTime += dt * playbackSpeed;
-		bot.update(botAnimTime);
-
-		// update planet rotations
-		for (Planet& p : planets) {
-			p.rotationAngle += p.rotationSpeed * dt;
-		}
-
-		// left shift key to increase speed if exploration is too slow
-		float currentSpeed = speed;
-		if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-			currentSpeed *= speedBoost;
-
 		lastTime = now;
-		glfwPollEvents();
 
-		// camera rotation with left, right, up and down key arrows
-		if (glfwGetKey(window, GLFW_KEY_LEFT)  == GLFW_PRESS) yaw   -= 1.5f * dt;
-		if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) yaw   += 1.5f * dt;
-		if (glfwGetKey(window, GLFW_KEY_UP)    == GLFW_PRESS) pitch += 1.0f * dt;
-		if (glfwGetKey(window, GLFW_KEY_DOWN)  == GLFW_PRESS) pitch -= 1.0f * dt;
-		pitch = glm::clamp(pitch, -1.3f, 1.3f); // prevents camera from flipping
+		profiler.beginFrame();
+		updateScene(dt);
+		processInput(dt);
 
-		// camera translation (WASD and QE)
-		glm::vec3 forward = forwardDir();
-		glm::vec3 right = rightDir();
-
-		// WASD for forward, left, backward, and right respectively
-		// QE for up and down respectively
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) eye_center += forward * currentSpeed * dt;
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) eye_center -= forward * currentSpeed * dt;
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) eye_center -= right * currentSpeed * dt;
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) eye_center += right * currentSpeed * dt;
-		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) eye_center += up  * currentSpeed * dt;
-		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) eye_center -= up  * currentSpeed * dt;
-
-		// wrap camera position for the infinite world effect
-		wrapPosition(eye_center, WORLD_SIZE);
-
-		int w, h;
-		glfwGetFramebufferSize(window, &w, &h);
-		glViewport(0, 0, w, h);
-
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		lookat = eye_center + forwardDir();
-		render();
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+		drawFrame();
 
 		// FPS increment
 		frames++;
@@ -977,14 +1530,21 @@ int main() {
 		}
 
 		// since I do a standard while loop, the swapping of buffers is done during the loop
-		glfwSwapBuffers(window);
+		{
+			PROFILE_ZONE("swap");
+			glfwSwapBuffers(window);
+		}
+		profiler.endFrame();
 	}
 
 	// clean up for all models
+	profiler.endSession();
 	cleanup();
 
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
 
 	return 0;
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef animation_h
+#define animation_h
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// GLTF model structures only, the loader implementation lives with the model importer (model_cache.cpp)
+#include <tiny_gltf.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Node hierarchy and keyframe animation for glTF models (cloudworld_core, no GL)
+
+struct SamplerObject {
+    std::vector<float> input;
+    std::vector<glm::vec4> output;
+    int interpolation;
+};
+
+struct ChannelObject {
+    int sampler;
+    std::string targetPath;
+    int targetNode;
+};
+
+struct AnimationObject {
+    std::vector<SamplerObject> samplers; // Animation data
+};
+
+// Local TRS (or matrix) transform of a node
+glm::mat4 getNodeTransform(const tinygltf::Node& node);
+
+// Fills localTransforms for nodeIndex and all its descendants
+void computeLocalNodeTransform(
+    const tinygltf::Model& model,
+    int nodeIndex,
+    std::vector<glm::mat4>& localTransforms
+);
+
+// globalTransforms[n] = parentTransform * localTransforms[n], recursively for the subtree at nodeIndex
+void computeGlobalNodeTransform(
+    const tinygltf::Model& model,
+    const std::vector<glm::mat4>& localTransforms,
+    int nodeIndex,
+    const glm::mat4& parentTransform,
+    std::vector<glm::mat4>& globalTransforms
+);
+
+// Keyframe k with times[k] <= animationTime < times[k + 1]
+int findKeyframeIndex(const std::vector<float>& times, float animationTime);
+
+// Reads sampler times and values out of the glTF buffers
+std::vector<AnimationObject> prepareAnimation(const tinygltf::Model& model);
+
+// Accumulates the interpolated channel transforms of anim at time into nodeTransforms
+// (straight from the glTF data every call, playback goes through compileAnimation() and sampleClip() instead)
+void updateAnimation(
+    const tinygltf::Model& model,
+    const tinygltf::Animation& anim,
+    const AnimationObject& animationObject,
+    float time,
+    std::vector<glm::mat4>& nodeTransforms
+);
+
+// Animation compiled at load time: every channel resolved into a flat table with its keys copied out,
+// so playback neither compares target strings nor walks the glTF accessors
+
+enum AnimationTarget { TARGET_TRANSLATION, TARGET_ROTATION, TARGET_SCALE };
+enum AnimationInterpolation { INTERPOLATION_LINEAR, INTERPOLATION_STEP };   // CUBICSPLINE plays as linear
+
+struct ClipChannel {
+    int node;
+    AnimationTarget target;
+    AnimationInterpolation interpolation;
+    uint32_t firstKey;      // into AnimationClip::times and values
+    uint32_t keyCount;
+};
+
+struct AnimationClip {
+    std::vector<ClipChannel> channels;
+    std::vector<float> times;
+    std::vector<glm::vec4> values;  // xyz for translation and scale, the quaternion (x, y, z, w) for rotation
+    float duration = 0.0f;          // last key of the longest channel
+};
+
+// Local transform of a node as translation, rotation and scale, the default is the identity
+struct NodePose {
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    // T * R * S
+    glm::mat4 matrix() const;
+};
+
+// Channels with an unknown target or node, or without keys, are left out
+AnimationClip compileAnimation(
+    const tinygltf::Model& model,
+    const tinygltf::Animation& anim,
+    const AnimationObject& animationObject
+);
+
+// Writes the animated parts of each node's pose at time, the rest keeps its value.
+// Every channel wraps around its own last key like updateAnimation(), but holds the first key until it starts.
+// cursors is the key each channel used last (keep one per character, it is resized as needed): moving on from
+// there is O(1) while time goes forward, only a jump (the loop wrapping around) searches the keys again.
+void sampleClip(const AnimationClip& clip, float time, std::vector<uint32_t>& cursors, std::vector<NodePose>& pose);
+
+// Node hierarchy under a skin's root flattened at load time: parents always come before their children,
+// so the global transforms are one linear loop instead of a recursion through tinygltf::Node::children
+struct Skeleton {
+    std::vector<int> nodes;         // glTF node of each entry, in hierarchy order
+    std::vector<int> parents;       // entry of the parent, -1 for the root
+    std::vector<int> jointEntries;  // entry of skin.joints[j]
+
+    size_t size() const { return nodes.size(); }
+};
+
+// Breadth first from skin.joints[0] (the bot's root joint), joints outside that subtree are left at the root
+Skeleton flattenSkeleton(const tinygltf::Model& model, const tinygltf::Skin& skin);
+
+// globals[e] = globals[parents[e]] * pose[nodes[e]].matrix(), globals needs skeleton.size() entries
+void composeSkeleton(const Skeleton& skeleton, const std::vector<NodePose>& pose, std::vector<glm::mat4>& globals);
+
+// Top three rows of an affine matrix as the columns of a 3x4 matrix (the bottom row is always 0 0 0 1):
+// what the shaders get for each joint, v * rows in GLSL transforms a vec4 into a vec3
+glm::mat3x4 affineRows(const glm::mat4& m);
+
+// jointMatrices[j] = affineRows(globals[jointEntries[j]] * inverseBindMatrices[j]), jointMatrices must be sized already
+void skinJoints(
+    const Skeleton& skeleton,
+    const std::vector<glm::mat4>& globals,
+    const std::vector<glm::mat4>& inverseBindMatrices,
+    std::vector<glm::mat3x4>& jointMatrices
+);
+
+// Joint matrices of one skin sampled at a fixed rate over a whole animation, so drawing a pose is a lookup.
+// Row f holds the pose at f / frameRate, every joint matrix as its affineRows() (3 texels of 4 floats),
+// the last row is the first pose again so the loop blends back smoothly.
+struct JointPalette {
+    int jointCount = 0;
+    int frameCount = 0;
+    float frameRate = 0.0f;     // rows per second, the requested rate rounded so the rows split the clip evenly
+    float duration = 0.0f;      // of the clip, time wraps around it like sampleClip() does
+    std::vector<glm::vec4> texels;  // frameCount * jointCount * 3
+
+    bool empty() const { return frameCount == 0; }
+    // palette row (with the fraction to the next one) at time, wrapped into the clip
+    float frame(float time) const;
+};
+
+// Samples clip at about sampleRate poses per second (nodes it does not animate stay at the identity, like the bot's update())
+// with joint matrices global * inverseBind like the bot's skinning (root at skin.joints[0])
+JointPalette bakeJointPalette(
+    const tinygltf::Model& model,
+    const AnimationClip& clip,
+    const tinygltf::Skin& skin,
+    const std::vector<glm::mat4>& inverseBindMatrices,
+    float sampleRate
+);
+
+// Same from a skeleton flattened (or loaded, see model_cache.h) ahead of time, nodeCount is the size of a pose
+JointPalette bakeJointPalette(
+    const Skeleton& skeleton,
+    size_t nodeCount,
+    const AnimationClip& clip,
+    const std::vector<glm::mat4>& inverseBindMatrices,
+    float sampleRate
+);
+
+#endif
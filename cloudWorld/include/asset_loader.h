@@ -0,0 +1,54 @@
+#ifndef asset_loader_h
+#define asset_loader_h
+#pragma once
+
+#include "mpmc_queue.h"
+#include "texture_cache.h"
+#include "worker_pool.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Background asset loading: decode/parse on a worker pool, GL uploads on the GL thread.
+// Finished requests are handed to the GL thread through a lock-free queue and uploaded by pump(),
+// which stops once the frame's time budget is used, so the window keeps drawing while assets stream in.
+struct AssetLoader {
+    void start(unsigned threads = 0);
+
+    // drops whatever is still queued or waiting for upload
+    void stop();
+
+    // decode runs on a worker (no GL!), upload runs later on the GL thread inside pump()
+    void submit(std::function<void()> decode, std::function<void()> upload);
+
+    // Texture through the cache (loadTexture() in texture_cache.h) on a worker, onReady gets it on the
+    // GL thread, texture.valid() is false if it could not be loaded
+    void loadTexture(const std::string& path, const std::string& cacheDir, bool compress,
+                     std::function<void(const TextureData&)> onReady);
+
+    // GL thread: uploads finished requests until budgetMs is spent (at least one per call)
+    // returns the number of requests still in flight
+    size_t pump(double budgetMs);
+
+    // GL thread: blocks until every request so far has been uploaded (headless runs, benchmarks)
+    void finish();
+
+    size_t pending() const { return inFlight.load(); }
+
+    ~AssetLoader() { stop(); }
+
+private:
+    struct Request {
+        std::function<void()> decode;
+        std::function<void()> upload;
+    };
+
+    WorkerPool workers;
+    MPMCQueue<std::shared_ptr<Request>> ready{256};
+    std::atomic<size_t> inFlight{0};
+    std::atomic<bool> stopping{false};  // lets workers give up on a full queue nobody drains anymore
+};
+
+#endif
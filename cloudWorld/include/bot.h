@@ -9,11 +9,17 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 
-// GLTF model loader
-#include <tiny_gltf.h>
-
 #include <render/shader.h>
 
+#include "animation.h"
+#include "asset_loader.h"
+#include "frame_data.h"
+#include "mesh.h"
+#include "mesh_arena.h"
+#include "model_cache.h"
+#include "render_queue.h"
+#include "stream_buffer.h"
+
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -23,52 +29,71 @@
 
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
-// Lighting
-static glm::vec3 lightIntensity(5e6f, 5e6f, 5e6f);
-static glm::vec3 lightPosition(-275.0f, 500.0f, 800.0f);
+// The bot's glTF, imported into the model cache (model_cache.h) on the first launch or by --bake-models
+const char* const BOT_MODEL_PATH = "../cloudWorld/assets/models/bot/bot.gltf";
 
-// Animation
-static bool playAnimation = true;
-static float playbackSpeed = 2.0f;
+// Per humanoid vertex attributes, a crowd of them goes out in one instanced draw per primitive and pass
+struct BotInstance {
+    glm::mat4 model;
+    float paletteFrame;     // baked animation: JointPalette::frame() of its animation time
+    int32_t jointBase;      // otherwise: first texel of its pose in the joint buffer (3 per joint)
+    int32_t skinnedSlot;    // its copy skinned by skin(), when the passes draw those
+};
 
 struct MyBot {
-    // Shader variable IDs
-    GLuint mvpMatrixID;
-    GLuint jointMatricesID;
-    GLuint lightPositionID;
-    GLuint lightIntensityID;
-    GLuint programID;
-    GLuint modelMatrixID;
-
-    tinygltf::Model model;
+    // Shader, scene state and per-draw data come from the FrameData/DrawData blocks
+    ShaderProgram program;
 
     // New attributes
     // Model dimensions used for positioning
-    glm::vec3 modelCenter;
-    float modelScale;
-    glm::vec3 skeletonOffset;  // Manual offset to center skeleton
+    glm::vec3 modelCenter = glm::vec3(0.0f);
+    float modelScale = 1.0f;
+    glm::vec3 skeletonOffset = glm::vec3(0.0f);  // Manual offset to center skeleton
 
     // The bot should also be affected by the fog of the planets so I apply it as well
-    bool fogEnabled;
-    glm::vec3 fogColor;
+    // (on/off, color, light and camera are shared through FrameData, the density is the bot's own)
     float fogDensity;
-    glm::vec3 cameraPosition;
-
-    // Directional and hemi-environment lighting like the planets
-    static glm::vec3 lightDirection;
-    static glm::vec3 lightColor;
-    static glm::vec3 envColor;
 
-    // Shadow mapping
-    static glm::mat4 lightVP;
-    static GLuint shadowDepthTexture;
-
-    // Each VAO corresponds to each mesh primitive in the GLTF model
+    // Shadow mapping, the scene's cascades
+    GLuint shadowDepthTexture = 0;
+
+    // Crowd: every humanoid is an instance of the one model. The instance stream holds consecutive
+    // ranges (one per pass), submit() points the instance attributes of each VAO at the range it draws.
+    StreamBuffer instanceStream;
+    // poses animated on the CPU, mat3x4 rows of every instance, read by bot.vert as a buffer texture
+    // over the whole stream, this frame's poses start at texel poseBase
+    StreamBuffer jointStream;
+    GLuint jointTexture = 0;
+    GLuint jointTextureBuffer = 0;  // the stream's buffer jointTexture is attached to
+    GLint poseBase = 0;
+
+    // Skinning pre-pass: skin() runs bot_skinning.vert once per humanoid and captures the world space
+    // vertices with transform feedback (16 bytes each), the passes then draw them with bot_skinned.vert
+    // instead of skinning again in every one of them
+    ShaderProgram skinningProgram;
+    ShaderProgram skinnedProgram;
+    UniformHandle skinningBakedID;
+    UniformHandle skinnedBaseID;
+    UniformHandle skinnedVertexCountID;
+    GLuint skinnedBuffer = 0;
+    GLuint skinnedTexture = 0;
+    GLint maxSkinnedTexels = 0;     // GL_MAX_TEXTURE_BUFFER_SIZE, queried once by initialize()
+    size_t skinnedCopies = 0;       // made by the last skin(), 0 until then and after uploadInstances()
+
+    // Every primitive of the model, in draw order (ModelData::primitives). Their packed, reordered streams
+    // come straight from the model cache into the mesh arena, primitives in the same arena block share its VAO.
     struct PrimitiveObject {
-        GLuint vao;
-        std::map<int, GLuint> vbos;
+        GLuint vao;             // of its arena block
+        GLsizei indexCount;
+        GLenum indexType;       // GL_UNSIGNED_SHORT when the primitive has few enough vertices
+        size_t indexOffset;     // bytes into the block's index buffer
+        GLint baseVertex;       // first vertex in the block's vertex buffer
+        GLsizei vertexCount;
+        GLint skinnedBase;      // first texel of its skinned copies, set by skin()
     };
     std::vector<PrimitiveObject> primitiveObjects;
+    MeshArena meshArena;
+    std::vector<GLuint> arenaVAOs;  // one per arena block
 
     // Skinning
     struct SkinObject {
@@ -78,98 +103,81 @@ struct MyBot {
         // Transforms the geometry following the movement of the joints
         std::vector<glm::mat4> globalJointTransforms;
 
-        // Combined transforms
-        std::vector<glm::mat4> jointMatrices;
+        // Combined transforms, as the 3x4 rows the shader gets (affineRows() in animation.h)
+        std::vector<glm::mat3x4> jointMatrices;
     };
     std::vector<SkinObject> skinObjects;
 
-    // Animation
-    struct SamplerObject {
-        std::vector<float> input;
-        std::vector<glm::vec4> output;
-        int interpolation;
-    };
-    struct ChannelObject {
-        int sampler;
-        std::string targetPath;
-        int targetNode;
-    };
-    struct AnimationObject {
-        std::vector<SamplerObject> samplers; // Animation data
-    };
-    std::vector<AnimationObject> animationObjects;
-
-    glm::mat4 getNodeTransform(const tinygltf::Node& node);
+    // Animation (the keyframe code lives in animation.h)
+    std::vector<AnimationClip> clips;           // compiled by the importer, what update() plays
+    std::vector<uint32_t> playbackCursors;      // update()'s keyframe cursors when the caller has none
 
-    void computeLocalNodeTransform(
-        const tinygltf::Model& model,
-        int nodeIndex,
-        std::vector<glm::mat4>& localTransforms
-    );
+    // First skin's hierarchy flattened, and the buffers update() works in (sized once in setupModel())
+    Skeleton skeleton;
+    std::vector<NodePose> pose;                 // per glTF node
+    std::vector<glm::mat4> skeletonGlobals;     // per skeleton entry
 
-    void computeGlobalNodeTransform(
-        const tinygltf::Model& model,
-        const std::vector<glm::mat4>& localTransforms,
-        int nodeIndex,
-        const glm::mat4& parentTransform,
-        std::vector<glm::mat4>& globalTransforms
-    );
+    // Baked animation: the first animation as a joint palette (animation.h) in an RGBA32F texture,
+    // bot.vert looks the pose up by time so update() and the jointMatrices upload are not needed
+    JointPalette palette;           // filled on the loader thread, its texels are dropped once uploaded
+    GLuint paletteTexture = 0;
+    UniformHandle bakedAnimationID;
 
-    std::vector<SkinObject> prepareSkinning(const tinygltf::Model& model);
+    // joint matrices of the first skin from pose
+    void updateSkinning();
 
-    int findKeyframeIndex(const std::vector<float>& times, float animationTime);
+    // cursors: the character's own keyframe cursors (see sampleClip()), so each one plays forward in O(1)
+    void update(float time, std::vector<uint32_t>* cursors = nullptr);
 
-    std::vector<AnimationObject> prepareAnimation(const tinygltf::Model& model);
+    // Compiles the shader right away, the model is mapped from cacheDir (or imported) by the loader
+    // and set up once it is uploaded. Until then the bot just draws nothing.
+    // bakeRate > 0 also bakes the animation at that many poses per second (on the loader too).
+    void initialize(AssetLoader& loader, const std::string& cacheDir, float bakeRate = 0.0f);
 
-    void updateAnimation(
-        const tinygltf::Model& model,
-        const tinygltf::Animation& anim,
-        const AnimationObject& animationObject,
-        float time,
-        std::vector<glm::mat4>& nodeTransforms
-    );
+    // GL side of the model: buffers, centering, skinning and animation data
+    void setupModel(const ModelData& data);
 
-    void updateSkinning(const std::vector<glm::mat4>& nodeTransforms);
+    bool loaded() const { return !primitiveObjects.empty(); }
 
-    void update(float time);
+    // the pose comes from the palette texture, update() can be skipped
+    bool baked() const { return paletteTexture != 0; }
 
-    bool loadModel(tinygltf::Model& model, const char* filename);
+    // joints of the first skin, the matrices per humanoid uploadPoses() expects
+    size_t jointCount() const { return skinObjects.empty() ? 0 : skinObjects[0].jointMatrices.size(); }
 
-    void initialize();
+    // Points the instance attributes of the (bound) primitive VAO at the instance buffer starting from instance first,
+    // GL 3.3 has no base instance either (same as the planets in cloudWorld.cpp)
+    void bindInstances(size_t first);
 
-    void bindMesh(
-        std::vector<PrimitiveObject>& primitiveObjects,
-        tinygltf::Model& model,
-        tinygltf::Mesh& mesh
-    );
+    // Uploads the streams of the model cache as they are into the mesh arena (each one once, however many
+    // primitives use it) and sets up the VAO of every arena block
+    std::vector<PrimitiveObject> bindModel(const ModelData& data);
 
-    void bindModelNodes(
-        std::vector<PrimitiveObject>& primitiveObjects,
-        tinygltf::Model& model,
-        tinygltf::Node& node
-    );
+    // DrawData slot shared by every humanoid, the model matrices are per instance
+    DrawData drawData() const;
 
-    std::vector<PrimitiveObject> bindModel(tinygltf::Model& model);
+    // Instance ranges of the next frame, replaces the whole buffer (and drops the skinned copies)
+    void uploadInstances(const std::vector<BotInstance>& instances);
 
-    void drawMesh(
-        const std::vector<PrimitiveObject>& primitiveObjects,
-        tinygltf::Model& model,
-        tinygltf::Mesh& mesh
-    );
+    // Poses animated on the CPU (not baked()), jointCount matrices per humanoid. BotInstance::jointBase points into it,
+    // poseBase texels further on
+    void uploadPoses(const std::vector<glm::mat3x4>& jointMatrices);
 
-    void drawModelNodes(
-        const std::vector<PrimitiveObject>& primitiveObjects,
-        tinygltf::Model& model,
-        tinygltf::Node& node
-    );
+    // Skins instances [firstInstance, firstInstance + instanceCount) into copies 0 to instanceCount - 1,
+    // submit() then draws the copy each instance's skinnedSlot names. Needs the DrawData block bound.
+    // false (and submit() keeps skinning in bot.vert) if the copies do not fit a buffer texture
+    bool skin(size_t firstInstance, size_t instanceCount);
 
-    void drawModel(
-        const std::vector<PrimitiveObject>& primitiveObjects,
-        tinygltf::Model& model
-    );
+    // palette or joint buffer for the skinning in program, bakedHandle is its bakedAnimation uniform
+    void bindPoses(ShaderProgram& program, UniformHandle bakedHandle);
 
-    void render(glm::mat4 cameraMatrix, const glm::mat4& M, const glm::vec3& lightDir, const glm::vec3& lightCol,
-            const glm::vec3& envCol);
+    // Queues instances [firstInstance, firstInstance + instanceCount) of the last uploadInstances(), one draw item
+    // per primitive with all instances of the range, drawn with the FrameData block the caller has bound and
+    // drawData() in drawSlot. depth: of the nearest instance, see RenderQueue::submit().
+    // shadowPass leaves the shadow map unbound, a layer of it is the depth attachment then.
+    // The queue needs bindInstances() registered as its INSTANCES_BOT binder.
+    void submit(RenderQueue& queue, int drawSlot, size_t firstInstance, size_t instanceCount, float depth,
+                bool shadowPass);
 
     void cleanup();
 };
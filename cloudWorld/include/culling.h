@@ -0,0 +1,83 @@
+#ifndef culling_h
+#define culling_h
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// View-frustum culling of bounding spheres (cloudworld_core, no GL)
+
+// Six planes (left, right, bottom, top, near, far) as (normal, d), normals point inside and have unit length
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann extraction from a clip-space matrix (projection * view)
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    // single sphere, same test as cullSpheres()
+    bool contains(const glm::vec3& center, float radius) const;
+};
+
+// Bounding spheres as structure of arrays, so one SIMD load picks up 4 or 8 consecutive spheres
+struct BoundingSpheres {
+    std::vector<float> x, y, z, radius;
+
+    void resize(size_t count);
+    size_t size() const { return radius.size(); }
+    void set(size_t i, const glm::vec3& center, float r) {
+        x[i] = center.x; y[i] = center.y; z[i] = center.z; radius[i] = r;
+    }
+};
+
+// Overwrites visible with the (ascending) indices of the spheres that touch the frustum and returns how many.
+// Conservative: a sphere is only dropped if it lies completely behind one plane.
+// Tests 8 spheres per instruction with AVX when the CPU has it, 4 with SSE otherwise.
+size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible);
+
+// One sphere at a time, same result; reference for the SIMD paths and the microbench
+size_t cullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible);
+
+// "avx", "sse" or "scalar", whichever cullSpheres() runs on this machine
+const char* cullingPath();
+
+// View distances where each of count shadow cascades between near and far ends (the last one is far).
+// lambda blends uniform (0) and logarithmic (1) splits, in between is the "practical" split scheme.
+std::vector<float> cascadeSplits(int count, float near, float far, float lambda);
+
+// Bounding sphere (center, radius in w) of the camera frustum between two view distances, in world space.
+// Its size only depends on the distances, the FoV and the aspect, so it stays the same while the camera turns.
+glm::vec4 frustumSliceSphere(const glm::mat4& view, float fovY, float aspect, float sliceNear, float sliceFar);
+
+// Orthographic shadow camera for a directional light
+struct ShadowFrustum {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec2 boxMin, boxMax;   // the box sideways, in light view space
+    float nearDistance = 0.0f;  // and along the light, the glm::ortho near/far
+    float farDistance = 1.0f;
+    float depthRange = 1.0f;    // far - near in world units, turns a world space bias into depth
+    float texelSize = 1.0f;     // world units per shadow map texel
+    Frustum casterBox;          // what the casters were culled against (the box, open towards the light)
+
+    // same light and other's box lies inside this one
+    bool covers(const ShadowFrustum& other) const;
+};
+
+// Hash of the position and radius of the listed spheres, rounded to multiples of quantum,
+// to notice when a set of casters moved by more than that
+uint64_t sphereSetHash(const BoundingSpheres& spheres, const std::vector<uint32_t>& indices, float quantum);
+
+// Fits the light's box of one cascade: sideways it covers the slice sphere (square, snapped to whole
+// shadow map texels so the shadows do not crawl while the camera moves), it ends behind the farthest
+// receiver in the slice and reaches back towards the light up to the nearest sphere that can still shadow one.
+// receivers indexes spheres (the visible ones); extraSpheres (center + radius in w) receive when they are in
+// the slice and always count as casters. The spheres inside the box go to casters (ascending).
+// margin grows the box by that fraction of the slice radius on every side, so a cached shadow map
+// rendered with it stays usable while the camera moves a little. Returns false if nothing in the slice receives a shadow.
+bool fitShadowCascade(const glm::vec3& lightDirection, const glm::vec4& slice, const BoundingSpheres& spheres,
+                      const std::vector<uint32_t>& receivers, const std::vector<glm::vec4>& extraSpheres,
+                      int shadowMapSize, ShadowFrustum& out, std::vector<uint32_t>& casters, float margin = 0.0f);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef frame_data_h
+#define frame_data_h
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <render/shader.h>
+
+#include "stream_buffer.h"
+
+#include <cstddef>
+#include <vector>
+
+// C++ mirrors of the std140 uniform blocks declared in render/*.vert|frag
+// Keep the member order and the vec3 + scalar pairs in sync with the GLSL side.
+
+// Shadow cascades (layers of the shadow map array), the GLSL blocks size their arrays with the same number
+const int MAX_SHADOW_CASCADES = 4;
+
+// Scene state shared by every program (FRAME_DATA_BINDING). One copy per view: the camera's, and one
+// per shadow cascade for the shadow pass; all of them are uploaded together once per frame.
+struct FrameData {
+    glm::mat4 viewProjection;   // camera or light, whichever view is being rendered
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 lightVP[MAX_SHADOW_CASCADES];     // light view-projection of each cascade for the shadow lookup
+    glm::vec4 cascadeSplits;    // view depth where each cascade ends
+    glm::vec4 cascadeBias;      // depth compare offset of each cascade, in its shadow map depth units
+    glm::vec3 lightDir;
+    int fogEnabled;
+    glm::vec3 lightColor;
+    int cascadeCount;
+    glm::vec3 envColor;
+    float pad1;
+    glm::vec3 fogColor;
+    float pad2;
+    glm::vec3 cameraPosition;
+    float pad3;
+};
+static_assert(sizeof(FrameData) == (3 + MAX_SHADOW_CASCADES) * 64 + 7 * 16, "FrameData must match the std140 layout");
+
+// Per object (DRAW_DATA_BINDING), one slot per planet and humanoid, bound with glBindBufferRange
+struct DrawData {
+    glm::mat4 M;
+    glm::vec3 modelCenter;      // bot only: centering and scaling of the glTF model
+    float modelScale;
+    glm::vec3 skeletonOffset;
+    float fogDensity;           // per object, the bot uses a thicker fog than the planets
+};
+static_assert(sizeof(DrawData) == 64 + 2 * 16, "DrawData must match the std140 layout");
+
+// One uniform buffer split into slots aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+// Slots are written on the CPU, upload() streams all of them into the next region of the ring (stream_buffer.h)
+// and bind() points a binding at one slot of it.
+struct UniformBlockBuffer {
+    StreamBuffer stream;
+    size_t elementSize = 0;
+    size_t stride = 0;
+    std::vector<unsigned char> staging;
+
+    void create(size_t size, size_t initialCapacity);
+    void destroy();
+
+    // grows the staging copy when needed, the GPU buffer follows on the next upload()
+    template <typename T>
+    T& at(size_t slot) {
+        if ((slot + 1) * stride > staging.size())
+            staging.resize((slot + 1) * stride);
+        return *reinterpret_cast<T*>(staging.data() + slot * stride);
+    }
+
+    // once per frame, before the draws that bind the slots
+    void upload(size_t count);
+    void bind(GLuint binding, size_t slot) const;
+};
+
+#endif
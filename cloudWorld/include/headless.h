@@ -0,0 +1,76 @@
+#ifndef headless_h
+#define headless_h
+#pragma once
+
+#include <glad/gl.h>
+
+#include <string>
+#include <vector>
+
+// Command line options for the run
+// Without any arguments cloudWorld behaves like before: a GLFW window with a time based seed.
+// --headless switches to an offscreen EGL context (llvmpipe works fine) so the renderer can run
+// on machines without a GPU or a display, stepping a fixed number of frames with a fixed dt.
+struct RunOptions {
+    bool headless = false;
+    bool hasSeed = false;           // --seed given, otherwise the usual time based seed (windowed only)
+    unsigned int seed = 1337;       // default seed for headless runs so they are always reproducible
+    int frames = 300;               // number of frames to render in headless mode
+    float fixedDt = 1.0f / 60.0f;   // timestep used in headless mode
+    int width = 1280;
+    int height = 720;
+
+    std::vector<int> captureFrames; // frames written to PNG (0-based frame numbers)
+    std::string outputDir = ".";    // where captured frames are written
+    std::string goldenDir;          // if set, captured frames are compared against <goldenDir>/frame_NNNN.png
+    std::string goldenRenderer;     // --golden-renderer: skip the run unless GL_RENDERER contains this
+
+    int channelTolerance = 8;       // max per-channel difference (0-255) before a pixel counts as different
+    float maxDiffRatio = 0.001f;    // fraction of differing pixels allowed before a frame fails
+
+    std::string profilePath;        // --profile: Chrome trace of the whole run (windowed or headless)
+
+    int planets = -1;               // --planets: overrides SceneConfig::numPlanets when >= 0
+    float planetDistance = -1.0f;   // --planet-distance: overrides SceneConfig::minPlanetDistance when >= 0
+
+    bool compressTextures = false;  // BC1 textures from the cache instead of RGBA8
+    bool bakeTextures = false;      // only build the texture cache and exit
+    bool bakeModels = false;        // only import the models into the model cache and exit
+};
+
+// Returns false (after printing usage) when the arguments are invalid
+bool parseRunOptions(int argc, char** argv, RunOptions& options);
+
+// Offscreen GL 3.3 core context with its own framebuffer standing in for the window's back buffer
+struct HeadlessContext {
+    void* display = nullptr;        // EGLDisplay
+    void* context = nullptr;        // EGLContext
+    GLuint framebuffer = 0;
+    GLuint colorRenderbuffer = 0;
+    GLuint depthRenderbuffer = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Exit code of a headless run that could not create its context (built without EGL, or no driver)
+// or got another renderer than --golden-renderer asked for, ctest skips the golden test instead of failing it
+const int HEADLESS_UNAVAILABLE = 77;
+
+// Creates the EGL context, makes it current and loads GL through glad
+bool createHeadlessContext(HeadlessContext& ctx, int width, int height);
+
+// Creates the framebuffer that replaces the default one, needs a current context
+bool createHeadlessFramebuffer(HeadlessContext& ctx);
+
+void destroyHeadlessContext(HeadlessContext& ctx);
+
+// Reads back the color attachment of the given framebuffer and writes it as PNG
+bool writeFramebufferPNG(const std::string& path, GLuint framebuffer, int width, int height);
+
+// Compares a PNG against its golden image, returns true when the frame matches within tolerance
+bool compareWithGolden(const std::string& imagePath, const std::string& goldenPath, const RunOptions& options);
+
+// frame_0042.png style file names shared by the captures and the golden images
+std::string captureFileName(int frame);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef mesh_h
+#define mesh_h
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// CPU side mesh generation (cloudworld_core, no GL), the renderer uploads the result
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+// What goes to the GPU, 20 bytes instead of Vertex's 32
+struct PackedVertex {
+    glm::vec3 position;
+    int16_t normal[2];      // octahedral, snorm16 (packOctahedral())
+    uint16_t uv[2];         // half floats
+};
+
+// Skinned glTF vertex after packing, 32 bytes instead of the 52 of the float attributes
+struct PackedSkinnedVertex {
+    glm::vec3 position;
+    int16_t normal[2];      // octahedral, snorm16
+    uint16_t uv[2];         // half floats
+    uint8_t joints[4];
+    uint16_t weights[4];    // unorm16
+};
+
+// UV sphere of radius 1, (stacks + 1) * (slices + 1) vertices and stacks * slices * 6 indices
+void generateSphere(int stacks, int slices, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Icosahedron of radius 1 with every triangle split in 4, subdivisions times: 20 * 4^subdivisions triangles
+// of about the same size, none of the slivers a UV sphere has at its poles. Same UV mapping as generateSphere(),
+// the vertices along the u = 0/1 seam are duplicated (u + 1) so no triangle wraps backwards over the texture.
+void generateIcosphere(int subdivisions, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Largest angle any triangle edge of a unit sphere mesh spans
+float maxEdgeAngle(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+// Largest projected radius (pixels) a sphere mesh whose edges span up to edgeAngle can be drawn at
+// while its flat triangles stay within maxError pixels of the true sphere (the sagitta r * (1 - cos(angle / 2)))
+float sphereLodMaxRadius(float edgeAngle, float maxError);
+
+// Level of detail for a sphere drawn at radius pixels, 0 is the finest. maxRadius[i] is the largest radius
+// level i is good for (decreasing, see sphereLodMaxRadius()); the coarsest level that is good enough wins.
+// previous is last frame's level (-1 if none): the mesh gets finer as soon as the error bound needs it but only
+// coarser once the radius is a hysteresis fraction below the bound, so a planet on the edge does not pop every frame.
+int selectSphereLod(float radius, int previous, const std::vector<float>& maxRadius, float hysteresis);
+
+// Unit normal to two snorm16 on the octahedron folded onto a square (the shaders unfold it again)
+void packOctahedral(const glm::vec3& normal, int16_t out[2]);
+glm::vec3 unpackOctahedral(const int16_t in[2]);
+
+PackedVertex packVertex(const Vertex& vertex);
+
+// Average cache miss ratio: vertex shader runs per triangle with a FIFO post-transform cache of cacheSize
+// entries, 3 is no reuse at all, about 0.5 is as good as a regular mesh gets
+float vertexCacheAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16);
+
+// Reorders the triangles so consecutive ones share vertices still in the post-transform cache
+// (Forsyth's linear-speed vertex cache optimisation)
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Renumbers the vertices in the order the indices first use them, so the vertex fetch walks through memory.
+// Rewrites indices and returns old -> new (UINT32_MAX for vertices no triangle uses), see remapVertices()
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+template <typename T>
+void remapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap) {
+    size_t count = 0;
+    for (uint32_t target : remap)
+        if (target != UINT32_MAX) ++count;
+    std::vector<T> reordered(count);
+    for (size_t i = 0; i < remap.size(); ++i)
+        if (remap[i] != UINT32_MAX) reordered[remap[i]] = vertices[i];
+    vertices.swap(reordered);
+}
+
+// 16 bit copy of indices, false (and out left empty) if one of them does not fit
+bool narrowIndices(const std::vector<uint32_t>& indices, std::vector<uint16_t>& out);
+
+#endif
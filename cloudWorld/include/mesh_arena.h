@@ -0,0 +1,48 @@
+#ifndef mesh_arena_h
+#define mesh_arena_h
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <vector>
+
+// Static meshes sub-allocated from a few large vertex and index buffers instead of a buffer pair per primitive.
+// Every mesh in a block shares its buffers, so one VAO per block and vertex format serves all of them and the
+// draws pick their mesh with a base vertex and an index offset (like the planet levels in cloudWorld.cpp).
+// Ranges live until destroy() releases every block at once.
+struct MeshArena {
+    struct Block {
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        size_t vertexCapacity = 0;  // bytes
+        size_t vertexUsed = 0;
+        size_t indexCapacity = 0;
+        size_t indexUsed = 0;
+    };
+
+    // Where upload() put a mesh
+    struct Range {
+        size_t block;
+        GLint baseVertex;           // first vertex in the block's vertex buffer, its offset is a whole number of vertices
+        size_t indexOffset;         // bytes into the block's index buffer
+    };
+
+    std::vector<Block> blocks;
+    size_t blockVertexBytes = 0;    // size of the blocks opened by upload(), larger meshes get a block of their own size
+    size_t blockIndexBytes = 0;
+
+    // Sets the block size, the first block is opened by the first upload()
+    void create(size_t vertexBytes, size_t indexBytes);
+
+    // Copies one mesh into the first block with room for it, opening a new block when none has.
+    // Needs no VAO bound (the index buffer binding is VAO state).
+    Range upload(const void* vertices, size_t vertexCount, size_t stride, const void* indices, size_t indexBytes);
+
+    // GPU memory of all blocks
+    size_t bytes() const;
+
+    void destroy();
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef model_cache_h
+#define model_cache_h
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "animation.h"
+#include "mesh.h"
+#include "texture_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Imported models (.cwmesh): everything the bot takes from a glTF file, packed once so a launch maps
+// the file and hands the vertex and index streams to glBufferData instead of parsing the JSON,
+// reading the accessors and optimizing the meshes again.
+//
+// Layout: CachedModelHeader, `primitiveCount` CachedPrimitive and `clipCount` CachedClip entries,
+// then the sections they point at (16 byte aligned): dependency names, inverse bind matrices, skeleton,
+// per primitive its PackedSkinnedVertex stream and its indices, per clip its channels, times and values.
+// The header keeps the FNV-1a hash of the source and of the buffer files it references (the dependencies),
+// a cache whose source changed is imported again.
+
+struct CachedModelHeader {
+    char magic[4];              // "CWMS"
+    uint32_t version;
+    uint64_t sourceHash;
+    float boundsMin[3];         // of the POSITION accessors, the model's bind pose bounding box
+    float boundsMax[3];
+    uint32_t nodeCount;         // glTF nodes, the size of a pose
+    uint32_t primitiveCount;
+    uint32_t clipCount;
+    uint32_t jointCount;        // of the first skin, 0 without one
+    uint32_t skeletonSize;
+    uint32_t dependencyCount;
+    uint64_t dependencyOffset;  // '\0' terminated file names, relative to the source
+    uint64_t inverseBindOffset; // jointCount mat4
+    uint64_t skeletonOffset;    // int32 nodes and parents (skeletonSize each), then jointEntries (jointCount)
+};
+
+struct CachedPrimitive {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexSize;         // 2 or 4 bytes
+    uint32_t padding;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+};
+
+struct CachedClipChannel {
+    int32_t node;
+    uint32_t target;            // AnimationTarget
+    uint32_t interpolation;     // AnimationInterpolation
+    uint32_t firstKey;
+    uint32_t keyCount;
+};
+
+struct CachedClip {
+    float duration;
+    uint32_t channelCount;
+    uint32_t keyCount;
+    uint32_t padding;
+    uint64_t channelOffset;     // channelCount CachedClipChannel
+    uint64_t timeOffset;        // keyCount float
+    uint64_t valueOffset;       // keyCount vec4
+};
+
+// A model ready for upload, the primitive streams point into the mapped cache file or into its own storage.
+// Primitives are in draw order (the default scene's nodes depth first), only indexed triangles are kept.
+// A mesh drawn by several nodes has an entry per node, all pointing at the same streams.
+struct ModelData {
+    struct Primitive {
+        const PackedSkinnedVertex* vertices;
+        size_t vertexCount;
+        const void* indices;    // uint16_t whenever the primitive has few enough vertices, otherwise uint32_t
+        size_t indexCount;
+        size_t indexSize;
+    };
+
+    std::vector<Primitive> primitives;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    size_t nodeCount = 0;
+
+    // First skin (empty without one) and every animation, compiled like animation.h does from the glTF
+    Skeleton skeleton;
+    std::vector<glm::mat4> inverseBindMatrices;
+    std::vector<AnimationClip> clips;
+
+    bool valid() const { return !primitives.empty(); }
+
+    ModelData() = default;
+    ModelData(const ModelData&) = delete;
+    ModelData& operator=(const ModelData&) = delete;
+
+    MappedFile file;
+    std::vector<unsigned char> storage;
+};
+
+// <cacheDir>/<file name of the source>.cwmesh
+std::string modelCachePath(const std::string& sourcePath, const std::string& cacheDir);
+
+// Maps the cache of sourcePath if it is there and still matches the source, otherwise imports the source
+// (.glb or .gltf), writes the cache for the next launch and returns the imported data.
+// A cache without its source is used as is. Returns false if neither can be read. No GL, runs on loader threads.
+bool loadModel(const std::string& sourcePath, const std::string& cacheDir, ModelData& out);
+
+#endif
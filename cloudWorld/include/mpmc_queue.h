@@ -0,0 +1,95 @@
+#ifndef mpmc_queue_h
+#define mpmc_queue_h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for any number of producers and consumers (Dmitry Vyukov's ring buffer).
+// Every cell carries a sequence number that says whether it is free for the producer of that round
+// or filled for the consumer, so push and pop only CAS their position counter and never take a lock.
+// The capacity is rounded up to a power of two. tryPush fails when full, tryPop when empty.
+template <typename T>
+class MPMCQueue {
+public:
+    explicit MPMCQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        cells = std::vector<Cell>(size);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    bool tryPush(const T& value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                // cell is free for this round, claim it
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // consumer has not freed it yet: full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);   // another producer got it
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    // free the cell for the producer one lap later
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // nothing written here yet: empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+
+        Cell() : sequence(0), value() {}
+        Cell(Cell&& other) : sequence(other.sequence.load()), value(other.value) {}
+        Cell& operator=(Cell&& other) {
+            sequence.store(other.sequence.load());
+            value = other.value;
+            return *this;
+        }
+    };
+
+    std::vector<Cell> cells;
+    size_t mask = 0;
+    // producers and consumers hammer different counters, keep them on separate cache lines
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef profiler_h
+#define profiler_h
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Frame profiler
+// - CPU zones are scoped (PROFILE_ZONE) and can nest, so the trace shows the frame hierarchy
+// - GPU zones (PROFILE_GPU_ZONE) wrap whole passes with GL_TIME_ELAPSED queries. Queries live in a
+//   ring of kGpuFramesInFlight frames and are read back a few frames later, only once
+//   GL_QUERY_RESULT_AVAILABLE says so, so the profiler never stalls the pipeline.
+//   GL does not allow nested TIME_ELAPSED queries, so GPU zones must not overlap.
+// - A session is dumped as Chrome trace-event JSON (chrome://tracing or ui.perfetto.dev)
+// When no session is running every call returns right away.
+struct Profiler {
+    static const int kGpuFramesInFlight = 4;
+    static const int kMaxGpuZonesPerFrame = 16;
+
+    struct CpuEvent {
+        const char* name;       // zone names are string literals
+        uint64_t startNs;
+        uint64_t durationNs;
+        int depth;
+        uint32_t frame;
+    };
+
+    struct GpuEvent {
+        const char* name;
+        uint64_t issueNs;       // CPU time the zone was recorded, used to place it on the GPU track
+        uint64_t durationNs;
+        uint32_t frame;
+    };
+
+    struct GpuFrame {
+        GLuint queries[kMaxGpuZonesPerFrame];
+        const char* names[kMaxGpuZonesPerFrame];
+        uint64_t issueNs[kMaxGpuZonesPerFrame];
+        int count = 0;
+        uint32_t frame = 0;
+        bool pending = false;
+    };
+
+    bool enabled = false;
+    std::string outputPath;
+    uint32_t frameIndex = 0;
+    uint64_t sessionStartNs = 0;
+
+    std::vector<CpuEvent> cpuEvents;
+    std::vector<GpuEvent> gpuEvents;
+    std::vector<size_t> openZones;  // indices into cpuEvents of zones that have not ended yet
+
+    GpuFrame gpuFrames[kGpuFramesInFlight];
+    int gpuActiveZone = -1;         // slot in the current GpuFrame with a running query
+    size_t droppedGpuFrames = 0;    // frames whose results were not ready when the slot came around again
+
+    // needs a current GL context (query objects are created here)
+    void beginSession(const std::string& path);
+    // reads back what is left, writes the trace and prints a per-zone summary
+    void endSession();
+
+    void beginFrame();
+    void endFrame();
+
+    void beginZone(const char* name);
+    void endZone();
+
+    void beginGpuZone(const char* name);
+    void endGpuZone();
+
+    static uint64_t nowNs();
+
+private:
+    void collectGpuFrame(GpuFrame& gpuFrame, bool wait);
+    bool writeTrace() const;
+    void printSummary() const;
+};
+
+extern Profiler profiler;
+
+struct ProfileScope {
+    explicit ProfileScope(const char* name) { profiler.beginZone(name); }
+    ~ProfileScope() { profiler.endZone(); }
+};
+
+struct GpuProfileScope {
+    explicit GpuProfileScope(const char* name) { profiler.beginGpuZone(name); }
+    ~GpuProfileScope() { profiler.endGpuZone(); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileZone_, __LINE__)(name)
+
+#endif
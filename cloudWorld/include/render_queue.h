@@ -0,0 +1,102 @@
+#ifndef render_queue_h
+#define render_queue_h
+#pragma once
+
+#include <glad/gl.h>
+
+#include <render/shader.h>
+
+#include "frame_data.h"
+#include "sort_keys.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Texture units a draw item can bind: 0 is the albedo, 1 the shadow map, the bot's skinning inputs go on 2 to 4
+const int MAX_ITEM_TEXTURES = 5;
+// int uniforms a draw item sets before its draw
+const int MAX_ITEM_UNIFORMS = 2;
+
+// Draw order groups, the most significant bits of the sort key
+enum RenderLayer : uint32_t {
+    LAYER_OPAQUE = 0,
+    LAYER_SKY = 1,      // after the opaque draws, so the depth test rejects whatever they cover
+};
+
+// Instance buffers the queue points the instance attributes of an item's VAO at, GL 3.3 has no base instance
+// so the attribute offsets move instead. The binders are registered once with RenderQueue::setInstanceBinder().
+enum InstanceSource : uint32_t {
+    INSTANCES_NONE = 0,
+    INSTANCES_PLANETS,
+    INSTANCES_BOT,
+    MAX_INSTANCE_SOURCES
+};
+
+// id 0 leaves the unit alone
+struct TextureBinding {
+    GLenum target = GL_TEXTURE_2D;
+    GLuint id = 0;
+};
+
+struct ItemUniform {
+    UniformHandle handle = INVALID_UNIFORM;
+    GLint value = 0;
+};
+
+// One submitted draw as plain data: the state it needs and the draw call issued once that state is bound
+struct DrawItem {
+    ShaderProgram* program = nullptr;
+    GLuint vao = 0;
+    TextureBinding textures[MAX_ITEM_TEXTURES];
+    ItemUniform uniforms[MAX_ITEM_UNIFORMS];    // the program skips values it already has
+    int drawSlot = -1;          // DrawData slot bound to DRAW_DATA_BINDING, -1 for none
+    bool depthWrite = true;
+    GLenum depthFunc = GL_LESS;
+    const char* zone = nullptr; // CPU and GPU profiler zone of the item's group, nullptr inside a pass that has its own
+
+    // glDrawElements(Instanced)BaseVertex when indexType is set, glDrawArrays(Instanced) from baseVertex otherwise
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;
+    GLenum indexType = 0;
+    size_t indexOffset = 0;     // bytes into the VAO's index buffer
+    GLint baseVertex = 0;
+    InstanceSource instances = INSTANCES_NONE;
+    size_t firstInstance = 0;
+    GLsizei instanceCount = 0;  // 0 draws without instancing
+
+    uint64_t key = 0;           // set by RenderQueue::submit()
+};
+
+// Draw items of one pass, executed in the order of a 64 bit key, most significant first:
+// layer (4 bits), program (12), VAO (12), texture on unit 0 (12), depth (24).
+// Items with the same state go front to back, and execute() only binds the program, VAO, textures,
+// DrawData slot, depth state and instance range that differ from the item before, so its cost follows
+// the state changes rather than the number of draws. Items are plain data, the queue reuses its storage.
+struct RenderQueue {
+    std::vector<DrawItem> items;
+
+    // of the last execute(), for the benchmarks
+    size_t executedItems = 0;
+    size_t stateChanges = 0;
+
+    // binder(first) points the instance attributes of the bound VAO at instance first of source
+    void setInstanceBinder(InstanceSource source, std::function<void(size_t)> binder);
+
+    // depth: view depth of the nearest thing the item draws as a fraction of the far plane (0 the nearest)
+    void submit(const DrawItem& item, RenderLayer layer, float depth);
+
+    // Sorts (radixSortKeys()) and draws every item, then clears the queue. Items of the same zone are drawn
+    // inside one profiler zone, so zone names must not repeat apart from each other in the sorted order.
+    // Leaves program 0, VAO 0, unit 0 active and depth writes with GL_LESS.
+    void execute(const UniformBlockBuffer& drawBlocks);
+
+private:
+    std::function<void(size_t)> instanceBinders[MAX_INSTANCE_SOURCES];
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> scratch;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef scene_h
+#define scene_h
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Scene parameters that used to be hard-coded in cloudWorld.cpp
+// The defaults give the usual universe, cloudWorld_bench changes them to sweep scenarios.
+struct SceneConfig {
+    int numPlanets = 20;
+    float minPlanetDistance = 40.0f;    // minimum separation between planet surfaces
+    float planetRadiusScale = 1.0f;     // scales every planet, small values let huge fields fit
+    bool planetLods = true;             // icosphere levels of detail picked by projected size, otherwise one UV sphere for all
+    int sphereStacks = 64;              // planet sphere tessellation without planetLods
+    int sphereSlices = 64;
+    float lodPixelError = 0.5f;         // how far (pixels) a level's flat triangles may stray from the true sphere
+    float lodHysteresis = 0.15f;        // a planet only gets a coarser level once it is this much smaller than the bound
+    float shadowLodTexelError = 1.0f;   // same for the shadow casters, in shadow map texels
+    bool frustumCulling = true;         // camera pass only draws planets whose bounding sphere is in view
+    int shadowMapSize = 1024;           // square shadow map, per cascade
+    int shadowCascades = 4;             // up to MAX_SHADOW_CASCADES (frame_data.h)
+    float shadowSplitLambda = 0.75f;    // cascade splits: 0 uniform, 1 logarithmic, in between a blend of both
+    float shadowDistance = 250.0f;      // view depth where the last cascade ends (the wrapped world is 200 wide)
+    bool shadowCaching = true;          // planets go into a cached static shadow map, only the humanoids are redrawn every frame
+    float shadowCacheMargin = 0.25f;    // the cached light box is this much (of the slice radius) larger on every side
+    int planetTextureSize = 2048;       // max layer size of the planet texture array, larger images are scaled down
+    bool compressTextures = false;      // BC1 planet and skybox textures, needs GL_EXT_texture_compression_s3tc
+    int numBots = 1;                    // animated humanoids, each on its own (random) planet
+    int walkersPerPlanet = 0;           // smaller humanoids on top of those, spread around every planet
+    float animationBakeRate = 60.0f;    // bot poses per second baked into a joint palette texture, 0 animates on the CPU
+    bool skinningPrePass = true;        // skin every bot once per frame (transform feedback) for all passes, otherwise in each pass
+    bool persistentMapping = true;      // stream per-frame data through persistently mapped buffers (GL_ARB_buffer_storage)
+    float uploadBudgetMs = 4.0f;        // GL upload time per frame for assets finished by the loader threads
+};
+
+extern SceneConfig sceneConfig;
+
+// Scene lifetime, all of these need a current GL context
+void init();
+void cleanup();
+
+// advance animations and planet spin by dt
+void updateScene(float dt);
+
+// clear the render target and draw one frame
+void drawFrame();
+
+// framebuffer the camera pass draws into (0 = window back buffer)
+void setRenderTarget(GLuint framebuffer, int width, int height);
+
+// place the camera, yaw/pitch in radians like the keyboard controls
+void setCamera(const glm::vec3& eye, float yaw, float pitch);
+
+// blocks until every asset requested by init() is decoded and uploaded
+// (init() returns right away and drawFrame() streams them in, with placeholders until then)
+void waitForAssets();
+
+// builds the texture cache for every planet texture and the skybox, no GL needed
+// returns the number of textures that could not be loaded
+int bakeTextureCache(bool compress);
+
+// imports the bot's glTF into the model cache, no GL needed either
+// returns the number of models that could not be imported
+int bakeModelCache();
+
+// planets actually placed by init(), can be less than numPlanets if the field is too crowded
+size_t placedPlanetCount();
+
+// planets the camera pass drew in the last frame (after frustum culling)
+size_t visiblePlanetCount();
+
+// planet triangles the camera pass drew in the last frame (after culling and level of detail)
+size_t planetTriangleCount();
+
+// cascades whose static shadow map (the planets) was rendered again since init()
+size_t shadowCacheRedraws();
+
+// draw items the camera pass executed in the last frame, and the GL state changes the render queue needed for them
+size_t drawItemCount();
+size_t stateChangeCount();
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef sort_keys_h
+#define sort_keys_h
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Sorting of 64 bit keys, like the render queue's draw keys (cloudworld_core, no GL)
+
+// Sorts the indices of keys by key with 8 bit LSD radix passes, equal keys keep their order.
+// Passes over a byte every key shares are skipped.
+void radixSortKeys(const std::vector<uint64_t>& keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch);
+
+#endif
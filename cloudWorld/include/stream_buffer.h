@@ -0,0 +1,51 @@
+#ifndef stream_buffer_h
+#define stream_buffer_h
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+
+// Regions of a StreamBuffer: the CPU writes one while the GPU may still read the two before it
+const int STREAM_REGIONS = 3;
+
+// glBufferStorage is not in the GL 3.3 loader: looks it up with the loader gladLoadGL used,
+// if the context has GL_ARB_buffer_storage (core since 4.4)
+void loadBufferStorage(GLADloadfunc load);
+
+// StreamBuffers created from now on map persistently when enabled and glBufferStorage was found,
+// otherwise they map every write. Returns whether they will map persistently.
+bool setPersistentMapping(bool enabled);
+
+// Per-frame data streamed to the GPU without waiting on the draws still reading the previous frames.
+// The buffer is a ring of STREAM_REGIONS regions and every write() goes into the next one, so the data moves
+// each time: offset is where the last write starts, binds and attribute pointers have to add it.
+//  - persistent: immutable storage mapped once (coherent). Before a region is written again the CPU waits for
+//    the fence put behind the draws that read it, which with three regions has long been signaled.
+//  - otherwise (GL 3.3): glMapBufferRange without synchronization, and the storage is orphaned when the ring
+//    wraps around, so the regions still being read keep their old storage.
+// Written once per frame before the draws that use the data: a write fences the region of the one before.
+struct StreamBuffer {
+    GLenum target = GL_ARRAY_BUFFER;
+    GLuint buffer = 0;              // changes when a persistent buffer grows, anything attached to it must follow
+    size_t regionSize = 0;          // bytes
+    size_t alignment = 16;          // of the region offsets
+    size_t offset = 0;              // of the last write
+    bool persistent = false;
+
+    // regionBytes: expected size of one write, larger ones grow the buffer
+    void create(GLenum target, size_t regionBytes, size_t alignment = 16);
+    void destroy();
+
+    // Copies bytes into the next region and returns its offset (also in offset). Leaves target unbound.
+    size_t write(const void* data, size_t bytes);
+
+private:
+    int region = STREAM_REGIONS - 1;
+    GLsync fences[STREAM_REGIONS] = {};
+    unsigned char* mapped = nullptr;    // persistent mapping of the whole buffer
+
+    void allocate(size_t bytes);
+};
+
+#endif
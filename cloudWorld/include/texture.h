@@ -0,0 +1,49 @@
+#ifndef texture_h
+#define texture_h
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "texture_cache.h"
+
+// GL side of the textures, the data comes from the texture cache (see texture_cache.h)
+
+// S3TC is an extension in GL 3.3 (near universal on desktop), glad is generated without extensions
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// true if the context can sample BC1 textures (GL_EXT_texture_compression_s3tc)
+bool textureCompressionSupported();
+
+// 1x1 texture of one color, stands in until the real image is uploaded into the same id
+GLuint createPlaceholderTexture(const glm::vec4& color);
+
+// (Re)defines textureID with every prebuilt level of the texture: CLAMP_TO_EDGE against seams on the spheres, trilinear
+void uploadTexture(GLuint textureID, const TextureData& texture);
+
+// GL_TEXTURE_2D_ARRAY of square layers with a full mip chain, filled one layer at a time
+struct TextureArray {
+    GLuint id = 0;
+    int size = 0;
+    int layers = 0;
+    int levels = 0;
+    TextureFormat format = TEXTURE_RGBA8;
+
+    // every layer starts out as the placeholder color
+    void create(int size, int layers, const glm::vec4& placeholder, TextureFormat format = TEXTURE_RGBA8);
+    void destroy();
+
+    // Copies the texture's mip chain into the layer from the level that matches the layer size, the other
+    // layers are left alone. Uncompressed textures of another size are scaled by a blit. Returns false if the
+    // texture cannot go into this array (compressed and not exactly square at a level of the layer size).
+    bool setLayer(int layer, const TextureData& texture);
+    void fillLayer(int layer, const glm::vec4& color);
+
+private:
+    GLuint readFBO = 0;
+    GLuint drawFBO = 0;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef texture_cache_h
+#define texture_cache_h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Precompiled textures (.cwtex): the decoded image with its full mip chain, optionally BC1 compressed,
+// so a launch maps the file and hands the levels to GL instead of decoding JPEG/PNG and building mips.
+//
+// Layout: CachedTextureHeader, `levels` CachedTextureLevel entries, then the level data (16 byte aligned).
+// The header keeps the FNV-1a hash of the source file, a cache whose source changed is rebuilt.
+
+enum TextureFormat : uint32_t {
+    TEXTURE_RGBA8 = 0,
+    TEXTURE_BC1 = 1,
+};
+
+struct CachedTextureHeader {
+    char magic[4];          // "CWTX"
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t format;        // TextureFormat
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+};
+
+struct CachedTextureLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;        // from the start of the file
+    uint64_t size;
+};
+
+// Read-only mapping of a whole file (mmap, plain read where that is not available)
+struct MappedFile {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    bool open(const std::string& path);
+    void close();
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+private:
+    std::vector<unsigned char> fallback;
+};
+
+// Stores bytes as path (creating cacheDir), the model cache (model_cache.h) writes its files the same way
+void writeCache(const std::string& path, const std::string& cacheDir, const std::vector<unsigned char>& bytes);
+
+// A texture ready for upload, level pointers go into the mapped cache file or into its own storage
+struct TextureData {
+    struct Level {
+        int width;
+        int height;
+        const unsigned char* data;
+        size_t size;
+    };
+
+    TextureFormat format = TEXTURE_RGBA8;
+    int width = 0;
+    int height = 0;
+    std::vector<Level> levels;
+
+    bool valid() const { return !levels.empty(); }
+
+    TextureData() = default;
+    TextureData(const TextureData&) = delete;
+    TextureData& operator=(const TextureData&) = delete;
+
+    MappedFile file;
+    std::vector<unsigned char> storage;
+};
+
+// <cacheDir>/<file name of the source>[.bc1].cwtex
+std::string textureCachePath(const std::string& sourcePath, const std::string& cacheDir, bool compress);
+
+// Maps the cache of sourcePath if it is there and still matches the source, otherwise decodes the source,
+// builds the mip chain (and BC1 blocks), writes the cache for the next launch and returns the built data.
+// A cache without its source is used as is. Returns false if neither can be read. No GL, runs on loader threads.
+bool loadTexture(const std::string& sourcePath, const std::string& cacheDir, bool compress, TextureData& out);
+
+// Largest side of the texture from the cache header or the image header, 0 if neither exists
+int textureSize(const std::string& sourcePath, const std::string& cacheDir, bool compress);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef texture_codec_h
+#define texture_codec_h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU side of the texture cache (cloudworld_core, no GL): mip chains, BC1 compression and hashing
+
+// FNV-1a, 64 bit, keys cache files to the bytes of their source image
+uint64_t fnv1a64(const void* data, size_t size);
+
+struct ImageLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;  // RGBA8, tightly packed
+};
+
+// Full chain down to 1x1 with a 2x2 box filter (what glGenerateMipmap does), level 0 is a copy of rgba
+std::vector<ImageLevel> buildMipChain(const unsigned char* rgba, int width, int height);
+
+// BC1 (DXT1) without alpha: every 4x4 block becomes two RGB565 endpoints and 2 bit indices, 8 bytes.
+// Endpoints come from the block's color bounding box, slightly inset so they are not wasted on outliers.
+size_t bc1Size(int width, int height);
+void compressBC1(const unsigned char* rgba, int width, int height, unsigned char* out);
+
+// One BC1 block of a single color, for placeholders in compressed textures
+void solidBC1Block(unsigned char r, unsigned char g, unsigned char b, unsigned char out[8]);
+
+#endif
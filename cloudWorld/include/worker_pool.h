@@ -0,0 +1,36 @@
+#ifndef worker_pool_h
+#define worker_pool_h
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of background threads running submitted jobs in FIFO order (no GL calls in jobs!)
+struct WorkerPool {
+    // threads = 0 picks one less than the hardware threads (at least one), the main thread keeps a core
+    void start(unsigned threads = 0);
+
+    // waits for the running jobs, jobs still queued are dropped
+    void stop();
+
+    void submit(std::function<void()> job);
+
+    size_t threadCount() const { return threads.size(); }
+
+    ~WorkerPool() { stop(); }
+
+private:
+    void run();
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef world_h
+#define world_h
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// World simulation and math shared by the renderer and the microbenchmarks (cloudworld_core, no GL)
+
+// For infinity camera movement
+const float WORLD_SIZE = 200.0f;            // infinite world cube size
+const float PLANET_FIELD_RADIUS = 220.0f;   // planets are scattered inside this sphere
+
+struct Planet {
+    glm::vec3 position;
+    float radius;
+    int textureIndex;           // chosen texture for planet
+    glm::mat4 modelMatrix;
+    glm::vec3 rotationAxis;     // Random rotation axis
+    float rotationSpeed;        // angular velocity
+    float rotationAngle;        // rotation angle for planet rotation effect
+};
+
+// Infinite world wrapping functions
+// objects wrap around when they exceed world boundaries
+
+// Wrap a single coordinate value within [-period/2, period/2]
+float wrapFloat(float value, float period);
+
+// Wrap 3D position within world cube
+void wrapPosition(glm::vec3& p, float size);
+
+// Wrap planet position relative to the camera (eye) for infinite illusion
+// Planets appear to wrap around as camera moves through world
+glm::vec3 wrapPlanetPosition(const glm::vec3& planetPos, const glm::vec3& eye);
+
+// Distance between two points of the world cube the short way around, through its faces where that is shorter
+float wrappedDistance(const glm::vec3& a, const glm::vec3& b);
+
+// generate random point inside sphere for planet placement (uses rand(), so srand() decides the field)
+glm::vec3 randomInSphere(float radius);
+
+// Random planet field: up to count planets that keep minDistance between their surfaces
+// (measured with wrappedDistance(), so from any eye position). Planets that find no free spot are dropped, and placement stops
+// early once the field is full. radiusScale shrinks every planet, fields of 100k+ need it to fit the world cube.
+std::vector<Planet> placePlanets(int count, float minDistance, int textureCount, float radiusScale = 1.0f);
+
+#endif
@@ -2,29 +2,62 @@
 
 in vec3 worldPosition;
 in vec3 worldNormal;
-in vec4 lightSpacePos;
 
 out vec3 finalColor;
 
-// Directional light same as the planets' shaders
-uniform vec3 lightDir;      // Direction to the light
-uniform vec3 lightColor;    // Light color/intensity
-
-//shadow
-uniform sampler2D shadowMap;
+// Directional light, environment light and fog are the same as the planets' shaders
+// Scene state shared by all programs, uploaded once per frame (FrameData in include/frame_data.h)
+layout(std140) uniform FrameData {
+    mat4 viewProjection;    // camera, or the light during the shadow pass
+    mat4 view;
+    mat4 projection;
+    mat4 lightVP[4];        // light view-projection of each shadow cascade (MAX_SHADOW_CASCADES)
+    vec4 cascadeSplits;     // view depth where each cascade ends
+    vec4 cascadeBias;       // depth compare offset of each cascade
+    vec3 lightDir;
+    bool fogEnabled;
+    vec3 lightColor;
+    int cascadeCount;
+    vec3 envColor;
+    vec3 fogColor;
+    vec3 cameraPosition;
+};
+
+// Per object data (DrawData in include/frame_data.h)
+layout(std140) uniform DrawData {
+    mat4 M;
+    vec3 modelCenter;
+    float modelScale;
+    vec3 skeletonOffset;
+    float fogDensity;
+};
+
+//shadow, same cascades as the planets (see box.frag)
+uniform sampler2DArray shadowMap;
+
+float shadowFactor(vec3 position, float ndl) {
+	float viewDepth = -(view * vec4(position, 1.0)).z;
+	int cascade = 0;
+	while (cascade < cascadeCount && viewDepth > cascadeSplits[cascade])
+		cascade++;
+	if (cascade == cascadeCount)
+		return 1.0;
+
+	vec4 lightSpacePos = lightVP[cascade] * vec4(position, 1.0);
+	vec3 proj = lightSpacePos.xyz / lightSpacePos.w;
+	vec2 shadowUV = proj.xy * 0.5 + 0.5;
+	float depth = proj.z * 0.5 + 0.5;
 
-// Environment lighting
-uniform vec3 envColor;
+	if (shadowUV.x < 0.0 || shadowUV.x > 1.0 || shadowUV.y < 0.0 || shadowUV.y > 1.0)
+		return 1.0;
+	float existingDepth = texture(shadowMap, vec3(shadowUV, cascade)).r;
+	float slope = min(sqrt(1.0 - ndl * ndl) / max(ndl, 0.1), 10.0);
+	return (depth >= existingDepth + cascadeBias[cascade] * (1.0 + slope)) ? 0.3 : 1.0;
+}
 
 //uniform vec3 lightPosition;		by applying the same configuration as the planets I removed the lighting settings
 //uniform vec3 lightIntensity;		given in lab4
 
-// Fog uniforms
-uniform vec3 cameraPosition;
-uniform vec3 fogColor;
-uniform float fogDensity;
-uniform bool fogEnabled;
-
 void main()
 {
 	vec3 N = normalize(worldNormal);
@@ -44,15 +77,7 @@ void main()
 	vec3 color = albedo * (ambient + diffuse);
 
 	// Shadow calculation
-	vec3 proj = lightSpacePos.xyz / lightSpacePos.w;
-	vec2 shadowUV = proj.xy * 0.5 + 0.5;
-	float depth = proj.z * 0.5 + 0.5;
-
-	if (shadowUV.x >= 0.0 && shadowUV.x <= 1.0 && shadowUV.y >= 0.0 && shadowUV.y <= 1.0) {
-		float existingDepth = texture(shadowMap, shadowUV).r;
-		float shadow = (depth >= existingDepth + 0.003) ? 0.3 : 1.0;
-		color *= shadow;
-	}
+	color *= shadowFactor(worldPosition, ndl);
 
 	// Tone mapping
 	color = color / (color + vec3(1.0));
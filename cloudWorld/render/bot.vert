@@ -2,50 +2,100 @@
 
 // Input
 layout(location = 0) in vec3 vertexPosition;
-layout(location = 1) in vec3 vertexNormal;
+layout(location = 1) in vec2 vertexNormal;     // octahedral (packOctahedral() in mesh.cpp)
 layout(location = 2) in vec2 vertexUV;
 // For skinning
 layout(location = 3) in uvec4 joints; // Indices of the joints
 layout(location = 4) in vec4 weights; // Weights of influence
+// Per humanoid, advanced once per instance (BotInstance in include/bot.h)
+layout(location = 5) in mat4 instanceModel;         // locations 5 to 8
+layout(location = 9) in float instancePaletteFrame; // palette row plus the fraction towards the next one
+layout(location = 10) in int instanceJointBase;     // first texel of the pose in jointBuffer
+// location 11, the skinned copy, is only read by bot_skinned.vert
 
 // Output data, to be interpolated for each fragment
 out vec3 worldPosition;
 out vec3 worldNormal;
-out vec4 lightSpacePos;
 
-uniform mat4 MVP;
-uniform mat4 M;
-uniform mat4 jointMatrices[100]; // Max joints
+// Scene state shared by all programs, uploaded once per frame (FrameData in include/frame_data.h)
+layout(std140) uniform FrameData {
+    mat4 viewProjection;    // camera, or the light during the shadow pass
+    mat4 view;
+    mat4 projection;
+    mat4 lightVP[4];        // light view-projection of each shadow cascade (MAX_SHADOW_CASCADES)
+    vec4 cascadeSplits;     // view depth where each cascade ends
+    vec4 cascadeBias;       // depth compare offset of each cascade
+    vec3 lightDir;
+    bool fogEnabled;
+    vec3 lightColor;
+    int cascadeCount;
+    vec3 envColor;
+    vec3 fogColor;
+    vec3 cameraPosition;
+};
 
-uniform vec3 modelCenter;
-uniform float modelScale;
-uniform vec3 skeletonOffset;
-uniform mat4 LightVP;
+// Per object data (DrawData in include/frame_data.h), shared by the whole crowd
+layout(std140) uniform DrawData {
+    mat4 M;                 // unused, every instance has its own
+    vec3 modelCenter;
+    float modelScale;
+    vec3 skeletonOffset;
+    float fogDensity;
+};
 
+// Poses animated on the CPU, every instance's joints one after the other,
+// each as the top three rows of its matrix (affineRows() in include/animation.h), so v * m is the transformed v
+uniform samplerBuffer jointBuffer;
+
+// Baked animation (JointPalette in include/animation.h): row f is the pose at frame f,
+// 3 texels per joint holding the same rows as jointBuffer
+uniform bool bakedAnimation;
+uniform sampler2D jointPalette;
+
+
+// unfolds an octahedral normal, same as box.vert
+vec3 unpackOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// joint matrix of this instance from the joint buffer, or blended between the two palette rows around its frame
+mat3x4 jointMatrix(uint joint) {
+    if (!bakedAnimation) {
+        int base = instanceJointBase + int(joint) * 3;
+        return mat3x4(texelFetch(jointBuffer, base), texelFetch(jointBuffer, base + 1), texelFetch(jointBuffer, base + 2));
+    }
+    int frame = int(instancePaletteFrame);
+    float t = instancePaletteFrame - float(frame);
+    int x = int(joint) * 3;
+    vec4 r0 = mix(texelFetch(jointPalette, ivec2(x, frame), 0), texelFetch(jointPalette, ivec2(x, frame + 1), 0), t);
+    vec4 r1 = mix(texelFetch(jointPalette, ivec2(x + 1, frame), 0), texelFetch(jointPalette, ivec2(x + 1, frame + 1), 0), t);
+    vec4 r2 = mix(texelFetch(jointPalette, ivec2(x + 2, frame), 0), texelFetch(jointPalette, ivec2(x + 2, frame + 1), 0), t);
+    return mat3x4(r0, r1, r2);
+}
 
 void main() {
     // Linear blend skinning - combine joint transformations weighted by influence
-    mat4 skinMatrix =
-    weights.x * jointMatrices[joints.x] +
-    weights.y * jointMatrices[joints.y] +
-    weights.z * jointMatrices[joints.z] +
-    weights.w * jointMatrices[joints.w];
+    mat3x4 skinMatrix =
+    weights.x * jointMatrix(joints.x) +
+    weights.y * jointMatrix(joints.y) +
+    weights.z * jointMatrix(joints.z) +
+    weights.w * jointMatrix(joints.w);
 
     // Apply skinning transformation to vertex
-    vec4 skinnedPosition = skinMatrix * vec4(vertexPosition, 1.0);
+    vec3 skinnedPosition = vec4(vertexPosition, 1.0) * skinMatrix;
     // normalize model position: center at origin, align skeleton root, and scale to unit size
     // modelCenter: humanoid's geometric center from GLTF bounding box
     // skeletonOffset: offset from geometric center to skeleton root joint
     // modelScale: normalization factor to scale model to approx. 1 unit
-    vec3 centered = (skinnedPosition.xyz + modelCenter + skeletonOffset) * modelScale;
-    vec4 worldPos = M * vec4(centered, 1.0);
+    vec3 centered = (skinnedPosition + modelCenter + skeletonOffset) * modelScale;
+    vec4 worldPos = instanceModel * vec4(centered, 1.0);
 
     worldPosition = worldPos.xyz;
-    gl_Position = MVP * worldPos;
-
-    // Calculate light space position
-    lightSpacePos = LightVP * worldPos;
+    gl_Position = viewProjection * worldPos;
 
-    mat3 normalMatrix = transpose(inverse(mat3(M)));
-    worldNormal = normalMatrix * (mat3(skinMatrix) * vertexNormal);
+    // the humanoids are only rotated and uniformly scaled, bot.frag normalizes
+    worldNormal = mat3(instanceModel) * (vec4(unpackOctahedral(vertexNormal), 0.0) * skinMatrix);
 }
@@ -0,0 +1,52 @@
+#version 330 core
+
+// Draws the copies skinned by the pre-pass (bot_skinning.vert) with the bot's own index buffer,
+// gl_VertexID is the vertex in the mesh arena block (base vertex included)
+
+// Per humanoid (BotInstance in include/bot.h), the rest of the instance is only needed for skinning
+layout(location = 11) in int instanceSkinnedSlot;   // which skinned copy
+
+// Output data, to be interpolated for each fragment
+out vec3 worldPosition;
+out vec3 worldNormal;
+
+// Scene state shared by all programs, uploaded once per frame (FrameData in include/frame_data.h)
+layout(std140) uniform FrameData {
+    mat4 viewProjection;    // camera, or the light during the shadow pass
+    mat4 view;
+    mat4 projection;
+    mat4 lightVP[4];        // light view-projection of each shadow cascade (MAX_SHADOW_CASCADES)
+    vec4 cascadeSplits;     // view depth where each cascade ends
+    vec4 cascadeBias;       // depth compare offset of each cascade
+    vec3 lightDir;
+    bool fogEnabled;
+    vec3 lightColor;
+    int cascadeCount;
+    vec3 envColor;
+    vec3 fogColor;
+    vec3 cameraPosition;
+};
+
+// Everything the pre-pass captured, one block of skinnedVertexCount texels per copy for each primitive
+uniform usamplerBuffer skinnedVertices;
+uniform int skinnedBase;            // first texel of this primitive's copies, less its base vertex
+uniform int skinnedVertexCount;
+
+// unfolds an octahedral normal, same as box.vert
+vec3 unpackOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main() {
+    uvec4 v = texelFetch(skinnedVertices, skinnedBase + instanceSkinnedSlot * skinnedVertexCount + gl_VertexID);
+
+    worldPosition = uintBitsToFloat(v.xyz);
+    gl_Position = viewProjection * vec4(worldPosition, 1.0);
+
+    // two snorm16, sign extended
+    vec2 e = vec2(int(v.w << 16) >> 16, int(v.w) >> 16) / 32767.0;
+    worldNormal = unpackOctahedral(clamp(e, -1.0, 1.0));
+}
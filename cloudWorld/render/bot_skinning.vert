@@ -0,0 +1,88 @@
+#version 330 core
+
+// Skinning pre-pass (MyBot::skin()): the same skinning as bot.vert, once per humanoid and frame.
+// Drawn as points with the rasterizer off, every vertex is captured by transform feedback
+// and both passes draw the captured copies with bot_skinned.vert.
+
+// Input
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec2 vertexNormal;     // octahedral (packOctahedral() in mesh.cpp)
+// For skinning
+layout(location = 3) in uvec4 joints; // Indices of the joints
+layout(location = 4) in vec4 weights; // Weights of influence
+// Per humanoid, advanced once per instance (BotInstance in include/bot.h)
+layout(location = 5) in mat4 instanceModel;         // locations 5 to 8
+layout(location = 9) in float instancePaletteFrame; // palette row plus the fraction towards the next one
+layout(location = 10) in int instanceJointBase;     // first texel of the pose in jointBuffer
+
+// Captured: world position bits in xyz, the world normal packed in w (octahedral snorm16 x 2)
+flat out uvec4 skinnedVertex;
+
+// Per object data (DrawData in include/frame_data.h), shared by the whole crowd
+layout(std140) uniform DrawData {
+    mat4 M;                 // unused, every instance has its own
+    vec3 modelCenter;
+    float modelScale;
+    vec3 skeletonOffset;
+    float fogDensity;
+};
+
+// Poses animated on the CPU, same as bot.vert
+uniform samplerBuffer jointBuffer;
+
+// Baked animation, same as bot.vert
+uniform bool bakedAnimation;
+uniform sampler2D jointPalette;
+
+
+// unfolds an octahedral normal, same as box.vert
+vec3 unpackOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// folds a unit normal onto the octahedron and packs it into two snorm16, packOctahedral() in mesh.cpp
+uint packOctahedral(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    ivec2 q = ivec2(round(clamp(e, -1.0, 1.0) * 32767.0));
+    return uint(q.x & 0xffff) | (uint(q.y & 0xffff) << 16);
+}
+
+// joint matrix of this instance from the joint buffer, or blended between the two palette rows around its frame
+mat3x4 jointMatrix(uint joint) {
+    if (!bakedAnimation) {
+        int base = instanceJointBase + int(joint) * 3;
+        return mat3x4(texelFetch(jointBuffer, base), texelFetch(jointBuffer, base + 1), texelFetch(jointBuffer, base + 2));
+    }
+    int frame = int(instancePaletteFrame);
+    float t = instancePaletteFrame - float(frame);
+    int x = int(joint) * 3;
+    vec4 r0 = mix(texelFetch(jointPalette, ivec2(x, frame), 0), texelFetch(jointPalette, ivec2(x, frame + 1), 0), t);
+    vec4 r1 = mix(texelFetch(jointPalette, ivec2(x + 1, frame), 0), texelFetch(jointPalette, ivec2(x + 1, frame + 1), 0), t);
+    vec4 r2 = mix(texelFetch(jointPalette, ivec2(x + 2, frame), 0), texelFetch(jointPalette, ivec2(x + 2, frame + 1), 0), t);
+    return mat3x4(r0, r1, r2);
+}
+
+void main() {
+    // Linear blend skinning - combine joint transformations weighted by influence
+    mat3x4 skinMatrix =
+    weights.x * jointMatrix(joints.x) +
+    weights.y * jointMatrix(joints.y) +
+    weights.z * jointMatrix(joints.z) +
+    weights.w * jointMatrix(joints.w);
+
+    // skinned, centered and placed like bot.vert does it
+    vec3 skinnedPosition = vec4(vertexPosition, 1.0) * skinMatrix;
+    vec3 centered = (skinnedPosition + modelCenter + skeletonOffset) * modelScale;
+    vec3 worldPos = (instanceModel * vec4(centered, 1.0)).xyz;
+
+    // the humanoids are only rotated and uniformly scaled
+    vec3 worldN = normalize(mat3(instanceModel) * (vec4(unpackOctahedral(vertexNormal), 0.0) * skinMatrix));
+
+    skinnedVertex = uvec4(floatBitsToUint(worldPos), packOctahedral(worldN));
+}
@@ -2,21 +2,64 @@
 in vec3 worldN;
 in vec2 UV;
 in vec3 worldPos;
-in vec4 lightSpacePos;
+flat in float textureLayer;
 
 out vec3 finalColor;
 
-uniform vec3 lightDir;
-uniform vec3 lightColor;
-uniform vec3 envColor;
-uniform sampler2D diffuseTexture;
-uniform sampler2D shadowMap;
+// Scene state shared by all programs, uploaded once per frame (FrameData in include/frame_data.h)
+layout(std140) uniform FrameData {
+    mat4 viewProjection;    // camera, or the light during the shadow pass
+    mat4 view;
+    mat4 projection;
+    mat4 lightVP[4];        // light view-projection of each shadow cascade (MAX_SHADOW_CASCADES)
+    vec4 cascadeSplits;     // view depth where each cascade ends
+    vec4 cascadeBias;       // depth compare offset of each cascade
+    vec3 lightDir;
+    bool fogEnabled;
+    vec3 lightColor;
+    int cascadeCount;
+    vec3 envColor;
+    vec3 fogColor;
+    vec3 cameraPosition;
+};
+
+// Per object data (DrawData in include/frame_data.h), one slot shared by all planet instances
+layout(std140) uniform DrawData {
+    mat4 M;
+    vec3 modelCenter;
+    float modelScale;
+    vec3 skeletonOffset;
+    float fogDensity;
+};
+
+uniform sampler2DArray diffuseTextures;   // all planet textures, one layer each
+uniform sampler2DArray shadowMap;         // one layer per shadow cascade
+
+// 0.3 in shadow, 1.0 lit. The cascade comes from the view depth of the fragment, the nearest
+// cascade covers the least ground so its texels are the smallest
+float shadowFactor(vec3 position, float ndl) {
+	float viewDepth = -(view * vec4(position, 1.0)).z;
+	int cascade = 0;
+	while (cascade < cascadeCount && viewDepth > cascadeSplits[cascade])
+		cascade++;
+	if (cascade == cascadeCount)
+		return 1.0;		// past the last cascade nothing casts shadows
 
-// Fog uniforms
-uniform vec3 cameraPosition;
-uniform vec3 fogColor;
-uniform float fogDensity;
-uniform bool fogEnabled;
+	// Convert from light clip space to NDC to UV coordinates
+	vec4 lightSpacePos = lightVP[cascade] * vec4(position, 1.0);
+	vec3 proj = lightSpacePos.xyz / lightSpacePos.w;
+	vec2 shadowUV = proj.xy * 0.5 + 0.5;
+	float depth = proj.z * 0.5 + 0.5;
+
+	// Apply shadow if within shadow map bounds
+	if (shadowUV.x < 0.0 || shadowUV.x > 1.0 || shadowUV.y < 0.0 || shadowUV.y > 1.0)
+		return 1.0;
+	float existingDepth = texture(shadowMap, vec3(shadowUV, cascade)).r;
+	// Shadow test, had to increase the bias due to lots of shadow acne:
+	// surfaces turned away from the light cover more depth per texel, so the bias grows with tan(angle)
+	float slope = min(sqrt(1.0 - ndl * ndl) / max(ndl, 0.1), 10.0);
+	return (depth >= existingDepth + cascadeBias[cascade] * (1.0 + slope)) ? 0.3 : 1.0;
+}
 
 void main(){
 	// Normalize the surface normal
@@ -53,21 +96,10 @@ void main(){
 	//   L_total = albedo * (L_ambient + L_diffuse)
 	// This keeps the Lambertian model intact while improving
 	// it with global illumination from the environment.
-	vec3 albedo = texture(diffuseTexture, UV).rgb;
+	vec3 albedo = texture(diffuseTextures, vec3(UV, textureLayer)).rgb;
 	vec3 color = albedo * (ambient + diffuse);
 
-	// Convert from light clip space to NDC to UV coordinates
-	vec3 proj = lightSpacePos.xyz / lightSpacePos.w;
-	vec2 shadowUV = proj.xy * 0.5 + 0.5;
-	float depth = proj.z * 0.5 + 0.5;
-
-	// Apply shadow if within shadow map bounds
-	if (shadowUV.x >= 0.0 && shadowUV.x <= 1.0 && shadowUV.y >= 0.0 && shadowUV.y <= 1.0) {
-		float existingDepth = texture(shadowMap, shadowUV).r;
-		// Shadow test
-		float shadow = (depth >= existingDepth + 0.003) ? 0.3 : 1.0; // had to increase bias to 0.003
-		color *= shadow;											 // due to lots of shadow acne
-	}
+	color *= shadowFactor(worldPos, ndl);
 
 	// Tone mapping (Reinhard)
 	// C_out = C / (C + 1)
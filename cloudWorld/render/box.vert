@@ -1,24 +1,48 @@
 #version 330 core
 layout(location=0) in vec3 vertexPosition;
-layout(location=1) in vec3 vertexNormal;
+layout(location=1) in vec2 vertexNormal;        // octahedral (packOctahedral() in mesh.cpp)
 layout(location=2) in vec2 vertexUV;
+// Per planet, advanced once per instance (PlanetInstance in cloudWorld.cpp)
+layout(location=3) in mat4 instanceModel;       // locations 3 to 6
+layout(location=7) in vec2 instanceRadiusLayer; // x: radius, y: layer in the texture array
 
 out vec3 worldN;
 out vec2 UV;
 out vec3 worldPos;
-out vec4 lightSpacePos; // shadow map
+flat out float textureLayer;
 
-uniform mat4 MVP;
-uniform mat4 M;
-uniform mat4 LightVP; // light view-projection matrix
+// Scene state shared by all programs, uploaded once per frame (FrameData in include/frame_data.h)
+layout(std140) uniform FrameData {
+    mat4 viewProjection;    // camera, or the light during the shadow pass
+    mat4 view;
+    mat4 projection;
+    mat4 lightVP[4];        // light view-projection of each shadow cascade (MAX_SHADOW_CASCADES)
+    vec4 cascadeSplits;     // view depth where each cascade ends
+    vec4 cascadeBias;       // depth compare offset of each cascade
+    vec3 lightDir;
+    bool fogEnabled;
+    vec3 lightColor;
+    int cascadeCount;
+    vec3 envColor;
+    vec3 fogColor;
+    vec3 cameraPosition;
+};
+
+// unfolds an octahedral normal, the lower half of the octahedron is folded over the diagonals
+vec3 unpackOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main(){
-    worldN = mat3(transpose(inverse(M))) * vertexNormal;
-    worldPos = (M * vec4(vertexPosition, 1.0)).xyz;
+    // planets are only rotated and uniformly scaled, so the normal matrix is the model matrix
+    // divided by the radius, no inverse per vertex
+    worldN = mat3(instanceModel) * unpackOctahedral(vertexNormal) / instanceRadiusLayer.x;
+    worldPos = (instanceModel * vec4(vertexPosition, 1.0)).xyz;
     UV = vertexUV;
+    textureLayer = instanceRadiusLayer.y;
 
-    // Calculate position in light space for shadow mapping
-    lightSpacePos = LightVP * vec4(worldPos, 1.0);
-
-    gl_Position = MVP * vec4(vertexPosition,1.0);
+    gl_Position = viewProjection * vec4(worldPos, 1.0);
 }
\ No newline at end of file
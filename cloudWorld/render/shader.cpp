@@ -1,12 +1,16 @@
 #include "shader.h"
 
+#include <glm/gtc/type_ptr.hpp>
+
 #include <string> 
 #include <iostream> 
 #include <fstream>
 #include <sstream> 
 #include <vector>
+#include <cstring>
+#include <algorithm>
 
-GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path)
+ShaderProgram LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path)
 {
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
@@ -25,7 +29,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 	else
 	{
 		printf("Vertex shader not found %s.\n", vertex_file_path);
-		return 0;
+		return ShaderProgram();
 	}
 
 	// Read the Fragment Shader code from the file
@@ -41,7 +45,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 	else
 	{
 		printf("Fragment shader not found %s.\n", fragment_file_path);
-		return 0;
+		return ShaderProgram();
 	}
 
 	GLint Result = GL_FALSE;
@@ -63,7 +67,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 			glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
 			printf("%s\n", &VertexShaderErrorMessage[0]);
 		}
-		return 0;
+		return ShaderProgram();
 	}
 
 	// Compile Fragment Shader
@@ -83,7 +87,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 			glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
 			printf("%s\n", &FragmentShaderErrorMessage[0]);
 		}
-		return 0;
+		return ShaderProgram();
 	}
 
 	// Link the program
@@ -104,7 +108,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 			glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
 			printf("%s\n", &ProgramErrorMessage[0]);
 		}
-		return 0;
+		return ShaderProgram();
 	}
 
 	glDetachShader(ProgramID, VertexShaderID);
@@ -113,10 +117,10 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
-	return ProgramID;
+	return ShaderProgram(ProgramID);
 }
 
-GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode)
+ShaderProgram LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode)
 {
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
@@ -141,7 +145,7 @@ GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentS
 			glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
 			printf("%s\n", &VertexShaderErrorMessage[0]);
 		}
-		return 0;
+		return ShaderProgram();
 	}
 
 	// Compile Fragment Shader
@@ -161,7 +165,7 @@ GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentS
 			glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
 			printf("%s\n", &FragmentShaderErrorMessage[0]);
 		}
-		return 0;
+		return ShaderProgram();
 	}
 
 	// Link the program
@@ -182,7 +186,7 @@ GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentS
 			glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
 			printf("%s\n", &ProgramErrorMessage[0]);
 		}
-		return 0;
+		return ShaderProgram();
 	}
 
 	glDetachShader(ProgramID, VertexShaderID);
@@ -191,5 +195,187 @@ GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentS
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
-	return ProgramID;
+	return ShaderProgram(ProgramID);
+}
+
+ShaderProgram LoadTransformFeedbackShaderFromFile(const char *vertex_file_path, const std::vector<const char*>& varyings)
+{
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+
+	// Read the Vertex Shader code from the file
+	std::string VertexShaderCode;
+	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
+	if (VertexShaderStream.is_open())
+	{
+		std::stringstream sstr;
+		sstr << VertexShaderStream.rdbuf();
+		VertexShaderCode = sstr.str();
+		VertexShaderStream.close();
+	}
+	else
+	{
+		printf("Vertex shader not found %s.\n", vertex_file_path);
+		glDeleteShader(VertexShaderID);
+		return ShaderProgram();
+	}
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+
+	// Compile Vertex Shader
+	printf("Compiling vertex shader : %s\n", vertex_file_path);
+	char const *VertexSourcePointer = VertexShaderCode.c_str();
+	glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
+	glCompileShader(VertexShaderID);
+
+	// Check Vertex Shader
+	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
+	if (!Result) {
+		printf("Error compiling vertex shader : %s\n", vertex_file_path);
+		glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+		if (InfoLogLength > 0) {
+			std::vector<char> VertexShaderErrorMessage(InfoLogLength + 1);
+			glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
+			printf("%s\n", &VertexShaderErrorMessage[0]);
+		}
+		glDeleteShader(VertexShaderID);
+		return ShaderProgram();
+	}
+
+	// Link the program, the captured outputs have to be known before linking
+	printf("Linking program\n");
+	GLuint ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, VertexShaderID);
+	glTransformFeedbackVaryings(ProgramID, static_cast<GLsizei>(varyings.size()), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(ProgramID);
+
+	// Check the program
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (!Result) {
+		printf("Error linking program\n");
+		glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+		if (InfoLogLength > 0)
+		{
+			std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
+			glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+			printf("%s\n", &ProgramErrorMessage[0]);
+		}
+		glDeleteProgram(ProgramID);
+		glDeleteShader(VertexShaderID);
+		return ShaderProgram();
+	}
+
+	glDetachShader(ProgramID, VertexShaderID);
+	glDeleteShader(VertexShaderID);
+
+	return ShaderProgram(ProgramID);
+}
+
+ShaderProgram::ShaderProgram(GLuint program) : id(program)
+{
+	if (id == 0)
+		return;
+
+	// Reflect every active uniform once, the render loops then only deal with handles
+	GLint count = 0, maxNameLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<char> nameBuffer(maxNameLength + 1);
+
+	for (GLint i = 0; i < count; ++i) {
+		Uniform u;
+		GLsizei length = 0;
+		glGetActiveUniform(id, i, maxNameLength, &length, &u.size, &u.type, nameBuffer.data());
+		u.name.assign(nameBuffer.data(), length);
+		u.location = glGetUniformLocation(id, u.name.c_str());
+		if (u.location < 0)
+			continue;	// uniforms inside uniform blocks have no location
+
+		// "jointMatrices[0]" is reported for arrays, we want to look them up as "jointMatrices"
+		size_t bracket = u.name.find('[');
+		if (bracket != std::string::npos)
+			u.name.resize(bracket);
+
+		uniformIndex[u.name] = static_cast<UniformHandle>(uniforms.size());
+		uniforms.push_back(u);
+	}
+
+	bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+	bindUniformBlock("DrawData", DRAW_DATA_BINDING);
+}
+
+void ShaderProgram::bindUniformBlock(const char* blockName, GLuint binding) const
+{
+	GLuint blockIndex = glGetUniformBlockIndex(id, blockName);
+	if (blockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(id, blockIndex, binding);
+}
+
+void ShaderProgram::destroy()
+{
+	glDeleteProgram(id);
+	id = 0;
+	uniforms.clear();
+	uniformIndex.clear();
+}
+
+UniformHandle ShaderProgram::uniform(const std::string& name) const
+{
+	auto it = uniformIndex.find(name);
+	return it != uniformIndex.end() ? it->second : INVALID_UNIFORM;
+}
+
+GLint ShaderProgram::location(const std::string& name) const
+{
+	UniformHandle handle = uniform(name);
+	return handle != INVALID_UNIFORM ? uniforms[handle].location : -1;
+}
+
+bool ShaderProgram::changed(UniformHandle handle, const void* data, size_t bytes)
+{
+	std::vector<unsigned char>& cached = uniforms[handle].value;
+	if (cached.size() == bytes && memcmp(cached.data(), data, bytes) == 0)
+		return false;
+	cached.assign(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + bytes);
+	return true;
+}
+
+void ShaderProgram::set(UniformHandle handle, int value)
+{
+	if (handle == INVALID_UNIFORM || !changed(handle, &value, sizeof(value))) return;
+	glUniform1i(uniforms[handle].location, value);
+}
+
+void ShaderProgram::set(UniformHandle handle, float value)
+{
+	if (handle == INVALID_UNIFORM || !changed(handle, &value, sizeof(value))) return;
+	glUniform1f(uniforms[handle].location, value);
+}
+
+void ShaderProgram::set(UniformHandle handle, const glm::vec3& value)
+{
+	if (handle == INVALID_UNIFORM || !changed(handle, glm::value_ptr(value), sizeof(value))) return;
+	glUniform3fv(uniforms[handle].location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(UniformHandle handle, const glm::mat4& value)
+{
+	if (handle == INVALID_UNIFORM || !changed(handle, glm::value_ptr(value), sizeof(value))) return;
+	glUniformMatrix4fv(uniforms[handle].location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(UniformHandle handle, const glm::mat4* values, GLsizei count)
+{
+	if (handle == INVALID_UNIFORM || count <= 0) return;
+	count = std::min<GLsizei>(count, uniforms[handle].size);
+	if (!changed(handle, values, count * sizeof(glm::mat4))) return;
+	glUniformMatrix4fv(uniforms[handle].location, count, GL_FALSE, glm::value_ptr(values[0]));
+}
+
+void ShaderProgram::set(UniformHandle handle, const glm::mat3x4* values, GLsizei count)
+{
+	if (handle == INVALID_UNIFORM || count <= 0) return;
+	count = std::min<GLsizei>(count, uniforms[handle].size);
+	if (!changed(handle, values, count * sizeof(glm::mat3x4))) return;
+	glUniformMatrix3x4fv(uniforms[handle].location, count, GL_FALSE, glm::value_ptr(values[0]));
 }
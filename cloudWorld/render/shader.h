@@ -2,10 +2,72 @@
 #define _SHADER_H_
 
 #include <glad/gl.h>
+#include <glm/glm.hpp>
+
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// Binding points of the uniform blocks shared by all programs (see include/frame_data.h).
+// Every program gets them assigned when it is linked, so the buffers are bound once for all of them.
+const GLuint FRAME_DATA_BINDING = 0;
+const GLuint DRAW_DATA_BINDING = 1;
+
+// Index into a program's uniform table, resolve it once with ShaderProgram::uniform() and keep it
+typedef int UniformHandle;
+const UniformHandle INVALID_UNIFORM = -1;
+
+// Linked GL program with its active uniforms reflected once at link time (glGetActiveUniform).
+// Name lookups go through a hash table instead of glGetUniformLocation, and the typed setters keep
+// the last uploaded value so unchanged uniforms are not sent again.
+// The setters write to the currently bound program, so call use() first. The value cache assumes
+// uniforms of the program are only ever written through these setters.
+struct ShaderProgram {
+	struct Uniform {
+		std::string name;			// arrays are stored without the "[0]" suffix
+		GLint location;
+		GLenum type;
+		GLint size;					// array length, 1 for plain uniforms
+		std::vector<unsigned char> value;	// last uploaded value, empty until the first set
+	};
+
+	GLuint id = 0;
+	std::vector<Uniform> uniforms;
+	std::unordered_map<std::string, UniformHandle> uniformIndex;
+
+	ShaderProgram() = default;
+	explicit ShaderProgram(GLuint program);
+
+	bool valid() const { return id != 0; }
+	void use() const { glUseProgram(id); }
+	void destroy();
+
+	// Assigns a binding point to the named uniform block, does nothing if the program does not use it
+	void bindUniformBlock(const char* blockName, GLuint binding) const;
+
+	// INVALID_UNIFORM if the program has no active uniform with this name (optimized out, typo...)
+	UniformHandle uniform(const std::string& name) const;
+	GLint location(const std::string& name) const;
+
+	// Setters ignore INVALID_UNIFORM, so optional uniforms need no checks at the call site
+	void set(UniformHandle handle, int value);
+	void set(UniformHandle handle, float value);
+	void set(UniformHandle handle, const glm::vec3& value);
+	void set(UniformHandle handle, const glm::mat4& value);
+	void set(UniformHandle handle, const glm::mat4* values, GLsizei count);
+	void set(UniformHandle handle, const glm::mat3x4* values, GLsizei count);
+
+private:
+	// true (and remembers the new value) when data differs from what was uploaded last time
+	bool changed(UniformHandle handle, const void* data, size_t bytes);
+};
+
+ShaderProgram LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path);
 
-GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path);
+ShaderProgram LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode);
 
-GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode);
+// Vertex shader alone, its outputs named in varyings are captured interleaved by transform feedback
+// (draw with GL_RASTERIZER_DISCARD enabled)
+ShaderProgram LoadTransformFeedbackShaderFromFile(const char *vertex_file_path, const std::vector<const char*>& varyings);
 
 #endif
@@ -3,9 +3,26 @@
 layout(location=0) in vec3 vertexPosition;
 layout(location=2) in vec2 vertexUV;
 out vec2 UV;
-uniform mat4 MVP;
+// Scene state shared by all programs, uploaded once per frame (FrameData in include/frame_data.h)
+layout(std140) uniform FrameData {
+    mat4 viewProjection;    // camera, or the light during the shadow pass
+    mat4 view;
+    mat4 projection;
+    mat4 lightVP[4];        // light view-projection of each shadow cascade (MAX_SHADOW_CASCADES)
+    vec4 cascadeSplits;     // view depth where each cascade ends
+    vec4 cascadeBias;       // depth compare offset of each cascade
+    vec3 lightDir;
+    bool fogEnabled;
+    vec3 lightColor;
+    int cascadeCount;
+    vec3 envColor;
+    vec3 fogColor;
+    vec3 cameraPosition;
+};
 
 void main(){
     UV = vertexUV;
-    gl_Position = MVP * vec4(vertexPosition,1.0);
+    // rotation only, the skybox stays centered on the camera
+    // z = w puts it on the far plane, it is drawn last and only where nothing else was (GL_LEQUAL)
+    gl_Position = (projection * mat4(mat3(view)) * vec4(vertexPosition,1.0)).xyww;
 }
\ No newline at end of file
@@ -0,0 +1,445 @@
+#include "../cloudWorld/include/animation.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+glm::mat4 getNodeTransform(const tinygltf::Node& node) {
+	glm::mat4 transform(1.0f);
+
+	if (node.matrix.size() == 16) {
+		transform = glm::make_mat4(node.matrix.data());
+	} else {
+		if (node.translation.size() == 3) {
+			transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+		}
+		if (node.rotation.size() == 4) {
+			glm::quat q(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
+			transform *= glm::mat4_cast(q);
+		}
+		if (node.scale.size() == 3) {
+			transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+		}
+	}
+	return transform;
+}
+
+void computeLocalNodeTransform(const tinygltf::Model& model,
+	int nodeIndex,
+	std::vector<glm::mat4> &localTransforms)
+{
+	// ---------------------------------------
+	// TODO: your code here
+	// ---------------------------------------
+	// Get the node from the model
+	const tinygltf::Node& node = model.nodes[nodeIndex];
+
+	// Compute and store the local transform for this node
+	localTransforms[nodeIndex] = getNodeTransform(node);
+
+	// Most intuitive way I thought to process the children is via recursion
+	for (int childIndex : node.children) {
+		computeLocalNodeTransform(model, childIndex, localTransforms);
+	}
+}
+
+void computeGlobalNodeTransform(const tinygltf::Model& model,
+	const std::vector<glm::mat4> &localTransforms,
+	int nodeIndex, const glm::mat4& parentTransform,
+	std::vector<glm::mat4> &globalTransforms)
+{
+	// ----------------------------------------
+	// TODO: your code here
+	// ----------------------------------------
+	// Calculate global transform: Parent * Local
+	globalTransforms[nodeIndex] = parentTransform * localTransforms[nodeIndex];
+
+	// Same as local, recursively process the children
+	for (int childIndex : model.nodes[nodeIndex].children) {
+		computeGlobalNodeTransform(model, localTransforms, childIndex,
+								   globalTransforms[nodeIndex], globalTransforms);
+	}
+}
+
+int findKeyframeIndex(const std::vector<float>& times, float animationTime)
+{
+	int left = 0;
+	int right = times.size() - 1;
+
+	while (left <= right) {
+		int mid = (left + right) / 2;
+
+		if (mid + 1 < times.size() && times[mid] <= animationTime && animationTime < times[mid + 1]) {
+			return mid;
+		}
+		else if (times[mid] > animationTime) {
+			right = mid - 1;
+		}
+		else { // animationTime >= times[mid + 1]
+			left = mid + 1;
+		}
+	}
+
+	// Target not found
+	return times.size() - 2;
+}
+
+std::vector<AnimationObject> prepareAnimation(const tinygltf::Model &model)
+{
+	std::vector<AnimationObject> animationObjects;
+	for (const auto &anim : model.animations) {
+		AnimationObject animationObject;
+
+		for (const auto &sampler : anim.samplers) {
+			SamplerObject samplerObject;
+
+			const tinygltf::Accessor &inputAccessor = model.accessors[sampler.input];
+			const tinygltf::BufferView &inputBufferView = model.bufferViews[inputAccessor.bufferView];
+			const tinygltf::Buffer &inputBuffer = model.buffers[inputBufferView.buffer];
+
+			assert(inputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+			assert(inputAccessor.type == TINYGLTF_TYPE_SCALAR);
+
+			// Input (time) values
+			samplerObject.input.resize(inputAccessor.count);
+
+			const unsigned char *inputPtr = &inputBuffer.data[inputBufferView.byteOffset + inputAccessor.byteOffset];
+			const float *inputBuf = reinterpret_cast<const float*>(inputPtr);
+
+			// Read input (time) values
+			int stride = inputAccessor.ByteStride(inputBufferView);
+			for (size_t i = 0; i < inputAccessor.count; ++i) {
+				samplerObject.input[i] = *reinterpret_cast<const float*>(inputPtr + i * stride);
+			}
+
+			const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
+			const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
+			const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
+
+			assert(outputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+
+			const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
+			const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
+
+			int outputStride = outputAccessor.ByteStride(outputBufferView);
+
+			// Output values
+			samplerObject.output.resize(outputAccessor.count);
+
+			for (size_t i = 0; i < outputAccessor.count; ++i) {
+
+				if (outputAccessor.type == TINYGLTF_TYPE_VEC3) {
+					memcpy(&samplerObject.output[i], outputPtr + i * 3 * sizeof(float), 3 * sizeof(float));
+				} else if (outputAccessor.type == TINYGLTF_TYPE_VEC4) {
+					memcpy(&samplerObject.output[i], outputPtr + i * 4 * sizeof(float), 4 * sizeof(float));
+				} else {
+					std::cout << "Unsupport accessor type ..." << std::endl;
+				}
+
+			}
+
+			animationObject.samplers.push_back(samplerObject);
+		}
+
+		animationObjects.push_back(animationObject);
+	}
+	return animationObjects;
+}
+
+void updateAnimation(
+	const tinygltf::Model &model,
+	const tinygltf::Animation &anim,
+	const AnimationObject &animationObject,
+	float time,
+	std::vector<glm::mat4> &nodeTransforms)
+{
+	// There are many channels so we have to accumulate the transforms
+	for (const auto &channel : anim.channels) {
+
+		int targetNodeIndex = channel.target_node;
+		const auto &sampler = anim.samplers[channel.sampler];
+
+		// Access output (value) data for the channel
+		const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
+		const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
+		const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
+
+		// Calculate current animation time (wrap if necessary)
+		const std::vector<float> &times = animationObject.samplers[channel.sampler].input;
+		float animationTime = fmod(time, times.back());
+
+		// ----------------------------------------------------------
+		// TODO: Find a keyframe for getting animation data
+		// ----------------------------------------------------------
+		int keyframeIndex = findKeyframeIndex(times, animationTime);
+
+		const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
+		const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
+
+		// -----------------------------------------------------------
+		// TODO: Add interpolation for smooth interpolation
+		// -----------------------------------------------------------
+
+		float time0 = times[keyframeIndex];
+		float time1 = times[keyframeIndex + 1];
+		float alpha = (animationTime - time0) / (time1 - time0);
+		alpha = glm::clamp(alpha, 0.0f, 1.0f);
+
+		if (channel.target_path == "translation") {
+			// translation vectors from keyframes
+			glm::vec3 translation0, translation1;
+			memcpy(&translation0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
+			memcpy(&translation1, outputPtr + (keyframeIndex + 1) * 3 * sizeof(float), 3 * sizeof(float));
+
+			// linear interpolation between keyframes
+			glm::vec3 translation = glm::mix(translation0, translation1, alpha);
+			nodeTransforms[targetNodeIndex] *= glm::translate(glm::mat4(1.0f), translation);
+		} else if (channel.target_path == "rotation") {
+			// quaternions from the keyframes
+			glm::quat rotation0, rotation1;
+			memcpy(&rotation0, outputPtr + keyframeIndex * 4 * sizeof(float), 4 * sizeof(float));
+			memcpy(&rotation1, outputPtr + (keyframeIndex + 1) * 4 * sizeof(float), 4 * sizeof(float));
+
+			// slerp - spherical linear interpolation (smooth rotation)
+			glm::quat rotation = glm::slerp(rotation0, rotation1, alpha);
+			nodeTransforms[targetNodeIndex] *= glm::mat4_cast(rotation);
+		} else if (channel.target_path == "scale") {
+			// similar process as translation, get scale vectors from keyframes and do the same type of interpolation
+			glm::vec3 scale0, scale1;
+			memcpy(&scale0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
+			memcpy(&scale1, outputPtr + (keyframeIndex + 1) * 3 * sizeof(float), 3 * sizeof(float));
+
+			// same as translation, linear interpolation
+			glm::vec3 scale = glm::mix(scale0, scale1, alpha);
+			nodeTransforms[targetNodeIndex] *= glm::scale(glm::mat4(1.0f), scale);
+		}
+	}
+}
+
+glm::mat4 NodePose::matrix() const {
+	// same as translate(T) * mat4_cast(R) * scale(S), without the matrix products
+	glm::mat3 r = glm::mat3_cast(rotation);
+	glm::mat4 m(1.0f);
+	m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+	m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+	m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+	m[3] = glm::vec4(translation, 1.0f);
+	return m;
+}
+
+AnimationClip compileAnimation(
+	const tinygltf::Model &model,
+	const tinygltf::Animation &anim,
+	const AnimationObject &animationObject)
+{
+	AnimationClip clip;
+	for (const tinygltf::AnimationChannel &channel : anim.channels) {
+		ClipChannel compiled;
+		if (channel.target_path == "translation")
+			compiled.target = TARGET_TRANSLATION;
+		else if (channel.target_path == "rotation")
+			compiled.target = TARGET_ROTATION;
+		else if (channel.target_path == "scale")
+			compiled.target = TARGET_SCALE;
+		else
+			continue;	// morph target weights, the bot has none
+		if (channel.target_node < 0 || channel.target_node >= static_cast<int>(model.nodes.size()) ||
+			channel.sampler < 0 || channel.sampler >= static_cast<int>(animationObject.samplers.size()))
+			continue;
+
+		const SamplerObject &sampler = animationObject.samplers[channel.sampler];
+		const std::string &interpolation = anim.samplers[channel.sampler].interpolation;
+		// cubic splines store (in tangent, value, out tangent) per key, only the values are kept
+		bool cubic = interpolation == "CUBICSPLINE";
+		size_t keyCount = sampler.input.size();
+		if (keyCount == 0 || sampler.output.size() < keyCount * (cubic ? 3 : 1))
+			continue;
+
+		compiled.node = channel.target_node;
+		compiled.interpolation = interpolation == "STEP" ? INTERPOLATION_STEP : INTERPOLATION_LINEAR;
+		compiled.firstKey = static_cast<uint32_t>(clip.times.size());
+		compiled.keyCount = static_cast<uint32_t>(keyCount);
+		for (size_t k = 0; k < keyCount; ++k) {
+			clip.times.push_back(sampler.input[k]);
+			clip.values.push_back(sampler.output[cubic ? k * 3 + 1 : k]);
+		}
+		clip.duration = std::max(clip.duration, sampler.input.back());
+		clip.channels.push_back(compiled);
+	}
+	return clip;
+}
+
+static glm::quat toQuat(const glm::vec4 &v) {
+	return glm::quat(v.w, v.x, v.y, v.z);
+}
+
+void sampleClip(const AnimationClip &clip, float time, std::vector<uint32_t> &cursors, std::vector<NodePose> &pose)
+{
+	cursors.resize(clip.channels.size(), 0);
+	// channels usually share their last key, the wrapped time only changes with it
+	float wrapEnd = -1.0f, animationTime = 0.0f;
+	for (size_t c = 0; c < clip.channels.size(); ++c) {
+		const ClipChannel &channel = clip.channels[c];
+		const float *times = &clip.times[channel.firstKey];
+		const glm::vec4 *values = &clip.values[channel.firstKey];
+		uint32_t last = channel.keyCount - 1;
+
+		// key k with times[k] <= animationTime < times[k + 1] (k + 1 is always a key), or the two ends
+		uint32_t k = 0;
+		float alpha = 0.0f;
+		if (last > 0) {
+			if (times[last] != wrapEnd) {
+				wrapEnd = times[last];
+				animationTime = std::fmod(time, wrapEnd);
+				if (animationTime < 0.0f) animationTime += wrapEnd;
+			}
+
+			k = std::min(cursors[c], last - 1);
+			if (animationTime >= times[k] && (k + 1 == last || animationTime < times[k + 2])) {
+				if (animationTime >= times[k + 1] && k + 1 < last)
+					++k;
+			} else {
+				// jumped (the first call, the loop wrapping around or a large step), search all the keys
+				k = static_cast<uint32_t>(std::upper_bound(times, times + last, animationTime) - times);
+				k = std::min(k > 0 ? k - 1 : 0, last - 1);
+			}
+			cursors[c] = k;
+			alpha = glm::clamp((animationTime - times[k]) / (times[k + 1] - times[k]), 0.0f, 1.0f);
+			if (channel.interpolation == INTERPOLATION_STEP) {
+				k = alpha >= 1.0f ? k + 1 : k;
+				alpha = 0.0f;
+			}
+		}
+
+		NodePose &node = pose[channel.node];
+		const glm::vec4 &value0 = values[k];
+		const glm::vec4 &value1 = values[std::min(k + 1, last)];
+		switch (channel.target) {
+		case TARGET_TRANSLATION:
+			node.translation = glm::vec3(glm::mix(value0, value1, alpha));
+			break;
+		case TARGET_ROTATION:
+			// slerp - spherical linear interpolation (smooth rotation)
+			node.rotation = glm::slerp(toQuat(value0), toQuat(value1), alpha);
+			break;
+		case TARGET_SCALE:
+			node.scale = glm::vec3(glm::mix(value0, value1, alpha));
+			break;
+		}
+	}
+}
+
+Skeleton flattenSkeleton(const tinygltf::Model &model, const tinygltf::Skin &skin)
+{
+	Skeleton skeleton;
+	if (skin.joints.empty())
+		return skeleton;
+
+	// breadth first, every entry's children are appended after it
+	std::vector<int> entryOfNode(model.nodes.size(), -1);
+	skeleton.nodes.push_back(skin.joints[0]);
+	skeleton.parents.push_back(-1);
+	entryOfNode[skin.joints[0]] = 0;
+	for (size_t e = 0; e < skeleton.nodes.size(); ++e) {
+		for (int child : model.nodes[skeleton.nodes[e]].children) {
+			if (entryOfNode[child] >= 0)
+				continue;
+			entryOfNode[child] = static_cast<int>(skeleton.nodes.size());
+			skeleton.nodes.push_back(child);
+			skeleton.parents.push_back(static_cast<int>(e));
+		}
+	}
+
+	for (int joint : skin.joints)
+		skeleton.jointEntries.push_back(std::max(entryOfNode[joint], 0));
+	return skeleton;
+}
+
+void composeSkeleton(const Skeleton &skeleton, const std::vector<NodePose> &pose, std::vector<glm::mat4> &globals)
+{
+	for (size_t e = 0; e < skeleton.nodes.size(); ++e) {
+		int parent = skeleton.parents[e];
+		glm::mat4 local = pose[skeleton.nodes[e]].matrix();
+		globals[e] = parent < 0 ? local : globals[parent] * local;
+	}
+}
+
+glm::mat3x4 affineRows(const glm::mat4 &m)
+{
+	// glm is column major, so row r is (m[0][r], m[1][r], m[2][r], m[3][r])
+	return glm::mat3x4(
+		glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]),
+		glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]),
+		glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]));
+}
+
+void skinJoints(
+	const Skeleton &skeleton,
+	const std::vector<glm::mat4> &globals,
+	const std::vector<glm::mat4> &inverseBindMatrices,
+	std::vector<glm::mat3x4> &jointMatrices)
+{
+	for (size_t j = 0; j < skeleton.jointEntries.size(); ++j)
+		jointMatrices[j] = affineRows(globals[skeleton.jointEntries[j]] * inverseBindMatrices[j]);
+}
+
+float JointPalette::frame(float time) const {
+	if (frameCount < 2 || duration <= 0.0f)
+		return 0.0f;
+	float wrapped = std::fmod(time, duration);
+	if (wrapped < 0.0f) wrapped += duration;
+	// stays below the last row so there is always a next one to blend with
+	return std::min(wrapped * frameRate, frameCount - 1.001f);
+}
+
+JointPalette bakeJointPalette(
+	const tinygltf::Model &model,
+	const AnimationClip &clip,
+	const tinygltf::Skin &skin,
+	const std::vector<glm::mat4> &inverseBindMatrices,
+	float sampleRate)
+{
+	if (skin.joints.empty())
+		return JointPalette();
+	return bakeJointPalette(flattenSkeleton(model, skin), model.nodes.size(), clip, inverseBindMatrices, sampleRate);
+}
+
+JointPalette bakeJointPalette(
+	const Skeleton &skeleton,
+	size_t nodeCount,
+	const AnimationClip &clip,
+	const std::vector<glm::mat4> &inverseBindMatrices,
+	float sampleRate)
+{
+	JointPalette palette;
+	palette.duration = clip.duration;
+	if (skeleton.jointEntries.empty() || palette.duration <= 0.0f || sampleRate <= 0.0f)
+		return palette;
+
+	int intervals = std::max(1, static_cast<int>(std::ceil(palette.duration * sampleRate)));
+	palette.jointCount = static_cast<int>(skeleton.jointEntries.size());
+	palette.frameCount = intervals + 1;
+	palette.frameRate = intervals / palette.duration;
+	palette.texels.resize(size_t(palette.frameCount) * palette.jointCount * 3);
+
+	std::vector<uint32_t> cursors;
+	std::vector<NodePose> pose(nodeCount);
+	std::vector<glm::mat4> globals(skeleton.size());
+	std::vector<glm::mat3x4> jointMatrices(palette.jointCount);
+	for (int f = 0; f < palette.frameCount; ++f) {
+		// the last row lands on the duration, which sampleClip() wraps back to the start
+		float time = f * palette.duration / intervals;
+		std::fill(pose.begin(), pose.end(), NodePose());
+		sampleClip(clip, time, cursors, pose);
+		composeSkeleton(skeleton, pose, globals);
+		skinJoints(skeleton, globals, inverseBindMatrices, jointMatrices);
+		memcpy(&palette.texels[size_t(f) * palette.jointCount * 3], jointMatrices.data(),
+			   jointMatrices.size() * sizeof(glm::mat3x4));
+	}
+	return palette;
+}
@@ -0,0 +1,72 @@
+#include "../cloudWorld/include/asset_loader.h"
+#include "../cloudWorld/include/profiler.h"
+
+#include <chrono>
+
+void AssetLoader::start(unsigned threads) {
+	stopping = false;
+	workers.start(threads);
+}
+
+void AssetLoader::stop() {
+	stopping = true;
+	workers.stop();
+
+	std::shared_ptr<Request> request;
+	while (ready.tryPop(request)) {}
+	inFlight = 0;
+}
+
+void AssetLoader::submit(std::function<void()> decode, std::function<void()> upload) {
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->decode = std::move(decode);
+	request->upload = std::move(upload);
+	++inFlight;
+
+	workers.submit([this, request]() {
+		request->decode();
+		// queue full: wait for the GL thread to make room
+		while (!ready.tryPush(request)) {
+			if (stopping) return;
+			std::this_thread::yield();
+		}
+	});
+}
+
+void AssetLoader::loadTexture(const std::string& path, const std::string& cacheDir, bool compress,
+							  std::function<void(const TextureData&)> onReady) {
+	std::shared_ptr<TextureData> texture = std::make_shared<TextureData>();
+	submit(
+		[path, cacheDir, compress, texture]() {
+			::loadTexture(path, cacheDir, compress, *texture);
+		},
+		[texture, onReady]() {
+			onReady(*texture);
+		});
+}
+
+size_t AssetLoader::pump(double budgetMs) {
+	if (inFlight == 0)
+		return 0;
+
+	PROFILE_ZONE("asset upload");
+	auto start = std::chrono::steady_clock::now();
+	std::shared_ptr<Request> request;
+	while (ready.tryPop(request)) {
+		request->upload();
+		request.reset();	// frees the decoded data right away
+		--inFlight;
+
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (elapsedMs >= budgetMs)
+			break;
+	}
+	return inFlight;
+}
+
+void AssetLoader::finish() {
+	while (inFlight > 0) {
+		if (pump(1e9) > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
@@ -1,392 +1,140 @@
 #include "../cloudWorld/include/bot.h"
 
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <tiny_gltf.h>
-
-// lighting and shadow parameters for all bot instances
-glm::vec3 MyBot::lightDirection;
-glm::vec3 MyBot::lightColor;
-glm::vec3 MyBot::envColor;
-glm::mat4 MyBot::lightVP;			// Light view-projection for shadow mapping
-GLuint MyBot::shadowDepthTexture;	// shadow map texture
-
-glm::mat4 MyBot::getNodeTransform(const tinygltf::Node& node) {
-	glm::mat4 transform(1.0f);
-
-	if (node.matrix.size() == 16) {
-		transform = glm::make_mat4(node.matrix.data());
-	} else {
-		if (node.translation.size() == 3) {
-			transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
-		}
-		if (node.rotation.size() == 4) {
-			glm::quat q(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
-			transform *= glm::mat4_cast(q);
-		}
-		if (node.scale.size() == 3) {
-			transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
-		}
-	}
-	return transform;
-}
-
-void MyBot::computeLocalNodeTransform(const tinygltf::Model& model,
-	int nodeIndex,
-	std::vector<glm::mat4> &localTransforms)
-{
-	// ---------------------------------------
-	// TODO: your code here
-	// ---------------------------------------
-	// Get the node from the model
-	const tinygltf::Node& node = model.nodes[nodeIndex];
-
-	// Compute and store the local transform for this node
-	localTransforms[nodeIndex] = getNodeTransform(node);
-
-	// Most intuitive way I thought to process the children is via recursion
-	for (int childIndex : node.children) {
-		computeLocalNodeTransform(model, childIndex, localTransforms);
-	}
-}
-
-void MyBot::computeGlobalNodeTransform(const tinygltf::Model& model,
-	const std::vector<glm::mat4> &localTransforms,
-	int nodeIndex, const glm::mat4& parentTransform,
-	std::vector<glm::mat4> &globalTransforms)
-{
-	// ----------------------------------------
-	// TODO: your code here
-	// ----------------------------------------
-	// Calculate global transform: Parent * Local
-	globalTransforms[nodeIndex] = parentTransform * localTransforms[nodeIndex];
-
-	// Same as local, recursively process the children
-	for (int childIndex : model.nodes[nodeIndex].children) {
-		computeGlobalNodeTransform(model, localTransforms, childIndex,
-								   globalTransforms[nodeIndex], globalTransforms);
-	}
-}
-
-std::vector<MyBot::SkinObject> MyBot::prepareSkinning(const tinygltf::Model &model) {
-	std::vector<SkinObject> skinObjects;
-
-	// In our Blender exporter, the default number of joints that may influence a vertex is set to 4, just for convenient implementation in shaders.
-
-	for (size_t i = 0; i < model.skins.size(); i++) {
-		SkinObject skinObject;
-
-		const tinygltf::Skin &skin = model.skins[i];
-
-		// Read inverseBindMatrices
-		const tinygltf::Accessor &accessor = model.accessors[skin.inverseBindMatrices];
-		assert(accessor.type == TINYGLTF_TYPE_MAT4);
-		const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-		const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-		const float *ptr = reinterpret_cast<const float *>(
-            buffer.data.data() + accessor.byteOffset + bufferView.byteOffset);
-
-		skinObject.inverseBindMatrices.resize(accessor.count);
-		for (size_t j = 0; j < accessor.count; j++) {
-			float m[16];
-			memcpy(m, ptr + j * 16, 16 * sizeof(float));
-			skinObject.inverseBindMatrices[j] = glm::make_mat4(m);
-		}
-
-		assert(skin.joints.size() == accessor.count);
-
-		skinObject.globalJointTransforms.resize(skin.joints.size());
-		skinObject.jointMatrices.resize(skin.joints.size());
-
-		// ----------------------------------------------
-		// TODO: your code here to compute joint matrices
-		// ----------------------------------------------
-
-		// calculate local transforms for each node
-		int root = skin.joints[0];
-		std::vector<glm::mat4> localNodeTransforms(model.nodes.size());
-		computeLocalNodeTransform(model, root, localNodeTransforms);
-
-		// Having done the locals, now calculate the global for all nodes
-		std::vector<glm::mat4> globalNodeTransforms(model.nodes.size());
-		computeGlobalNodeTransform(model, localNodeTransforms, root, glm::mat4(1.0f), globalNodeTransforms);
-
-		// compute joint matrices
-		for (size_t j = 0; j < skin.joints.size(); ++j) {
-			int nodeIdx = skin.joints[j];
-			// The global transform of the joint node
-			skinObject.globalJointTransforms[j] = globalNodeTransforms[nodeIdx];
-
-			// GlobalTransform * InverseBindMatrix is the matrix sent to the shader
-			skinObject.jointMatrices[j] = skinObject.globalJointTransforms[j] * skinObject.inverseBindMatrices[j];
-		}
-		// ----------------------------------------------
-
-		skinObjects.push_back(skinObject);
-	}
-	return skinObjects;
-}
-
-int MyBot::findKeyframeIndex(const std::vector<float>& times, float animationTime)
-{
-	int left = 0;
-	int right = times.size() - 1;
-
-	while (left <= right) {
-		int mid = (left + right) / 2;
+#include <unordered_map>
 
-		if (mid + 1 < times.size() && times[mid] <= animationTime && animationTime < times[mid + 1]) {
-			return mid;
-		}
-		else if (times[mid] > animationTime) {
-			right = mid - 1;
-		}
-		else { // animationTime >= times[mid + 1]
-			left = mid + 1;
-		}
-	}
-
-	// Target not found
-	return times.size() - 2;
-}
-
-std::vector<MyBot::AnimationObject> MyBot::prepareAnimation(const tinygltf::Model &model)
-{
-	std::vector<AnimationObject> animationObjects;
-	for (const auto &anim : model.animations) {
-		AnimationObject animationObject;
-
-		for (const auto &sampler : anim.samplers) {
-			SamplerObject samplerObject;
-
-			const tinygltf::Accessor &inputAccessor = model.accessors[sampler.input];
-			const tinygltf::BufferView &inputBufferView = model.bufferViews[inputAccessor.bufferView];
-			const tinygltf::Buffer &inputBuffer = model.buffers[inputBufferView.buffer];
-
-			assert(inputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-			assert(inputAccessor.type == TINYGLTF_TYPE_SCALAR);
-
-			// Input (time) values
-			samplerObject.input.resize(inputAccessor.count);
-
-			const unsigned char *inputPtr = &inputBuffer.data[inputBufferView.byteOffset + inputAccessor.byteOffset];
-			const float *inputBuf = reinterpret_cast<const float*>(inputPtr);
-
-			// Read input (time) values
-			int stride = inputAccessor.ByteStride(inputBufferView);
-			for (size_t i = 0; i < inputAccessor.count; ++i) {
-				samplerObject.input[i] = *reinterpret_cast<const float*>(inputPtr + i * stride);
-			}
-
-			const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
-			const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
-			const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
-
-			assert(outputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-
-			const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
-			const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
-
-			int outputStride = outputAccessor.ByteStride(outputBufferView);
-
-			// Output values
-			samplerObject.output.resize(outputAccessor.count);
-
-			for (size_t i = 0; i < outputAccessor.count; ++i) {
-
-				if (outputAccessor.type == TINYGLTF_TYPE_VEC3) {
-					memcpy(&samplerObject.output[i], outputPtr + i * 3 * sizeof(float), 3 * sizeof(float));
-				} else if (outputAccessor.type == TINYGLTF_TYPE_VEC4) {
-					memcpy(&samplerObject.output[i], outputPtr + i * 4 * sizeof(float), 4 * sizeof(float));
-				} else {
-					std::cout << "Unsupport accessor type ..." << std::endl;
-				}
-
-			}
-
-			animationObject.samplers.push_back(samplerObject);
-		}
-
-		animationObjects.push_back(animationObject);
-	}
-	return animationObjects;
-}
-
-void MyBot::updateAnimation(
-	const tinygltf::Model &model,
-	const tinygltf::Animation &anim,
-	const AnimationObject &animationObject,
-	float time,
-	std::vector<glm::mat4> &nodeTransforms)
-{
-	// There are many channels so we have to accumulate the transforms
-	for (const auto &channel : anim.channels) {
-
-		int targetNodeIndex = channel.target_node;
-		const auto &sampler = anim.samplers[channel.sampler];
-
-		// Access output (value) data for the channel
-		const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
-		const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
-		const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
-
-		// Calculate current animation time (wrap if necessary)
-		const std::vector<float> &times = animationObject.samplers[channel.sampler].input;
-		float animationTime = fmod(time, times.back());
-
-		// ----------------------------------------------------------
-		// TODO: Find a keyframe for getting animation data
-		// ----------------------------------------------------------
-		int keyframeIndex = findKeyframeIndex(times, animationTime);
-
-		const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
-		const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
-
-		// -----------------------------------------------------------
-		// TODO: Add interpolation for smooth interpolation
-		// -----------------------------------------------------------
-
-		float time0 = times[keyframeIndex];
-		float time1 = times[keyframeIndex + 1];
-		float alpha = (animationTime - time0) / (time1 - time0);
-		alpha = glm::clamp(alpha, 0.0f, 1.0f);
-
-		if (channel.target_path == "translation") {
-			// translation vectors from keyframes
-			glm::vec3 translation0, translation1;
-			memcpy(&translation0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-			memcpy(&translation1, outputPtr + (keyframeIndex + 1) * 3 * sizeof(float), 3 * sizeof(float));
-
-			// linear interpolation between keyframes
-			glm::vec3 translation = glm::mix(translation0, translation1, alpha);
-			nodeTransforms[targetNodeIndex] *= glm::translate(glm::mat4(1.0f), translation);
-		} else if (channel.target_path == "rotation") {
-			// quaternions from the keyframes
-			glm::quat rotation0, rotation1;
-			memcpy(&rotation0, outputPtr + keyframeIndex * 4 * sizeof(float), 4 * sizeof(float));
-			memcpy(&rotation1, outputPtr + (keyframeIndex + 1) * 4 * sizeof(float), 4 * sizeof(float));
-
-			// slerp - spherical linear interpolation (smooth rotation)
-			glm::quat rotation = glm::slerp(rotation0, rotation1, alpha);
-			nodeTransforms[targetNodeIndex] *= glm::mat4_cast(rotation);
-		} else if (channel.target_path == "scale") {
-			// similar process as translation, get scale vectors from keyframes and do the same type of interpolation
-			glm::vec3 scale0, scale1;
-			memcpy(&scale0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-			memcpy(&scale1, outputPtr + (keyframeIndex + 1) * 3 * sizeof(float), 3 * sizeof(float));
-
-			// same as translation, linear interpolation
-			glm::vec3 scale = glm::mix(scale0, scale1, alpha);
-			nodeTransforms[targetNodeIndex] *= glm::scale(glm::mat4(1.0f), scale);
-		}
-	}
-}
-
-void MyBot::updateSkinning(const std::vector<glm::mat4> &nodeTransforms) {
+void MyBot::updateSkinning() {
 
 	// -------------------------------------------------
 	// TODO: Recompute joint matrices
 	// -------------------------------------------------
-	const tinygltf::Skin &skin = model.skins[0];
 	SkinObject &skinObject = skinObjects[0];
 
-	// update skinning: recompute transforms and update matrices
-	// recompute global transforms using the newest animated nodeTransforms
-	// again, assuming joint[0] is the root
-	int root = skin.joints[0];
-	std::vector<glm::mat4> globalNodeTransforms(model.nodes.size());
-
-	computeGlobalNodeTransform(model, nodeTransforms, root, glm::mat4(1.0f), globalNodeTransforms);
+	// update skinning: recompute the global transforms from the newest pose, parents first
+	// (the skeleton was flattened from joint[0], the root, in setupModel())
+	composeSkeleton(skeleton, pose, skeletonGlobals);
 
 	// Update the joint matrices
-	for (size_t j = 0; j < skin.joints.size(); ++j) {
-		int nodeIdx = skin.joints[j];
-		skinObject.jointMatrices[j] = globalNodeTransforms[nodeIdx] * skinObject.inverseBindMatrices[j];
-	}
+	skinJoints(skeleton, skeletonGlobals, skinObject.inverseBindMatrices, skinObject.jointMatrices);
 }
 
-void MyBot::update(float time) {
+void MyBot::update(float time, std::vector<uint32_t>* cursors) {
 
 	// -------------------------------------------------
 	// TODO: your code here
 	// -------------------------------------------------
-	if (model.animations.size() > 0) {
-		const tinygltf::Animation &animation = model.animations[0];
-		const AnimationObject &animationObject = animationObjects[0];
-		const tinygltf::Skin &skin = model.skins[0];
-
-		// base transform will be the identity matrix
-		std::vector<glm::mat4> nodeTransforms(model.nodes.size());
-		for (size_t i = 0; i < nodeTransforms.size(); ++i) {
-			nodeTransforms[i] = glm::mat4(1.0f);
-		}
-		// animation channels
-		updateAnimation(model, animation, animationObject, time, nodeTransforms);
-		// update skinning with newest transformation nodes
-		updateSkinning(nodeTransforms);
+	if (!clips.empty() && !skinObjects.empty()) {
+		// base pose will be the identity, the buffers were allocated by setupModel()
+		std::fill(pose.begin(), pose.end(), NodePose());
+		// animation channels, from the compiled clip
+		sampleClip(clips[0], time, cursors ? *cursors : playbackCursors, pose);
+		// update skinning with the newest pose
+		updateSkinning();
 	}
 }
 
-bool MyBot::loadModel(tinygltf::Model &model, const char *filename) {
-	tinygltf::TinyGLTF loader;
-	std::string err;
-	std::string warn;
+void MyBot::initialize(AssetLoader& loader, const std::string& cacheDir, float bakeRate) {
+	// fog parameters for atmospheric depth effect
+	fogDensity = 0.03f;
 
-	bool res = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
-	if (!warn.empty()) {
-		std::cout << "WARN: " << warn << std::endl;
-	}
+	// mapping the model cache (or importing bot.gltf into it on the first launch) runs on the loader,
+	// the GL setup waits for it on the render thread and the mapping goes away once it is uploaded
+	std::shared_ptr<ModelData> data = std::make_shared<ModelData>();
+	std::shared_ptr<JointPalette> baked = std::make_shared<JointPalette>();
+	std::shared_ptr<bool> ok = std::make_shared<bool>(false);
+	loader.submit(
+		[data, baked, ok, cacheDir, bakeRate]() {
+			*ok = loadModel(BOT_MODEL_PATH, cacheDir, *data);
+			if (!*ok)
+				return;
+			// the same pose update() computes, ahead of time for the whole first animation
+			if (bakeRate > 0.0f && !data->clips.empty() && !data->inverseBindMatrices.empty())
+				*baked = bakeJointPalette(data->skeleton, data->nodeCount, data->clips[0], data->inverseBindMatrices, bakeRate);
+		},
+		[this, data, baked, ok]() {
+			if (!*ok) return;
+			palette = std::move(*baked);
+			setupModel(*data);
+		});
 
-	if (!err.empty()) {
-		std::cout << "ERR: " << err << std::endl;
+	// Create and compile our GLSL program from the shaders
+	std::cout << "Loading shader..." << std::endl;
+	program = LoadShadersFromFile("../cloudWorld/render/bot.vert", "../cloudWorld/render/bot.frag");
+	std::cout << "programID = " << program.id << std::endl;
+	if (!program.valid())
+	{
+		std::cerr << "Failed to load shaders." << std::endl;
 	}
 
-	if (!res)
-		std::cout << "Failed to load glTF: " << filename << std::endl;
-	else
-		std::cout << "Loaded glTF: " << filename << std::endl;
+	// Print the actual shader source being loaded:
+	std::cout << "Loading shaders from:" << std::endl;
+	std::cout << "  Vertex: ../cloudWorld/render/bot.vert" << std::endl;
+	std::cout << "  Fragment: ../cloudWorld/render/bot.frag" << std::endl;
 
-	return res;
+	// Get a handle for GLSL variables
+	// Matrices, light and fog live in the FrameData/DrawData uniform blocks now,
+	// the model matrix and the pose of each humanoid in its instance
+	bakedAnimationID = program.uniform("bakedAnimation");
+
+	// shadow map always on unit 1, the joint palette on 2, the CPU poses on 3
+	program.use();
+	program.set(program.uniform("shadowMap"), 1);
+	program.set(program.uniform("jointPalette"), 2);
+	program.set(program.uniform("jointBuffer"), 3);
+	glUseProgram(0);
+
+	// skinning pre-pass and the program drawing what it captured, same texture units
+	skinningProgram = LoadTransformFeedbackShaderFromFile("../cloudWorld/render/bot_skinning.vert", {"skinnedVertex"});
+	skinnedProgram = LoadShadersFromFile("../cloudWorld/render/bot_skinned.vert", "../cloudWorld/render/bot.frag");
+	if (!skinningProgram.valid() || !skinnedProgram.valid())
+		std::cerr << "Failed to load the skinning pre-pass shaders, skinning in bot.vert." << std::endl;
+	skinningBakedID = skinningProgram.uniform("bakedAnimation");
+	skinnedBaseID = skinnedProgram.uniform("skinnedBase");
+	skinnedVertexCountID = skinnedProgram.uniform("skinnedVertexCount");
+	skinningProgram.use();
+	skinningProgram.set(skinningProgram.uniform("jointPalette"), 2);
+	skinningProgram.set(skinningProgram.uniform("jointBuffer"), 3);
+	skinnedProgram.use();
+	skinnedProgram.set(skinnedProgram.uniform("shadowMap"), 1);
+	skinnedProgram.set(skinnedProgram.uniform("skinnedVertices"), 4);
+	glUseProgram(0);
+
+	// instances and poses, refilled every frame by uploadInstances() and uploadPoses()
+	instanceStream.create(GL_ARRAY_BUFFER, 64 * sizeof(BotInstance));
+
+	// pose regions start on a whole texel
+	jointStream.create(GL_TEXTURE_BUFFER, 64 * sizeof(glm::mat3x4), sizeof(glm::vec4));
+	glGenTextures(1, &jointTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, jointTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, jointStream.buffer);
+	jointTextureBuffer = jointStream.buffer;
+
+	// skinned copies, written by skin() every frame
+	glGenBuffers(1, &skinnedBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, skinnedBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, 0, nullptr, GL_STREAM_COPY);
+	glGenTextures(1, &skinnedTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, skinnedTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, skinnedBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxSkinnedTexels);
 }
 
-void MyBot::initialize() {
-	if (!loadModel(model, "../cloudWorld/assets/models/bot/bot.gltf")) {
-		return;
-	}
-
+void MyBot::setupModel(const ModelData& data) {
 	// Prepare buffers for rendering
-	primitiveObjects = bindModel(model);
+	primitiveObjects = bindModel(data);
 
 	// Calculate centering/scale
 	// This centers the model at origin and scales to approximately 1 unit
 	// I believe it was needed because the GLTF model has offset center and large scale
-	glm::vec3 botMin(FLT_MAX);
-	glm::vec3 botMax(-FLT_MAX);
-
-	for (const auto& mesh : model.meshes) {
-		for (const auto& primitive : mesh.primitives) {
-			auto posIt = primitive.attributes.find("POSITION");
-			if (posIt != primitive.attributes.end()) {
-				const auto& accessor = model.accessors[posIt->second];
-				for (int i = 0; i < 3; i++) {
-					botMin[i] = std::min(botMin[i], (float)accessor.minValues[i]);
-					botMax[i] = std::max(botMax[i], (float)accessor.maxValues[i]);
-				}
-			}
-		}
-	}
+	// (the bounds of the POSITION accessors, kept by the importer)
+	glm::vec3 botMin = data.boundsMin;
+	glm::vec3 botMax = data.boundsMax;
 
 	modelCenter = (botMin + botMax) * 0.5f;
 	float botSize = glm::length(botMax - botMin);
 	modelScale = 1.0f / botSize;  // Normalize to 1 unit
 
-	// fog parameters for atmospheric depth effect
-	fogEnabled = true;
-	fogColor = glm::vec3(0.02f, 0.02f, 0.08f); // a dark blue matching the skybox nebula texture
-	fogDensity = 0.03f;
-	cameraPosition = glm::vec3(0.0f);
-
 	// Calculate skeleton root offset to position bot properly
 	// from my debugging: the skeleton's root joint was never at the model's geometric center,
 	// so I computed the offset to align them
@@ -400,262 +148,294 @@ void MyBot::initialize() {
 	// offset
 	skeletonOffset = -(skeletonRoot + modelCenter);
 
-	// Prepare joint matrices
-	skinObjects = prepareSkinning(model);
+	// Prepare animation data, compiled by the importer
+	clips = data.clips;
+	playbackCursors.clear();
 
-	// Prepare animation data
-	animationObjects = prepareAnimation(model);
+	// flattened hierarchy and the pose buffers for update()
+	skeleton = data.skeleton;
+	pose.assign(data.nodeCount, NodePose());
+	skeletonGlobals.assign(skeleton.size(), glm::mat4(1.0f));
 
-	// Create and compile our GLSL program from the shaders
-	std::cout << "Loading shader..." << std::endl;
-	programID = LoadShadersFromFile("../cloudWorld/render/bot.vert", "../cloudWorld/render/bot.frag");
-	std::cout << "programID = " << programID << std::endl;
-	if (programID == 0)
-	{
-		std::cerr << "Failed to load shaders." << std::endl;
+	// Prepare joint matrices, of the first skin in its base pose until update() animates it
+	skinObjects.clear();
+	if (!data.inverseBindMatrices.empty()) {
+		SkinObject skinObject;
+		skinObject.inverseBindMatrices = data.inverseBindMatrices;
+		skinObject.jointMatrices.resize(skinObject.inverseBindMatrices.size());
+		skinObjects.push_back(skinObject);
+		updateSkinning();
+		for (int entry : skeleton.jointEntries)
+			skinObjects[0].globalJointTransforms.push_back(skeletonGlobals[entry]);
 	}
 
-	// Print the actual shader source being loaded:
-	std::cout << "Loading shaders from:" << std::endl;
-	std::cout << "  Vertex: ../cloudWorld/render/bot.vert" << std::endl;
-	std::cout << "  Fragment: ../cloudWorld/render/bot.frag" << std::endl;
-
-	// Get a handle for GLSL variables
-	mvpMatrixID = glGetUniformLocation(programID, "MVP");
-	//lightPositionID = glGetUniformLocation(programID, "lightPosition");
-	//lightIntensityID = glGetUniformLocation(programID, "lightIntensity");
-	// Retrieve the uniform ID for the joint matrix array
-	// I need the ID for the skinning To-Do in render() -> "Set animation data for linear blend skinning in shader"
-	jointMatricesID = glGetUniformLocation(programID, "jointMatrices");
-	modelMatrixID = glGetUniformLocation(programID, "M");
-	std::cout << "jointMatricesID = " << jointMatricesID << std::endl;
-	std::cout << "mvpMatrixID = " << mvpMatrixID << std::endl;
-	std::cout << "modelMatrixID = " << modelMatrixID << std::endl;
+	// Baked animation, if initialize() asked for it: one texture row per pose, 3 texels per joint
+	if (!palette.empty()) {
+		GLint maxSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+		if (palette.jointCount * 3 > maxSize || palette.frameCount > maxSize) {
+			std::cerr << "Joint palette of " << palette.jointCount << " joints x " << palette.frameCount
+					  << " poses does not fit a texture, animating on the CPU" << std::endl;
+			palette = JointPalette();
+		} else {
+			glGenTextures(1, &paletteTexture);
+			glBindTexture(GL_TEXTURE_2D, paletteTexture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, palette.jointCount * 3, palette.frameCount, 0, GL_RGBA, GL_FLOAT,
+						 palette.texels.data());
+			// only read with texelFetch, the blend between two poses is done in bot.vert
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			std::cout << "Baked animation: " << palette.jointCount << " joints, " << palette.frameCount << " poses ("
+					  << palette.frameRate << " per second), " << palette.texels.size() * sizeof(glm::vec4) / 1024
+					  << " KB" << std::endl;
+			palette.texels.clear();
+			palette.texels.shrink_to_fit();
+		}
+	}
 }
 
-void MyBot::bindMesh(std::vector<PrimitiveObject> &primitiveObjects,
-			tinygltf::Model &model, tinygltf::Mesh &mesh) {
-
-	std::map<int, GLuint> vbos;
-	for (size_t i = 0; i < model.bufferViews.size(); ++i) {
-		const tinygltf::BufferView &bufferView = model.bufferViews[i];
-
-		int target = bufferView.target;
-
-		if (bufferView.target == 0) {
-			// The bufferView with target == 0 in our model refers to
-			// the skinning weights, for 25 joints, each 4x4 matrix (16 floats), totaling to 400 floats or 1600 bytes.
-			// So it is considered safe to skip the warning.
-			//std::cout << "WARN: bufferView.target is zero" << std::endl;
-			//continue;
-			target = GL_ARRAY_BUFFER;
+std::vector<MyBot::PrimitiveObject> MyBot::bindModel(const ModelData& data) {
+	// one arena block for the whole model, a primitive whose streams were already uploaded
+	// (a mesh drawn by several nodes) shares their range
+	std::unordered_map<const PackedSkinnedVertex*, MeshArena::Range> uploaded;
+	size_t vertexBytes = 0;
+	size_t indexBytes = 0;
+	for (const ModelData::Primitive& primitive : data.primitives) {
+		if (uploaded.emplace(primitive.vertices, MeshArena::Range()).second) {
+			vertexBytes += primitive.vertexCount * sizeof(PackedSkinnedVertex);
+			indexBytes += (primitive.indexCount * primitive.indexSize + 3) & ~size_t(3);
 		}
-
-		const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-		GLuint vbo;
-		glGenBuffers(1, &vbo);
-		glBindBuffer(target, vbo);
-		glBufferData(target, bufferView.byteLength,
-					&buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-
-		vbos[i] = vbo;
 	}
+	uploaded.clear();
+	meshArena.create(vertexBytes, indexBytes);
 
-	// Each mesh can contain several primitives (or parts), each we need to
-	// bind to an OpenGL vertex array object
-	for (size_t i = 0; i < mesh.primitives.size(); ++i) {
+	std::vector<PrimitiveObject> primitiveObjects;
+	std::vector<size_t> blocks;
+	for (const ModelData::Primitive& primitive : data.primitives) {
+		auto found = uploaded.find(primitive.vertices);
+		if (found == uploaded.end())
+			found = uploaded.emplace(primitive.vertices, meshArena.upload(primitive.vertices, primitive.vertexCount, sizeof(PackedSkinnedVertex),
+																		primitive.indices, primitive.indexCount * primitive.indexSize)).first;
 
-		tinygltf::Primitive primitive = mesh.primitives[i];
-		tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
+		PrimitiveObject primitiveObject;
+		// the importer already narrowed the indices to 16 bits where it could
+		primitiveObject.indexCount = static_cast<GLsizei>(primitive.indexCount);
+		primitiveObject.indexType = primitive.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		primitiveObject.indexOffset = found->second.indexOffset;
+		primitiveObject.baseVertex = found->second.baseVertex;
+		primitiveObject.vertexCount = static_cast<GLsizei>(primitive.vertexCount);
+		primitiveObject.skinnedBase = 0;
+		primitiveObjects.push_back(primitiveObject);
+		blocks.push_back(found->second.block);
+	}
 
+	// one VAO per block, the attributes start at its first vertex and the draws add the base vertex
+	for (const MeshArena::Block& block : meshArena.blocks) {
 		GLuint vao;
 		glGenVertexArrays(1, &vao);
 		glBindVertexArray(vao);
-
-		for (auto &attrib : primitive.attributes) {
-			tinygltf::Accessor accessor = model.accessors[attrib.second];
-			int byteStride =
-				accessor.ByteStride(model.bufferViews[accessor.bufferView]);
-			glBindBuffer(GL_ARRAY_BUFFER, vbos[accessor.bufferView]);
-
-			int size = 1;
-			if (accessor.type != TINYGLTF_TYPE_SCALAR) {
-				size = accessor.type;
-			}
-
-			int vaa = -1;
-																	// Debug
-			if (attrib.first.compare("POSITION") == 0) vaa = 0;   // vec3 - float
-			if (attrib.first.compare("NORMAL") == 0) vaa = 1;		// vec3 - float
-			if (attrib.first.compare("TEXCOORD_0") == 0) vaa = 2; // vec2 - float
-			if (attrib.first.compare("JOINTS_0") == 0) vaa = 3;   // uvec4 - needs to be int
-			if (attrib.first.compare("WEIGHTS_0") == 0) vaa = 4;  // vec4 - float
-			if (vaa > -1) {
-				// I was always getting weird placements of the joints, and it ultimately led to the attributes being
-				// wrongly cast to floats or ints when it was meant to be the opposite
-				// After debugging, JOINTS_0 is an integer attribute and everything else float
-				glEnableVertexAttribArray(vaa);
-				if (attrib.first.compare("JOINTS_0") == 0) {
-					// JOINTS_0 contains integer indices - must be glVertexAttribIPointer
-					glVertexAttribIPointer(
-						vaa,
-						size,
-						accessor.componentType,   // GL_UNSIGNED_BYTE or GL_UNSIGNED_SHORT
-						byteStride,
-						BUFFER_OFFSET(accessor.byteOffset)
-					);
-				} else {
-					// everything else - float attributes
-					glVertexAttribPointer(
-						vaa,
-						size,
-						accessor.componentType,   // GL_FLOAT
-						accessor.normalized ? GL_TRUE : GL_FALSE,
-						byteStride,
-						BUFFER_OFFSET(accessor.byteOffset)
-					);
-				}
-			}
-			else {
-				std::cout << "vaa missing: " << attrib.first << std::endl;
-			}
+		glBindBuffer(GL_ARRAY_BUFFER, block.vertexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.indexBuffer);
+
+		const GLsizei stride = sizeof(PackedSkinnedVertex);
+		glEnableVertexAttribArray(0);	// vec3 - float
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(offsetof(PackedSkinnedVertex, position)));
+		glEnableVertexAttribArray(1);	// octahedral normal, unfolded in bot.vert
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, BUFFER_OFFSET(offsetof(PackedSkinnedVertex, normal)));
+		glEnableVertexAttribArray(2);	// vec2 - half
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(offsetof(PackedSkinnedVertex, uv)));
+		// I was always getting weird placements of the joints, and it ultimately led to the attributes being
+		// wrongly cast to floats or ints when it was meant to be the opposite
+		// JOINTS_0 is an integer attribute - must be glVertexAttribIPointer
+		glEnableVertexAttribArray(3);
+		glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, stride, BUFFER_OFFSET(offsetof(PackedSkinnedVertex, joints)));
+		glEnableVertexAttribArray(4);	// weights, unorm16
+		glVertexAttribPointer(4, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, BUFFER_OFFSET(offsetof(PackedSkinnedVertex, weights)));
+
+		// per humanoid: model matrix (one vec4 per location), palette frame, the pose in the joint buffer
+		// and its skinned copy
+		for (int location = 5; location <= 11; ++location) {
+			glEnableVertexAttribArray(location);
+			glVertexAttribDivisor(location, 1);
 		}
-
-		// Record VAO for later use
-		PrimitiveObject primitiveObject;
-		primitiveObject.vao = vao;
-		primitiveObject.vbos = vbos;
-		primitiveObjects.push_back(primitiveObject);
+		bindInstances(0);
 
 		glBindVertexArray(0);
+		arenaVAOs.push_back(vao);
 	}
-}
+	for (size_t i = 0; i < primitiveObjects.size(); ++i)
+		primitiveObjects[i].vao = arenaVAOs[blocks[i]];
 
-void MyBot::bindModelNodes(std::vector<PrimitiveObject> &primitiveObjects,
-					tinygltf::Model &model,
-					tinygltf::Node &node) {
-	// Bind buffers for the current mesh at the node
-	if ((node.mesh >= 0) && (node.mesh < model.meshes.size())) {
-		bindMesh(primitiveObjects, model, model.meshes[node.mesh]);
-	}
-
-	// Recursive into children nodes
-	for (size_t i = 0; i < node.children.size(); i++) {
-		assert((node.children[i] >= 0) && (node.children[i] < model.nodes.size()));
-		bindModelNodes(primitiveObjects, model, model.nodes[node.children[i]]);
-	}
+	std::cout << "Bot model: " << primitiveObjects.size() << " primitives in " << meshArena.blocks.size()
+			  << " arena block(s), " << meshArena.bytes() / 1024 << " KB" << std::endl;
+	return primitiveObjects;
 }
 
-std::vector<MyBot::PrimitiveObject> MyBot::bindModel(tinygltf::Model &model) {
-	std::vector<PrimitiveObject> primitiveObjects;
-	const tinygltf::Scene &scene = model.scenes[model.defaultScene];
-	for (size_t i = 0; i < scene.nodes.size(); ++i) {
-		assert((scene.nodes[i] >= 0) && (scene.nodes[i] < model.nodes.size()));
-		bindModelNodes(primitiveObjects, model, model.nodes[scene.nodes[i]]);
+void MyBot::bindInstances(size_t first) {
+	size_t base = instanceStream.offset + first * sizeof(BotInstance);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceStream.buffer);
+	for (int column = 0; column < 4; ++column) {
+		glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(BotInstance),
+							  BUFFER_OFFSET(base + offsetof(BotInstance, model) + column * sizeof(glm::vec4)));
 	}
-
-	return primitiveObjects;
+	glVertexAttribPointer(9, 1, GL_FLOAT, GL_FALSE, sizeof(BotInstance), BUFFER_OFFSET(base + offsetof(BotInstance, paletteFrame)));
+	glVertexAttribIPointer(10, 1, GL_INT, sizeof(BotInstance), BUFFER_OFFSET(base + offsetof(BotInstance, jointBase)));
+	glVertexAttribIPointer(11, 1, GL_INT, sizeof(BotInstance), BUFFER_OFFSET(base + offsetof(BotInstance, skinnedSlot)));
 }
 
-void MyBot::drawMesh(const std::vector<PrimitiveObject> &primitiveObjects, tinygltf::Model &model, tinygltf::Mesh &mesh) {
-	for (size_t i = 0; i < mesh.primitives.size(); ++i)
-	{
-		GLuint vao = primitiveObjects[i].vao;
-		std::map<int, GLuint> vbos = primitiveObjects[i].vbos;
-
-		glBindVertexArray(vao);
-
-		tinygltf::Primitive primitive = mesh.primitives[i];
-		tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbos.at(indexAccessor.bufferView));
+DrawData MyBot::drawData() const {
+	DrawData data;
+	data.M = glm::mat4(1.0f);
+	// centering/scaling for the shader
+	data.modelCenter = modelCenter;
+	data.modelScale = modelScale;
+	data.skeletonOffset = skeletonOffset;
+	data.fogDensity = fogDensity;
+	return data;
+}
 
-		glDrawElements(primitive.mode, indexAccessor.count,
-					indexAccessor.componentType,
-					BUFFER_OFFSET(indexAccessor.byteOffset));
+void MyBot::uploadInstances(const std::vector<BotInstance>& instances) {
+	// into the next region, the draws of the last frames still read theirs
+	instanceStream.write(instances.data(), instances.size() * sizeof(BotInstance));
+	skinnedCopies = 0;
+}
 
-		glBindVertexArray(0);
+void MyBot::uploadPoses(const std::vector<glm::mat3x4>& jointMatrices) {
+	size_t offset = jointStream.write(jointMatrices.data(), jointMatrices.size() * sizeof(glm::mat3x4));
+	poseBase = static_cast<GLint>(offset / sizeof(glm::vec4));
+	// a persistent stream that grew is a new buffer
+	if (jointStream.buffer != jointTextureBuffer) {
+		glBindTexture(GL_TEXTURE_BUFFER, jointTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, jointStream.buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		jointTextureBuffer = jointStream.buffer;
 	}
 }
 
-void MyBot::drawModelNodes(const std::vector<PrimitiveObject>& primitiveObjects, tinygltf::Model &model, tinygltf::Node &node) {
-	// Draw the mesh at the node, and recursively do so for children nodes
-	if ((node.mesh >= 0) && (node.mesh < model.meshes.size())) {
-		drawMesh(primitiveObjects, model, model.meshes[node.mesh]);
-	}
-	for (size_t i = 0; i < node.children.size(); i++) {
-		drawModelNodes(primitiveObjects, model, model.nodes[node.children[i]]);
+// Binds the pose source of skinning, the palette (unit 2) or the joint buffer (unit 3)
+void MyBot::bindPoses(ShaderProgram& skinning, UniformHandle bakedHandle) {
+	if (baked()) {
+		// the pose is already in the palette, each instance brings its own frame
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, paletteTexture);
+		skinning.set(bakedHandle, 1);
+	} else {
+		// every instance's pose from uploadPoses()
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_BUFFER, jointTexture);
+		skinning.set(bakedHandle, 0);
 	}
+	glActiveTexture(GL_TEXTURE0);
 }
-void MyBot::drawModel(const std::vector<PrimitiveObject>& primitiveObjects, tinygltf::Model &model) {
-	// Draw all nodes
-	const tinygltf::Scene &scene = model.scenes[model.defaultScene];
-	for (size_t i = 0; i < scene.nodes.size(); ++i) {
-		drawModelNodes(primitiveObjects, model, model.nodes[scene.nodes[i]]);
+
+bool MyBot::skin(size_t firstInstance, size_t instanceCount) {
+	skinnedCopies = 0;
+	if (!loaded() || instanceCount == 0 || !skinningProgram.valid() || !skinnedProgram.valid())
+		return false;
+
+	// primitive after primitive, instanceCount copies of each
+	size_t texels = 0;
+	for (PrimitiveObject& primitive : primitiveObjects) {
+		primitive.skinnedBase = static_cast<GLint>(texels);
+		texels += instanceCount * primitive.vertexCount;
+	}
+	if (texels > static_cast<size_t>(maxSkinnedTexels))
+		return false;
+
+	// orphan last frame's copies instead of waiting for the draws still reading them
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, skinnedBuffer);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, texels * sizeof(glm::uvec4), nullptr, GL_STREAM_COPY);
+
+	skinningProgram.use();
+	bindPoses(skinningProgram, skinningBakedID);
+
+	// one point per vertex and copy, nothing gets rasterized
+	glEnable(GL_RASTERIZER_DISCARD);
+	for (const PrimitiveObject& primitive : primitiveObjects) {
+		glBindVertexArray(primitive.vao);
+		bindInstances(firstInstance);
+		glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, skinnedBuffer, primitive.skinnedBase * sizeof(glm::uvec4),
+						  instanceCount * primitive.vertexCount * sizeof(glm::uvec4));
+		// instance after instance, so copy i starts at skinnedBase + i * vertexCount
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArraysInstanced(GL_POINTS, primitive.baseVertex, primitive.vertexCount, static_cast<GLsizei>(instanceCount));
+		glEndTransformFeedback();
 	}
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(0);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+	glUseProgram(0);
+
+	skinnedCopies = instanceCount;
+	return true;
 }
 
-void MyBot::render(glm::mat4 cameraMatrix, const glm::mat4& M, const glm::vec3& lightDir, const glm::vec3& lightCol,
-			const glm::vec3& envCol) {
-	glUseProgram(programID);
-
-	// Set camera
-	// Set MVP matrix (already computed: Projection * View * Model)
-	glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, glm::value_ptr(cameraMatrix));
-	// Set model matrix for lighting calculations in shader
-	glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, glm::value_ptr(M));
-	// Pass centering/scaling to shader
-	GLuint centerID = glGetUniformLocation(programID, "modelCenter");
-	GLuint scaleID = glGetUniformLocation(programID, "modelScale");
-	glUniform3fv(centerID, 1, glm::value_ptr(modelCenter));
-	glUniform1f(scaleID, modelScale);
-	GLuint offsetID = glGetUniformLocation(programID, "skeletonOffset");
-	glUniform3fv(offsetID, 1, glm::value_ptr(skeletonOffset));
-
-	//fog
-	GLuint fogEnabledID = glGetUniformLocation(programID, "fogEnabled");
-	GLuint fogColorID = glGetUniformLocation(programID, "fogColor");
-	GLuint fogDensityID = glGetUniformLocation(programID, "fogDensity");
-	GLuint cameraPosID = glGetUniformLocation(programID, "cameraPosition");
-
-	glUniform1i(fogEnabledID, fogEnabled ? 1 : 0);
-	glUniform3fv(fogColorID, 1, glm::value_ptr(fogColor));
-	glUniform1f(fogDensityID, fogDensity);
-	glUniform3fv(cameraPosID, 1, glm::value_ptr(cameraPosition));
-
-	GLuint lightVPID = glGetUniformLocation(programID, "LightVP");
-	glUniformMatrix4fv(lightVPID, 1, GL_FALSE, glm::value_ptr(lightVP));
-
-	// Bind shadow map
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, shadowDepthTexture);
-	glUniform1i(glGetUniformLocation(programID, "shadowMap"), 1);
-
-	// -----------------------------------------------------------------
-	// TODO: Set animation data for linear blend skinning in shader
-	// -----------------------------------------------------------------
-	if (!skinObjects.empty()) {
-		// First skin
-		const std::vector<glm::mat4> &jointMatrices = skinObjects[0].jointMatrices;
-		glUniformMatrix4fv(jointMatricesID, jointMatrices.size(), GL_FALSE, glm::value_ptr(jointMatrices[0]));
+void MyBot::submit(RenderQueue& queue, int drawSlot, size_t firstInstance, size_t instanceCount, float depth,
+				   bool shadowPass) {
+	if (!loaded() || instanceCount == 0)
+		return;
+
+	// already skinned by skin(), or skinned here
+	bool skinned = skinnedCopies > 0;
+	DrawItem item;
+	item.program = skinned ? &skinnedProgram : &program;
+	item.drawSlot = drawSlot;
+	item.zone = shadowPass ? nullptr : "bot pass";
+	// shadow map on unit 1 (not while it is being rendered), then the skinned copies (unit 4)
+	// or the pose source of bot.vert, see bindPoses()
+	if (!shadowPass)
+		item.textures[1] = { GL_TEXTURE_2D_ARRAY, shadowDepthTexture };
+	if (skinned)
+		item.textures[4] = { GL_TEXTURE_BUFFER, skinnedTexture };
+	else if (baked())
+		item.textures[2] = { GL_TEXTURE_2D, paletteTexture };
+	else
+		item.textures[3] = { GL_TEXTURE_BUFFER, jointTexture };
+	if (!skinned)
+		item.uniforms[0] = { bakedAnimationID, baked() ? 1 : 0 };
+
+	// every primitive in draw order, all instances of the range at once
+	item.instances = INSTANCES_BOT;
+	item.firstInstance = firstInstance;
+	item.instanceCount = static_cast<GLsizei>(instanceCount);
+	for (const PrimitiveObject& primitive : primitiveObjects) {
+		item.vao = primitive.vao;
+		item.count = primitive.indexCount;
+		item.indexType = primitive.indexType;
+		item.indexOffset = primitive.indexOffset;
+		item.baseVertex = primitive.baseVertex;
+		if (skinned) {
+			// gl_VertexID counts from the start of the block, bot_skinned.vert wants it from the primitive's first vertex
+			item.uniforms[0] = { skinnedBaseID, primitive.skinnedBase - primitive.baseVertex };
+			item.uniforms[1] = { skinnedVertexCountID, primitive.vertexCount };
+		}
+		queue.submit(item, LAYER_OPAQUE, depth);
 	}
-	// -----------------------------------------------------------------
-	// Set light data
-	//glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-	//glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-	// Set directional light (same as planets)
-	GLuint lightDirID = glGetUniformLocation(programID, "lightDir");
-	GLuint lightColorID = glGetUniformLocation(programID, "lightColor");
-	GLuint envColorID = glGetUniformLocation(programID, "envColor");
-
-	glUniform3fv(lightDirID, 1, glm::value_ptr(lightDirection));
-	glUniform3fv(lightColorID, 1, glm::value_ptr(lightColor));
-	glUniform3fv(envColorID, 1, glm::value_ptr(envColor));
-
-	// Draw the GLTF model
-	drawModel(primitiveObjects, model);
 }
 
 void MyBot::cleanup() {
-	glDeleteProgram(programID);
+	program.destroy();
+	skinningProgram.destroy();
+	skinnedProgram.destroy();
+
+	// the next initialize() loads the model again
+	for (GLuint vao : arenaVAOs)
+		glDeleteVertexArrays(1, &vao);
+	arenaVAOs.clear();
+	meshArena.destroy();
+	primitiveObjects.clear();
+	glDeleteTextures(1, &paletteTexture);
+	paletteTexture = 0;
+	instanceStream.destroy();
+	jointStream.destroy();
+	glDeleteTextures(1, &jointTexture);
+	glDeleteBuffers(1, &skinnedBuffer);
+	glDeleteTextures(1, &skinnedTexture);
+	jointTexture = jointTextureBuffer = skinnedBuffer = skinnedTexture = 0;
+	skinnedCopies = 0;
+	palette = JointPalette();
 }
\ No newline at end of file
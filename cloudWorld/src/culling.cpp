@@ -0,0 +1,290 @@
+#include "../cloudWorld/include/culling.h"
+#include "../cloudWorld/include/texture_codec.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE 1
+#include <immintrin.h>
+#endif
+
+// The AVX path is compiled with a target attribute and only taken after a CPU check, so the
+// build needs no -mavx and the binary still runs on machines without it
+#if defined(CULLING_SSE) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CULLING_AVX 1
+#endif
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+	// glm is column major, row r of the matrix is (m[0][r], m[1][r], m[2][r], m[3][r])
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	Frustum f;
+	f.planes[0] = row3 + row0;	// left
+	f.planes[1] = row3 - row0;	// right
+	f.planes[2] = row3 + row1;	// bottom
+	f.planes[3] = row3 - row1;	// top
+	f.planes[4] = row3 + row2;	// near
+	f.planes[5] = row3 - row2;	// far
+	// unit normals, so the plane distance can be compared against the radius
+	for (glm::vec4& plane : f.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return f;
+}
+
+bool Frustum::contains(const glm::vec3& center, float radius) const {
+	for (const glm::vec4& plane : planes) {
+		if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+void BoundingSpheres::resize(size_t count) {
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	radius.resize(count);
+}
+
+// spheres [begin, end) one by one, appends from out[count]
+static size_t cullRange(const Frustum& frustum, const BoundingSpheres& s, size_t begin, size_t end,
+						uint32_t* out, size_t count) {
+	for (size_t i = begin; i < end; ++i) {
+		out[count] = static_cast<uint32_t>(i);
+		count += frustum.contains(glm::vec3(s.x[i], s.y[i], s.z[i]), s.radius[i]) ? 1 : 0;
+	}
+	return count;
+}
+
+size_t cullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible) {
+	visible.resize(spheres.size());
+	size_t count = cullRange(frustum, spheres, 0, spheres.size(), visible.data(), 0);
+	visible.resize(count);
+	return count;
+}
+
+#ifdef CULLING_SSE
+// 4 spheres per iteration: one plane distance per lane (summed in the scalar order, so both agree on
+// spheres right at a plane), the lane survives while every distance >= -r.
+// Indices are written for every lane and only the visible ones advance the output, no branches per sphere.
+static size_t cullSSE(const Frustum& frustum, const BoundingSpheres& s, uint32_t* out) {
+	__m128 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; ++p) {
+		px[p] = _mm_set1_ps(frustum.planes[p].x);
+		py[p] = _mm_set1_ps(frustum.planes[p].y);
+		pz[p] = _mm_set1_ps(frustum.planes[p].z);
+		pw[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	size_t count = 0;
+	size_t blocks = s.size() & ~size_t(3);
+	for (size_t i = 0; i < blocks; i += 4) {
+		__m128 x = _mm_loadu_ps(&s.x[i]);
+		__m128 y = _mm_loadu_ps(&s.y[i]);
+		__m128 z = _mm_loadu_ps(&s.z[i]);
+		__m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(&s.radius[i]));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+											 _mm_mul_ps(pz[p], z)), pw[p]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; ++lane) {
+			out[count] = static_cast<uint32_t>(i + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+	return cullRange(frustum, s, blocks, s.size(), out, count);
+}
+#endif
+
+#ifdef CULLING_AVX
+__attribute__((target("avx")))
+static size_t cullAVX(const Frustum& frustum, const BoundingSpheres& s, uint32_t* out) {
+	__m256 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; ++p) {
+		px[p] = _mm256_set1_ps(frustum.planes[p].x);
+		py[p] = _mm256_set1_ps(frustum.planes[p].y);
+		pz[p] = _mm256_set1_ps(frustum.planes[p].z);
+		pw[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t count = 0;
+	size_t blocks = s.size() & ~size_t(7);
+	for (size_t i = 0; i < blocks; i += 8) {
+		__m256 x = _mm256_loadu_ps(&s.x[i]);
+		__m256 y = _mm256_loadu_ps(&s.y[i]);
+		__m256 z = _mm256_loadu_ps(&s.z[i]);
+		__m256 negR = _mm256_sub_ps(zero, _mm256_loadu_ps(&s.radius[i]));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)),
+												   _mm256_mul_ps(pz[p], z)), pw[p]);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (int lane = 0; lane < 8; ++lane) {
+			out[count] = static_cast<uint32_t>(i + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+	return cullRange(frustum, s, blocks, s.size(), out, count);
+}
+
+static bool cpuHasAVX() {
+	static const bool avx = __builtin_cpu_supports("avx");
+	return avx;
+}
+#endif
+
+size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible) {
+	// room for every index, the SIMD loops store all lanes before they know which ones count
+	visible.resize(spheres.size());
+	size_t count;
+#if defined(CULLING_AVX)
+	if (cpuHasAVX())
+		count = cullAVX(frustum, spheres, visible.data());
+	else
+		count = cullSSE(frustum, spheres, visible.data());
+#elif defined(CULLING_SSE)
+	count = cullSSE(frustum, spheres, visible.data());
+#else
+	count = cullRange(frustum, spheres, 0, spheres.size(), visible.data(), 0);
+#endif
+	visible.resize(count);
+	return count;
+}
+
+const char* cullingPath() {
+#if defined(CULLING_AVX)
+	return cpuHasAVX() ? "avx" : "sse";
+#elif defined(CULLING_SSE)
+	return "sse";
+#else
+	return "scalar";
+#endif
+}
+
+std::vector<float> cascadeSplits(int count, float near, float far, float lambda) {
+	std::vector<float> splits(std::max(count, 1));
+	for (size_t i = 0; i < splits.size(); ++i) {
+		float t = float(i + 1) / float(splits.size());
+		float logarithmic = near * std::pow(far / near, t);
+		float uniform = near + (far - near) * t;
+		splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+	}
+	splits.back() = far;
+	return splits;
+}
+
+glm::vec4 frustumSliceSphere(const glm::mat4& view, float fovY, float aspect, float sliceNear, float sliceFar) {
+	// corners at distance d are d * sqrt(k) off the view axis, the center sits on the axis where the
+	// near and far corners are equally far away (or at the far end when the slice is too wide for that)
+	float tanHalf = std::tan(fovY * 0.5f);
+	float k = tanHalf * tanHalf * (1.0f + aspect * aspect);
+	float centerDistance = std::min((sliceNear + sliceFar) * (1.0f + k) * 0.5f, sliceFar);
+	float farOffset = sliceFar - centerDistance;
+	float radius = std::sqrt(farOffset * farOffset + sliceFar * sliceFar * k);
+
+	glm::vec3 center(glm::inverse(view) * glm::vec4(0.0f, 0.0f, -centerDistance, 1.0f));
+	return glm::vec4(center, radius);
+}
+
+bool fitShadowCascade(const glm::vec3& lightDirection, const glm::vec4& slice, const BoundingSpheres& spheres,
+					  const std::vector<uint32_t>& receivers, const std::vector<glm::vec4>& extraSpheres,
+					  int shadowMapSize, ShadowFrustum& out, std::vector<uint32_t>& casters, float margin) {
+	casters.clear();
+
+	// Directional light: only the direction matters, so the light sits at the origin and looks down
+	// lightDirection; everything is measured in its view space (looking down -z)
+	glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	out.view = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+	glm::vec3 sliceCenter = glm::vec3(out.view * glm::vec4(glm::vec3(slice), 1.0f));
+	float sliceRadius = slice.w;
+
+	// back of the farthest receiver, never past the back of the slice
+	float farthestZ = FLT_MAX;
+	auto addReceiver = [&](const glm::vec3& center, float r) {
+		if (glm::distance(center, glm::vec3(slice)) >= r + sliceRadius)
+			return;
+		float z = (out.view * glm::vec4(center, 1.0f)).z;
+		farthestZ = std::min(farthestZ, z - r);
+	};
+	for (uint32_t i : receivers)
+		addReceiver(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+	for (const glm::vec4& sphere : extraSpheres)
+		addReceiver(glm::vec3(sphere), sphere.w);
+	if (farthestZ == FLT_MAX)
+		return false;
+	farthestZ = std::max(farthestZ, sliceCenter.z - sliceRadius);
+
+	float slack = margin * sliceRadius;
+	sliceRadius += slack;
+	farthestZ -= slack;
+
+	// Sideways the box is the slice sphere: same size every frame, and its corner moves in whole texels.
+	// One texel more than the diameter covers what the snap cuts off.
+	int texels = std::max(shadowMapSize, 2);
+	out.texelSize = 2.0f * sliceRadius / float(texels - 1);
+	glm::vec2 boxMin = glm::floor((glm::vec2(sliceCenter) - sliceRadius) / out.texelSize) * out.texelSize;
+	glm::vec2 boxMax = boxMin + out.texelSize * float(texels);
+
+	// Casters: anything inside the box sideways and in front of the farthest receiver, however close to the light.
+	// Same SIMD test as the camera, against the box with its near plane pushed out of the way.
+	const float looseNear = -1.0e5f;
+	glm::mat4 looseProjection = glm::ortho(boxMin.x, boxMax.x, boxMin.y, boxMax.y, looseNear, -farthestZ);
+	out.casterBox = Frustum::fromMatrix(looseProjection * out.view);
+	const Frustum& casterBox = out.casterBox;
+	cullSpheres(casterBox, spheres, casters);
+
+	float nearestZ = farthestZ;		// front of the caster closest to the light
+	for (uint32_t i : casters) {
+		glm::vec3 c = glm::vec3(out.view * glm::vec4(spheres.x[i], spheres.y[i], spheres.z[i], 1.0f));
+		nearestZ = std::max(nearestZ, c.z + spheres.radius[i]);
+	}
+	for (const glm::vec4& sphere : extraSpheres) {
+		if (casterBox.contains(glm::vec3(sphere), sphere.w))
+			nearestZ = std::max(nearestZ, (out.view * glm::vec4(glm::vec3(sphere), 1.0f)).z + sphere.w);
+	}
+
+	// a unit of slack on both ends so no surface sits right on a clip plane
+	out.boxMin = boxMin;
+	out.boxMax = boxMax;
+	out.nearDistance = -nearestZ - 1.0f - slack;
+	out.farDistance = -farthestZ + 1.0f;
+	out.projection = glm::ortho(boxMin.x, boxMax.x, boxMin.y, boxMax.y, out.nearDistance, out.farDistance);
+	out.depthRange = out.farDistance - out.nearDistance;
+	return true;
+}
+
+bool ShadowFrustum::covers(const ShadowFrustum& other) const {
+	return view == other.view &&
+		   other.boxMin.x >= boxMin.x && other.boxMin.y >= boxMin.y &&
+		   other.boxMax.x <= boxMax.x && other.boxMax.y <= boxMax.y &&
+		   other.nearDistance >= nearDistance && other.farDistance <= farDistance;
+}
+
+uint64_t sphereSetHash(const BoundingSpheres& spheres, const std::vector<uint32_t>& indices, float quantum) {
+	std::vector<int32_t> records;
+	records.reserve(indices.size() * 5);
+	for (uint32_t i : indices) {
+		records.push_back(static_cast<int32_t>(i));
+		for (float v : {spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]})
+			records.push_back(static_cast<int32_t>(std::lround(v / quantum)));
+	}
+	return fnv1a64(records.data(), records.size() * sizeof(int32_t));
+}
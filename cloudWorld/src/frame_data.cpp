@@ -0,0 +1,32 @@
+#include "../cloudWorld/include/frame_data.h"
+
+#include <algorithm>
+
+void UniformBlockBuffer::create(size_t size, size_t initialCapacity) {
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	elementSize = size;
+	stride = (size + alignment - 1) / alignment * alignment;
+	staging.assign(std::max<size_t>(initialCapacity, 1) * stride, 0);
+
+	// regions start at a slot boundary, so every slot of every region can be bound
+	stream.create(GL_UNIFORM_BUFFER, staging.size(), stride);
+}
+
+void UniformBlockBuffer::destroy() {
+	stream.destroy();
+	staging.clear();
+}
+
+void UniformBlockBuffer::upload(size_t count) {
+	if (count == 0) return;
+	count = std::min(count, staging.size() / stride);
+
+	// more planets/bots than the buffer was made for: the stream grows
+	stream.write(staging.data(), count * stride);
+}
+
+void UniformBlockBuffer::bind(GLuint binding, size_t slot) const {
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, stream.buffer, stream.offset + slot * stride, elementSize);
+}
@@ -0,0 +1,324 @@
+#include "../cloudWorld/include/headless.h"
+#include "../cloudWorld/include/stream_buffer.h"
+
+#include <stb/stb_image.h>
+#include <stb/stb_image_write.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#ifdef CLOUDWORLD_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+static void printUsage(const char* program) {
+	std::cout << "Usage: " << program << " [options]\n"
+			  << "  --headless            render offscreen (EGL) instead of opening a window\n"
+			  << "  --seed N              seed for the planet field (headless default: 1337)\n"
+			  << "  --frames N            frames to render in headless mode (default 300)\n"
+			  << "  --dt SECONDS          fixed timestep in headless mode (default 1/60)\n"
+			  << "  --size WxH            framebuffer size (default 1280x720)\n"
+			  << "  --capture A,B,C       frames to write as PNG\n"
+			  << "  --out DIR             directory for captured frames (default .)\n"
+			  << "  --golden DIR          compare captured frames against DIR/frame_NNNN.png\n"
+			  << "  --golden-renderer S   skip the run (exit code 77) unless GL_RENDERER contains S\n"
+			  << "  --tolerance N         per-channel tolerance 0-255 for golden comparison (default 8)\n"
+			  << "  --max-diff RATIO      fraction of pixels allowed to differ (default 0.001)\n"
+			  << "  --profile FILE        record CPU/GPU zones and write a Chrome trace JSON\n"
+			  << "  --planets N           number of planets to place (default from SceneConfig)\n"
+			  << "  --planet-distance D   minimum distance between planet surfaces (default from SceneConfig)\n"
+			  << "  --compress-textures   use BC1 compressed textures (cache files get a .bc1 suffix)\n"
+			  << "  --bake-textures       write the texture cache (see --compress-textures) and exit\n"
+			  << "  --bake-models         import the glTF models into the model cache and exit\n";
+}
+
+bool parseRunOptions(int argc, char** argv, RunOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		// every option except --headless, --help and the texture and model switches takes a value
+		auto value = [&](const char* name) -> const char* {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for " << name << std::endl;
+				return nullptr;
+			}
+			return argv[++i];
+		};
+
+		if (arg == "--headless") {
+			options.headless = true;
+		} else if (arg == "--compress-textures") {
+			options.compressTextures = true;
+		} else if (arg == "--bake-textures") {
+			options.bakeTextures = true;
+		} else if (arg == "--bake-models") {
+			options.bakeModels = true;
+		} else if (arg == "--help" || arg == "-h") {
+			printUsage(argv[0]);
+			return false;
+		} else if (arg == "--seed") {
+			const char* v = value("--seed");
+			if (!v) return false;
+			options.seed = static_cast<unsigned int>(std::strtoul(v, nullptr, 10));
+			options.hasSeed = true;
+		} else if (arg == "--frames") {
+			const char* v = value("--frames");
+			if (!v) return false;
+			options.frames = std::atoi(v);
+		} else if (arg == "--dt") {
+			const char* v = value("--dt");
+			if (!v) return false;
+			options.fixedDt = static_cast<float>(std::atof(v));
+		} else if (arg == "--size") {
+			const char* v = value("--size");
+			if (!v || std::sscanf(v, "%dx%d", &options.width, &options.height) != 2) {
+				std::cerr << "--size expects WIDTHxHEIGHT" << std::endl;
+				return false;
+			}
+		} else if (arg == "--capture") {
+			const char* v = value("--capture");
+			if (!v) return false;
+			std::stringstream ss(v);
+			std::string item;
+			while (std::getline(ss, item, ',')) {
+				if (!item.empty())
+					options.captureFrames.push_back(std::atoi(item.c_str()));
+			}
+		} else if (arg == "--out") {
+			const char* v = value("--out");
+			if (!v) return false;
+			options.outputDir = v;
+		} else if (arg == "--golden") {
+			const char* v = value("--golden");
+			if (!v) return false;
+			options.goldenDir = v;
+		} else if (arg == "--golden-renderer") {
+			const char* v = value("--golden-renderer");
+			if (!v) return false;
+			options.goldenRenderer = v;
+		} else if (arg == "--tolerance") {
+			const char* v = value("--tolerance");
+			if (!v) return false;
+			options.channelTolerance = std::atoi(v);
+		} else if (arg == "--max-diff") {
+			const char* v = value("--max-diff");
+			if (!v) return false;
+			options.maxDiffRatio = static_cast<float>(std::atof(v));
+		} else if (arg == "--profile") {
+			const char* v = value("--profile");
+			if (!v) return false;
+			options.profilePath = v;
+		} else if (arg == "--planets") {
+			const char* v = value("--planets");
+			if (!v) return false;
+			options.planets = std::atoi(v);
+		} else if (arg == "--planet-distance") {
+			const char* v = value("--planet-distance");
+			if (!v) return false;
+			options.planetDistance = static_cast<float>(std::atof(v));
+		} else {
+			std::cerr << "Unknown option: " << arg << std::endl;
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (options.frames <= 0 || options.fixedDt <= 0.0f || options.width <= 0 || options.height <= 0) {
+		std::cerr << "frames, dt and size must be positive" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+#ifdef CLOUDWORLD_HAS_EGL
+bool createHeadlessContext(HeadlessContext& ctx, int width, int height) {
+	ctx.width = width;
+	ctx.height = height;
+
+	// Prefer the surfaceless platform so no X server or GPU device is needed,
+	// otherwise fall back to whatever the default display is
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	if (getPlatformDisplay) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+#endif
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major = 0, minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+		std::cerr << "Failed to init EGL display" << std::endl;
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint numConfigs = 0;
+	eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cerr << "EGL does not support desktop OpenGL" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	// same 3.3 core context the window asks GLFW for
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : (EGLConfig)nullptr,
+										  EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT) {
+		std::cerr << "Failed to create EGL context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	// surfaceless: everything is drawn into our own framebuffer object
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::cerr << "Failed to make EGL context current" << std::endl;
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		return false;
+	}
+
+	ctx.display = display;
+	ctx.context = context;
+
+	if (!gladLoadGL((GLADloadfunc)eglGetProcAddress)) {
+		std::cerr << "Failed to init GLAD\n";
+		destroyHeadlessContext(ctx);
+		return false;
+	}
+	loadBufferStorage((GLADloadfunc)eglGetProcAddress);
+
+	std::cout << "Headless renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+	return createHeadlessFramebuffer(ctx);
+}
+
+void destroyHeadlessContext(HeadlessContext& ctx) {
+	if (ctx.framebuffer) {
+		glDeleteFramebuffers(1, &ctx.framebuffer);
+		glDeleteRenderbuffers(1, &ctx.colorRenderbuffer);
+		glDeleteRenderbuffers(1, &ctx.depthRenderbuffer);
+		ctx.framebuffer = 0;
+	}
+	if (ctx.display) {
+		eglMakeCurrent((EGLDisplay)ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (ctx.context) eglDestroyContext((EGLDisplay)ctx.display, (EGLContext)ctx.context);
+		eglTerminate((EGLDisplay)ctx.display);
+	}
+	ctx.display = nullptr;
+	ctx.context = nullptr;
+}
+#else
+bool createHeadlessContext(HeadlessContext&, int, int) {
+	std::cerr << "cloudWorld was built without EGL, headless mode is not available" << std::endl;
+	return false;
+}
+
+void destroyHeadlessContext(HeadlessContext&) {}
+#endif
+
+bool createHeadlessFramebuffer(HeadlessContext& ctx) {
+	// color + depth renderbuffers, the equivalent of the window's back buffer
+	glGenFramebuffers(1, &ctx.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, ctx.framebuffer);
+
+	glGenRenderbuffers(1, &ctx.colorRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, ctx.colorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, ctx.width, ctx.height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ctx.colorRenderbuffer);
+
+	glGenRenderbuffers(1, &ctx.depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, ctx.depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, ctx.width, ctx.height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ctx.depthRenderbuffer);
+
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	if (!complete) {
+		std::cerr << "Headless framebuffer is not complete!" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	return complete;
+}
+
+std::string captureFileName(int frame) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "frame_%04d.png", frame);
+	return name;
+}
+
+bool writeFramebufferPNG(const std::string& path, GLuint framebuffer, int width, int height) {
+	// RGB only, the shaders write vec3 colors so alpha is meaningless
+	std::vector<unsigned char> pixels(size_t(width) * height * 3);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	// GL rows start at the bottom
+	stbi_flip_vertically_on_write(1);
+	int ok = stbi_write_png(path.c_str(), width, height, 3, pixels.data(), width * 3);
+	stbi_flip_vertically_on_write(0);
+
+	if (!ok) {
+		std::cerr << "Failed to write " << path << std::endl;
+		return false;
+	}
+	std::cout << "Wrote " << path << std::endl;
+	return true;
+}
+
+bool compareWithGolden(const std::string& imagePath, const std::string& goldenPath, const RunOptions& options) {
+	int w0, h0, c0, w1, h1, c1;
+	unsigned char* image = stbi_load(imagePath.c_str(), &w0, &h0, &c0, 3);
+	unsigned char* golden = stbi_load(goldenPath.c_str(), &w1, &h1, &c1, 3);
+
+	bool match = false;
+	if (!image || !golden) {
+		std::cerr << "Golden compare: failed to load " << (image ? goldenPath : imagePath) << std::endl;
+	} else if (w0 != w1 || h0 != h1) {
+		std::cerr << "Golden compare: size mismatch " << w0 << "x" << h0
+				  << " vs " << w1 << "x" << h1 << " (" << goldenPath << ")" << std::endl;
+	} else {
+		// count pixels where any channel is off by more than the tolerance
+		size_t pixelCount = size_t(w0) * h0;
+		size_t differing = 0;
+		int maxDelta = 0;
+		for (size_t i = 0; i < pixelCount; ++i) {
+			int worst = 0;
+			for (int c = 0; c < 3; ++c) {
+				int d = std::abs(int(image[i * 3 + c]) - int(golden[i * 3 + c]));
+				if (d > worst) worst = d;
+			}
+			if (worst > maxDelta) maxDelta = worst;
+			if (worst > options.channelTolerance) differing++;
+		}
+		float ratio = float(differing) / float(pixelCount);
+		match = ratio <= options.maxDiffRatio;
+		std::cout << "Golden compare " << imagePath << ": " << differing << " pixels differ ("
+				  << ratio * 100.0f << "%), max channel delta " << maxDelta
+				  << (match ? " -> OK" : " -> MISMATCH") << std::endl;
+	}
+
+	if (image) stbi_image_free(image);
+	if (golden) stbi_image_free(golden);
+	return match;
+}
@@ -0,0 +1,381 @@
+#include "../cloudWorld/include/mesh.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+void generateSphere(int stacks, int slices, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	// Sphere formula (inspired in quiz and lighting lecture)
+	// x = sin(ϕ) * cos(θ)
+	// y = cos(ϕ)
+	// z = sin(ϕ) * sin(θ)
+	// where ϕ ∈ [0,π] (stacks - latitude) and θ ∈ [0,2π] (slices - longitude).
+	// had to look at glm::pi<float>() and glm::two_pi<float>() from stackOverflow to maintain all decimals
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(size_t(stacks + 1) * (slices + 1));
+	indices.reserve(size_t(stacks) * slices * 6);
+
+	for (int i = 0; i <= stacks; ++i) {
+		float v = float(i) / float(stacks);
+		float phi = v * glm::pi<float>();
+
+		for (int j = 0; j <= slices; ++j) {
+			float u = float(j) / float(slices);
+			float theta = u * glm::two_pi<float>();
+
+			glm::vec3 p(
+				sin(phi) * cos(theta),
+				cos(phi),
+				sin(phi) * sin(theta)
+			);
+
+			vertices.push_back({
+				p,
+				glm::normalize(p),
+				glm::vec2(u, 1.0f - v)
+			});
+		}
+	}
+
+	for (int i = 0; i < stacks; ++i) {
+		for (int j = 0; j < slices; ++j) {
+			// unsigned int for index buffers
+			uint32_t a = i * (slices + 1) + j;
+			uint32_t b = (i + 1) * (slices + 1) + j;
+			uint32_t c = b + 1;
+			uint32_t d = a + 1;
+
+			indices.push_back(a);
+			indices.push_back(b);
+			indices.push_back(d);
+
+			indices.push_back(d);
+			indices.push_back(b);
+			indices.push_back(c);
+		}
+	}
+}
+
+// same mapping as generateSphere(): u follows theta, v goes from the north pole (1) to the south pole (0)
+static glm::vec2 sphereUV(const glm::vec3& p) {
+	float theta = std::atan2(p.z, p.x);
+	if (theta < 0.0f)
+		theta += glm::two_pi<float>();
+	float phi = std::acos(glm::clamp(p.y, -1.0f, 1.0f));
+	return glm::vec2(theta / glm::two_pi<float>(), 1.0f - phi / glm::pi<float>());
+}
+
+void generateIcosphere(int subdivisions, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	// the 12 corners of an icosahedron are the corners of three golden rectangles
+	const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+	std::vector<glm::vec3> positions = {
+		{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+		{0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+		{t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+	};
+	for (glm::vec3& p : positions)
+		p = glm::normalize(p);
+	std::vector<uint32_t> triangles = {
+		0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+		1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+		3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+		4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+	};
+
+	// split each triangle in 4 through its edge midpoints, shared by the triangles on both sides of the edge
+	for (int level = 0; level < subdivisions; ++level) {
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> midpoints;
+		auto midpoint = [&](uint32_t a, uint32_t b) {
+			std::pair<uint32_t, uint32_t> edge(std::min(a, b), std::max(a, b));
+			auto found = midpoints.find(edge);
+			if (found != midpoints.end())
+				return found->second;
+			uint32_t index = static_cast<uint32_t>(positions.size());
+			positions.push_back(glm::normalize(positions[a] + positions[b]));
+			midpoints.emplace(edge, index);
+			return index;
+		};
+
+		std::vector<uint32_t> finer;
+		finer.reserve(triangles.size() * 4);
+		for (size_t i = 0; i < triangles.size(); i += 3) {
+			uint32_t a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+			uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+			finer.insert(finer.end(), {a, ab, ca,   b, bc, ab,   c, ca, bc,   ab, bc, ca});
+		}
+		triangles.swap(finer);
+	}
+
+	vertices.clear();
+	vertices.reserve(positions.size() + positions.size() / 8);
+	for (const glm::vec3& p : positions)
+		vertices.push_back({p, p, sphereUV(p)});
+
+	// a triangle across the seam has corners near u = 1 and near u = 0, those near 0 get a copy at u + 1
+	std::vector<uint32_t> seamCopy(positions.size(), UINT32_MAX);
+	for (size_t i = 0; i < triangles.size(); i += 3) {
+		float uMin = 1.0f, uMax = 0.0f;
+		for (size_t k = 0; k < 3; ++k) {
+			uMin = std::min(uMin, vertices[triangles[i + k]].uv.x);
+			uMax = std::max(uMax, vertices[triangles[i + k]].uv.x);
+		}
+		if (uMax - uMin <= 0.5f)
+			continue;
+		for (size_t k = 0; k < 3; ++k) {
+			uint32_t& index = triangles[i + k];
+			if (vertices[index].uv.x >= 0.5f)
+				continue;
+			if (seamCopy[index] == UINT32_MAX) {
+				Vertex copy = vertices[index];
+				copy.uv.x += 1.0f;
+				seamCopy[index] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(copy);
+			}
+			index = seamCopy[index];
+		}
+	}
+	indices.swap(triangles);
+}
+
+float maxEdgeAngle(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	float minCos = 1.0f;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		for (size_t k = 0; k < 3; ++k) {
+			const glm::vec3& a = vertices[indices[i + k]].position;
+			const glm::vec3& b = vertices[indices[i + (k + 1) % 3]].position;
+			minCos = std::min(minCos, glm::dot(a, b) / (glm::length(a) * glm::length(b)));
+		}
+	}
+	return std::acos(glm::clamp(minCos, -1.0f, 1.0f));
+}
+
+float sphereLodMaxRadius(float edgeAngle, float maxError) {
+	float sagitta = 1.0f - std::cos(edgeAngle * 0.5f);
+	return sagitta > 0.0f ? maxError / sagitta : INFINITY;
+}
+
+int selectSphereLod(float radius, int previous, const std::vector<float>& maxRadius, float hysteresis) {
+	int count = static_cast<int>(maxRadius.size());
+	if (count == 0)
+		return 0;
+	if (previous < 0 || previous >= count) {
+		// no history, the coarsest level that is good enough
+		int lod = count - 1;
+		while (lod > 0 && radius > maxRadius[lod])
+			--lod;
+		return lod;
+	}
+	int lod = previous;
+	while (lod > 0 && radius > maxRadius[lod])
+		--lod;
+	while (lod + 1 < count && radius < maxRadius[lod + 1] * (1.0f - hysteresis))
+		++lod;
+	return lod;
+}
+
+void packOctahedral(const glm::vec3& normal, int16_t out[2]) {
+	// project onto the octahedron |x| + |y| + |z| = 1, the lower half folds over the diagonals
+	glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.0f) {
+		e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+					  (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+	}
+	out[0] = static_cast<int16_t>(glm::packSnorm1x16(e.x));
+	out[1] = static_cast<int16_t>(glm::packSnorm1x16(e.y));
+}
+
+glm::vec3 unpackOctahedral(const int16_t in[2]) {
+	// same as the shaders
+	glm::vec2 e(glm::unpackSnorm1x16(static_cast<uint16_t>(in[0])), glm::unpackSnorm1x16(static_cast<uint16_t>(in[1])));
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	if (n.z < 0.0f) {
+		n.x = (1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+		n.y = (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return glm::normalize(n);
+}
+
+PackedVertex packVertex(const Vertex& vertex) {
+	PackedVertex packed;
+	packed.position = vertex.position;
+	packOctahedral(vertex.normal, packed.normal);
+	packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+	packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+	return packed;
+}
+
+float vertexCacheAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+	if (indices.size() < 3)
+		return 0.0f;
+	// FIFO: a hit does not move the vertex, so it is enough to remember when it went in
+	std::vector<size_t> insertedAt(vertexCount, SIZE_MAX);
+	size_t misses = 0;
+	for (uint32_t index : indices) {
+		if (insertedAt[index] != SIZE_MAX && misses - insertedAt[index] < size_t(cacheSize))
+			continue;
+		insertedAt[index] = misses++;
+	}
+	return float(misses) / float(indices.size() / 3);
+}
+
+// Forsyth's scores: vertices recently used score high, the last triangle's a bit less (its edges are
+// done), and vertices with few triangles left get a boost so no lonely triangles are left behind
+static const int FORSYTH_CACHE_SIZE = 32;
+
+static float forsythVertexScore(int cachePosition, uint32_t trianglesLeft) {
+	if (trianglesLeft == 0)
+		return -1.0f;
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			score = 0.75f;
+		} else {
+			float scaled = 1.0f - float(cachePosition - 3) / float(FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(scaled, 1.5f);
+		}
+	}
+	return score + 2.0f / std::sqrt(float(trianglesLeft));
+}
+
+// the score only depends on two small integers, so it is looked up (no pow/sqrt in the inner loop)
+static const uint32_t FORSYTH_MAX_VALENCE = 32;
+
+struct ForsythScoreTable {
+	float scores[FORSYTH_CACHE_SIZE + 1][FORSYTH_MAX_VALENCE + 1];	// [cache position + 1][triangles left]
+
+	ForsythScoreTable() {
+		for (int position = -1; position < FORSYTH_CACHE_SIZE; ++position)
+			for (uint32_t left = 0; left <= FORSYTH_MAX_VALENCE; ++left)
+				scores[position + 1][left] = forsythVertexScore(position, left);
+	}
+
+	float operator()(int cachePosition, uint32_t trianglesLeft) const {
+		if (trianglesLeft > FORSYTH_MAX_VALENCE)
+			return forsythVertexScore(cachePosition, trianglesLeft);
+		return scores[cachePosition + 1][trianglesLeft];
+	}
+};
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// triangles of each vertex, the first trianglesLeft[v] of them not emitted yet
+	std::vector<uint32_t> trianglesLeft(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		++trianglesLeft[indices[i]];
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		firstTriangle[v + 1] = firstTriangle[v] + trianglesLeft[v];
+	std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			vertexTriangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	static const ForsythScoreTable vertexScoreOf;
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = vertexScoreOf(-1, trianglesLeft[v]);
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	std::vector<uint8_t> emitted(triangleCount, 0);
+
+	std::vector<uint32_t> cache, nextCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	std::vector<uint32_t> out;
+	out.reserve(triangleCount * 3);
+
+	size_t scan = 0;		// everything before it is emitted, for when the cache has nothing left to offer
+	size_t best = 0;
+	for (size_t t = 1; t < triangleCount; ++t)
+		if (triangleScore[t] > triangleScore[best]) best = t;
+
+	while (out.size() < triangleCount * 3) {
+		if (best == SIZE_MAX) {
+			while (emitted[scan]) ++scan;
+			best = scan;
+		}
+
+		emitted[best] = 1;
+		const uint32_t* corners = &indices[best * 3];
+		out.insert(out.end(), corners, corners + 3);
+
+		// drop the triangle from its vertices' lists
+		for (int k = 0; k < 3; ++k) {
+			uint32_t v = corners[k];
+			uint32_t* list = &vertexTriangles[firstTriangle[v]];
+			uint32_t* last = list + trianglesLeft[v] - 1;
+			for (uint32_t* it = list; it <= last; ++it) {
+				if (*it == best) {
+					std::swap(*it, *last);
+					break;
+				}
+			}
+			--trianglesLeft[v];
+		}
+
+		// the triangle's vertices move to the front of the cache, the ones pushed out fall off the end
+		nextCache.assign(corners, corners + 3);
+		for (uint32_t v : cache)
+			if (v != corners[0] && v != corners[1] && v != corners[2]) nextCache.push_back(v);
+		cache.swap(nextCache);
+
+		for (size_t i = 0; i < cache.size(); ++i) {
+			uint32_t v = cache[i];
+			cachePosition[v] = i < size_t(FORSYTH_CACHE_SIZE) ? int(i) : -1;
+			float score = vertexScoreOf(cachePosition[v], trianglesLeft[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+			for (uint32_t k = 0; k < trianglesLeft[v]; ++k)
+				triangleScore[vertexTriangles[firstTriangle[v] + k]] += delta;
+		}
+		if (cache.size() > size_t(FORSYTH_CACHE_SIZE))
+			cache.resize(FORSYTH_CACHE_SIZE);
+
+		// next one: the best triangle that touches the cache
+		best = SIZE_MAX;
+		float bestScore = -1.0f;
+		for (uint32_t v : cache) {
+			for (uint32_t k = 0; k < trianglesLeft[v]; ++k) {
+				uint32_t t = vertexTriangles[firstTriangle[v] + k];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	std::copy(out.begin(), out.end(), indices.begin());
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+	for (uint32_t& index : indices) {
+		if (remap[index] == UINT32_MAX)
+			remap[index] = next++;
+		index = remap[index];
+	}
+	return remap;
+}
+
+bool narrowIndices(const std::vector<uint32_t>& indices, std::vector<uint16_t>& out) {
+	out.clear();
+	for (uint32_t index : indices)
+		if (index > UINT16_MAX) return false;
+	out.assign(indices.begin(), indices.end());
+	return true;
+}
@@ -0,0 +1,71 @@
+#include "../cloudWorld/include/mesh_arena.h"
+
+#include <algorithm>
+
+// offset rounded up to a multiple of alignment (any alignment, vertex strides are not powers of two)
+static size_t alignUp(size_t offset, size_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+void MeshArena::create(size_t vertexBytes, size_t indexBytes) {
+	blockVertexBytes = vertexBytes;
+	blockIndexBytes = indexBytes;
+}
+
+MeshArena::Range MeshArena::upload(const void* vertices, size_t vertexCount, size_t stride, const void* indices,
+								   size_t indexBytes) {
+	size_t vertexBytes = vertexCount * stride;
+
+	// first fit, index ranges stay 4 byte aligned so 16 and 32 bit indices can share a buffer
+	size_t b = 0;
+	for (; b < blocks.size(); ++b) {
+		const Block& block = blocks[b];
+		if (alignUp(block.vertexUsed, stride) + vertexBytes <= block.vertexCapacity &&
+			alignUp(block.indexUsed, 4) + indexBytes <= block.indexCapacity)
+			break;
+	}
+	if (b == blocks.size()) {
+		Block block;
+		block.vertexCapacity = std::max(blockVertexBytes, vertexBytes);
+		block.indexCapacity = std::max(blockIndexBytes, indexBytes);
+		glGenBuffers(1, &block.vertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, block.vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, block.vertexCapacity, nullptr, GL_STATIC_DRAW);
+		glGenBuffers(1, &block.indexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, block.indexCapacity, nullptr, GL_STATIC_DRAW);
+		blocks.push_back(block);
+	}
+
+	Block& block = blocks[b];
+	Range range;
+	range.block = b;
+	size_t vertexOffset = alignUp(block.vertexUsed, stride);
+	range.baseVertex = static_cast<GLint>(vertexOffset / stride);
+	range.indexOffset = alignUp(block.indexUsed, 4);
+	block.vertexUsed = vertexOffset + vertexBytes;
+	block.indexUsed = range.indexOffset + indexBytes;
+
+	glBindBuffer(GL_ARRAY_BUFFER, block.vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, vertexOffset, vertexBytes, vertices);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.indexBuffer);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.indexOffset, indexBytes, indices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	return range;
+}
+
+size_t MeshArena::bytes() const {
+	size_t total = 0;
+	for (const Block& block : blocks)
+		total += block.vertexCapacity + block.indexCapacity;
+	return total;
+}
+
+void MeshArena::destroy() {
+	for (Block& block : blocks) {
+		glDeleteBuffers(1, &block.vertexBuffer);
+		glDeleteBuffers(1, &block.indexBuffer);
+	}
+	blocks.clear();
+}
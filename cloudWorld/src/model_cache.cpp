@@ -0,0 +1,458 @@
+#include "../cloudWorld/include/model_cache.h"
+#include "../cloudWorld/include/texture_codec.h"
+
+// the only glTF parser of the renderer, cache misses (and --bake-models) are the only callers
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <tiny_gltf.h>
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <iostream>
+
+static const char CACHE_MAGIC[4] = {'C', 'W', 'M', 'S'};
+static const uint32_t CACHE_VERSION = 1;
+
+std::string modelCachePath(const std::string& sourcePath, const std::string& cacheDir) {
+	size_t slash = sourcePath.find_last_of("/\\");
+	std::string name = slash == std::string::npos ? sourcePath : sourcePath.substr(slash + 1);
+	return cacheDir + "/" + name + ".cwmesh";
+}
+
+static std::string directoryOf(const std::string& path) {
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// FNV-1a of the source and of every dependency next to it, a missing dependency counts as empty
+static uint64_t modelHash(const MappedFile& source, const std::string& sourcePath, const std::vector<std::string>& dependencies) {
+	std::vector<uint64_t> hashes;
+	hashes.push_back(fnv1a64(source.data, source.size));
+	for (const std::string& name : dependencies) {
+		MappedFile dependency;
+		hashes.push_back(dependency.open(directoryOf(sourcePath) + name) ? fnv1a64(dependency.data, dependency.size) : 0);
+	}
+	return fnv1a64(hashes.data(), hashes.size() * sizeof(uint64_t));
+}
+
+static size_t align16(size_t offset) {
+	return (offset + 15) & ~size_t(15);
+}
+
+// Checks the container, points the primitives of out at it and copies the small sections,
+// false if it is truncated or not a .cwmesh
+static bool parseCache(const unsigned char* data, size_t size, ModelData& out, uint64_t& sourceHash,
+					   std::vector<std::string>& dependencies) {
+	if (size < sizeof(CachedModelHeader))
+		return false;
+	CachedModelHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != CACHE_VERSION)
+		return false;
+	size_t tableSize = size_t(header.primitiveCount) * sizeof(CachedPrimitive) + size_t(header.clipCount) * sizeof(CachedClip);
+	if (header.primitiveCount == 0 || size - sizeof(header) < tableSize)
+		return false;
+	auto section = [size](uint64_t offset, uint64_t bytes) { return offset <= size && bytes <= size - offset; };
+
+	out.primitives.clear();
+	const unsigned char* table = data + sizeof(header);
+	for (uint32_t i = 0; i < header.primitiveCount; ++i) {
+		CachedPrimitive primitive;
+		std::memcpy(&primitive, table + i * sizeof(CachedPrimitive), sizeof(primitive));
+		if ((primitive.indexSize != 2 && primitive.indexSize != 4) ||
+			!section(primitive.vertexOffset, uint64_t(primitive.vertexCount) * sizeof(PackedSkinnedVertex)) ||
+			!section(primitive.indexOffset, uint64_t(primitive.indexCount) * primitive.indexSize))
+			return false;
+		out.primitives.push_back({reinterpret_cast<const PackedSkinnedVertex*>(data + primitive.vertexOffset), primitive.vertexCount,
+								  data + primitive.indexOffset, primitive.indexCount, primitive.indexSize});
+	}
+
+	out.clips.clear();
+	table += header.primitiveCount * sizeof(CachedPrimitive);
+	for (uint32_t i = 0; i < header.clipCount; ++i) {
+		CachedClip cached;
+		std::memcpy(&cached, table + i * sizeof(CachedClip), sizeof(cached));
+		if (!section(cached.channelOffset, uint64_t(cached.channelCount) * sizeof(CachedClipChannel)) ||
+			!section(cached.timeOffset, uint64_t(cached.keyCount) * sizeof(float)) ||
+			!section(cached.valueOffset, uint64_t(cached.keyCount) * sizeof(glm::vec4)))
+			return false;
+		AnimationClip clip;
+		clip.duration = cached.duration;
+		for (uint32_t c = 0; c < cached.channelCount; ++c) {
+			CachedClipChannel channel;
+			std::memcpy(&channel, data + cached.channelOffset + c * sizeof(CachedClipChannel), sizeof(channel));
+			if (uint64_t(channel.firstKey) + channel.keyCount > cached.keyCount)
+				return false;
+			clip.channels.push_back({channel.node, static_cast<AnimationTarget>(channel.target),
+									 static_cast<AnimationInterpolation>(channel.interpolation), channel.firstKey, channel.keyCount});
+		}
+		clip.times.resize(cached.keyCount);
+		clip.values.resize(cached.keyCount);
+		std::memcpy(clip.times.data(), data + cached.timeOffset, clip.times.size() * sizeof(float));
+		std::memcpy(clip.values.data(), data + cached.valueOffset, clip.values.size() * sizeof(glm::vec4));
+		out.clips.push_back(std::move(clip));
+	}
+
+	if (!section(header.inverseBindOffset, uint64_t(header.jointCount) * sizeof(glm::mat4)) ||
+		!section(header.skeletonOffset, (uint64_t(header.skeletonSize) * 2 + header.jointCount) * sizeof(int32_t)) ||
+		!section(header.dependencyOffset, 0))
+		return false;
+	out.inverseBindMatrices.resize(header.jointCount);
+	std::memcpy(out.inverseBindMatrices.data(), data + header.inverseBindOffset, header.jointCount * sizeof(glm::mat4));
+	std::vector<int32_t> skeleton(size_t(header.skeletonSize) * 2 + header.jointCount);
+	std::memcpy(skeleton.data(), data + header.skeletonOffset, skeleton.size() * sizeof(int32_t));
+	out.skeleton.nodes.assign(skeleton.begin(), skeleton.begin() + header.skeletonSize);
+	out.skeleton.parents.assign(skeleton.begin() + header.skeletonSize, skeleton.begin() + header.skeletonSize * 2);
+	out.skeleton.jointEntries.assign(skeleton.begin() + header.skeletonSize * 2, skeleton.end());
+
+	dependencies.clear();
+	size_t offset = header.dependencyOffset;
+	for (uint32_t i = 0; i < header.dependencyCount; ++i) {
+		const void* end = offset < size ? std::memchr(data + offset, '\0', size - offset) : nullptr;
+		if (!end)
+			return false;
+		dependencies.emplace_back(reinterpret_cast<const char*>(data + offset));
+		offset = static_cast<const unsigned char*>(end) - data + 1;
+	}
+
+	out.boundsMin = glm::make_vec3(header.boundsMin);
+	out.boundsMax = glm::make_vec3(header.boundsMax);
+	out.nodeCount = header.nodeCount;
+	sourceHash = header.sourceHash;
+	return true;
+}
+
+static bool parseGltf(tinygltf::Model& model, const std::string& filename) {
+	tinygltf::TinyGLTF loader;
+	std::string err;
+	std::string warn;
+
+	// the runtime format has no images, so they are not decoded either
+	loader.SetImageLoader([](tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int,
+							 void*) { return true; }, nullptr);
+
+	// .glb keeps the JSON and the buffers in one file
+	bool binary = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".glb") == 0;
+	bool res = binary ? loader.LoadBinaryFromFile(&model, &err, &warn, filename)
+					  : loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+	if (!warn.empty()) {
+		std::cout << "WARN: " << warn << std::endl;
+	}
+
+	if (!err.empty()) {
+		std::cout << "ERR: " << err << std::endl;
+	}
+
+	if (!res)
+		std::cout << "Failed to load glTF: " << filename << std::endl;
+	else
+		std::cout << "Loaded glTF: " << filename << std::endl;
+
+	return res;
+}
+
+// element k of an accessor as up to 4 floats, normalized integers end up in [0, 1] (or [-1, 1])
+static glm::vec4 readAccessor(const tinygltf::Model& model, const tinygltf::Accessor& accessor, size_t k) {
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	const unsigned char* element = model.buffers[bufferView.buffer].data.data() + bufferView.byteOffset +
+								   accessor.byteOffset + k * accessor.ByteStride(bufferView);
+	int components = accessor.type == TINYGLTF_TYPE_SCALAR ? 1 : accessor.type;
+	glm::vec4 value(0.0f);
+	for (int c = 0; c < components && c < 4; ++c) {
+		switch (accessor.componentType) {
+		case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+			float f;
+			memcpy(&f, element + c * sizeof(float), sizeof(float));
+			value[c] = f;
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			value[c] = element[c] / (accessor.normalized ? 255.0f : 1.0f);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+			uint16_t u;
+			memcpy(&u, element + c * sizeof(uint16_t), sizeof(uint16_t));
+			value[c] = u / (accessor.normalized ? 65535.0f : 1.0f);
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+			uint32_t u;
+			memcpy(&u, element + c * sizeof(uint32_t), sizeof(uint32_t));
+			value[c] = float(u);
+			break;
+		}
+		}
+	}
+	return value;
+}
+
+// Triangle primitive as it goes to the GPU
+struct PackedPrimitive {
+	std::vector<PackedSkinnedVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+// Reads every triangle primitive of a mesh into PackedSkinnedVertex (octahedral normals, half UVs, unorm16 weights)
+// and reorders it for the post-transform cache and the vertex fetch
+static std::vector<PackedPrimitive> packMesh(const tinygltf::Model& model, size_t m) {
+	std::vector<PackedPrimitive> primitives;
+	for (const tinygltf::Primitive& primitive : model.meshes[m].primitives) {
+		PackedPrimitive packed;
+		auto position = primitive.attributes.find("POSITION");
+		bool triangles = primitive.mode == TINYGLTF_MODE_TRIANGLES || primitive.mode == -1;
+		if (!triangles || primitive.indices < 0 || position == primitive.attributes.end()) {
+			std::cout << "WARN: skipping a primitive of mesh " << m << " (only indexed triangles are supported)" << std::endl;
+			continue;
+		}
+
+		// missing attributes get a neutral value: no normal lighting, no texture, bound to the first joint
+		size_t vertexCount = model.accessors[position->second].count;
+		auto attribute = [&](const char* name) {
+			auto found = primitive.attributes.find(name);
+			return found == primitive.attributes.end() ? nullptr : &model.accessors[found->second];
+		};
+		const tinygltf::Accessor* normals = attribute("NORMAL");
+		const tinygltf::Accessor* uvs = attribute("TEXCOORD_0");
+		const tinygltf::Accessor* joints = attribute("JOINTS_0");
+		const tinygltf::Accessor* weights = attribute("WEIGHTS_0");
+
+		packed.vertices.resize(vertexCount);
+		for (size_t k = 0; k < vertexCount; ++k) {
+			PackedSkinnedVertex& v = packed.vertices[k];
+			v.position = glm::vec3(readAccessor(model, model.accessors[position->second], k));
+			glm::vec3 n = normals ? glm::vec3(readAccessor(model, *normals, k)) : glm::vec3(0.0f, 0.0f, 1.0f);
+			packOctahedral(glm::length(n) > 0.0f ? glm::normalize(n) : glm::vec3(0.0f, 0.0f, 1.0f), v.normal);
+			glm::vec2 uv = uvs ? glm::vec2(readAccessor(model, *uvs, k)) : glm::vec2(0.0f);
+			v.uv[0] = glm::packHalf1x16(uv.x);
+			v.uv[1] = glm::packHalf1x16(uv.y);
+			glm::vec4 j = joints ? readAccessor(model, *joints, k) : glm::vec4(0.0f);
+			glm::vec4 w = weights ? readAccessor(model, *weights, k) : glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+			for (int c = 0; c < 4; ++c) {
+				v.joints[c] = static_cast<uint8_t>(std::min(j[c], 255.0f));
+				v.weights[c] = glm::packUnorm1x16(w[c]);
+			}
+		}
+
+		const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+		packed.indices.resize(indexAccessor.count);
+		for (size_t k = 0; k < indexAccessor.count; ++k)
+			packed.indices[k] = static_cast<uint32_t>(readAccessor(model, indexAccessor, k).x);
+
+		// the exporter's order, then reordered for the post-transform cache and the vertex fetch
+		float acmrBefore = vertexCacheAcmr(packed.indices, vertexCount);
+		optimizeVertexCache(packed.indices, vertexCount);
+		remapVertices(packed.vertices, optimizeVertexFetch(packed.indices, vertexCount));
+		std::cout << "Mesh " << m << " primitive " << primitives.size() << ": " << packed.indices.size() / 3
+				  << " triangles, ACMR " << acmrBefore << " -> " << vertexCacheAcmr(packed.indices, packed.vertices.size())
+				  << std::endl;
+		primitives.push_back(std::move(packed));
+	}
+	return primitives;
+}
+
+// Meshes of the node and its children, depth first like drawing the scene graph did
+static void collectMeshes(const tinygltf::Model& model, int node, std::vector<int>& meshes) {
+	if (model.nodes[node].mesh >= 0 && model.nodes[node].mesh < int(model.meshes.size()))
+		meshes.push_back(model.nodes[node].mesh);
+	for (int child : model.nodes[node].children)
+		collectMeshes(model, child, meshes);
+}
+
+// Serializes everything ModelData needs from the parsed glTF
+static std::vector<unsigned char> importModel(const tinygltf::Model& model, uint64_t hash, const std::vector<std::string>& dependencies) {
+	CachedModelHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, CACHE_MAGIC, 4);
+	header.version = CACHE_VERSION;
+	header.sourceHash = hash;
+	header.nodeCount = uint32_t(model.nodes.size());
+	header.dependencyCount = uint32_t(dependencies.size());
+
+	// bounds of every POSITION accessor, the exporter writes their min and max
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+	for (const auto& mesh : model.meshes) {
+		for (const auto& primitive : mesh.primitives) {
+			auto posIt = primitive.attributes.find("POSITION");
+			if (posIt != primitive.attributes.end()) {
+				const auto& accessor = model.accessors[posIt->second];
+				for (int i = 0; i < 3 && i < int(accessor.minValues.size()) && i < int(accessor.maxValues.size()); i++) {
+					boundsMin[i] = std::min(boundsMin[i], (float)accessor.minValues[i]);
+					boundsMax[i] = std::max(boundsMax[i], (float)accessor.maxValues[i]);
+				}
+			}
+		}
+	}
+	std::memcpy(header.boundsMin, glm::value_ptr(boundsMin), sizeof(header.boundsMin));
+	std::memcpy(header.boundsMax, glm::value_ptr(boundsMax), sizeof(header.boundsMax));
+
+	// primitives in draw order, each mesh packed once however many nodes use it
+	std::vector<int> drawn;
+	if (!model.scenes.empty()) {
+		const tinygltf::Scene& scene = model.scenes[std::max(model.defaultScene, 0)];
+		for (int node : scene.nodes)
+			collectMeshes(model, node, drawn);
+	}
+	std::vector<std::vector<PackedPrimitive>> meshes(model.meshes.size());
+	std::vector<bool> packed(model.meshes.size(), false);
+	std::vector<const PackedPrimitive*> primitives;
+	for (int m : drawn) {
+		if (!packed[m]) {
+			meshes[m] = packMesh(model, m);
+			packed[m] = true;
+		}
+		for (const PackedPrimitive& primitive : meshes[m])
+			primitives.push_back(&primitive);
+	}
+	header.primitiveCount = uint32_t(primitives.size());
+
+	// first skin: inverse bind matrices and its hierarchy flattened from the root joint
+	std::vector<glm::mat4> inverseBind;
+	Skeleton skeleton;
+	if (!model.skins.empty()) {
+		const tinygltf::Skin& skin = model.skins[0];
+		const tinygltf::Accessor& accessor = model.accessors[skin.inverseBindMatrices];
+		const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+		const float* ptr = reinterpret_cast<const float*>(
+			model.buffers[bufferView.buffer].data.data() + accessor.byteOffset + bufferView.byteOffset);
+		inverseBind.resize(accessor.count);
+		for (size_t j = 0; j < accessor.count; j++)
+			inverseBind[j] = glm::make_mat4(ptr + j * 16);
+		skeleton = flattenSkeleton(model, skin);
+	}
+	header.jointCount = uint32_t(inverseBind.size());
+	header.skeletonSize = uint32_t(skeleton.size());
+
+	std::vector<AnimationObject> animations = prepareAnimation(model);
+	std::vector<AnimationClip> clips;
+	for (size_t i = 0; i < model.animations.size(); ++i)
+		clips.push_back(compileAnimation(model, model.animations[i], animations[i]));
+	header.clipCount = uint32_t(clips.size());
+
+	// section offsets after the tables
+	std::vector<CachedPrimitive> primitiveTable(primitives.size());
+	std::vector<CachedClip> clipTable(clips.size());
+	size_t offset = sizeof(header) + primitiveTable.size() * sizeof(CachedPrimitive) + clipTable.size() * sizeof(CachedClip);
+	size_t dependencyBytes = 0;
+	for (const std::string& name : dependencies)
+		dependencyBytes += name.size() + 1;
+	header.dependencyOffset = offset = align16(offset);
+	header.inverseBindOffset = offset = align16(offset + dependencyBytes);
+	header.skeletonOffset = offset = align16(offset + inverseBind.size() * sizeof(glm::mat4));
+	offset += (skeleton.size() * 2 + inverseBind.size()) * sizeof(int32_t);
+	// 16 bit indices whenever the primitive has few enough vertices
+	std::vector<std::vector<uint16_t>> shortIndices(primitives.size());
+	// a mesh drawn by several nodes is stored once, its entries share the offsets
+	std::vector<size_t> firstUse(primitives.size());
+	for (size_t i = 0; i < primitives.size(); ++i) {
+		firstUse[i] = std::find(primitives.begin(), primitives.end(), primitives[i]) - primitives.begin();
+		CachedPrimitive& entry = primitiveTable[i];
+		if (firstUse[i] != i) {
+			entry = primitiveTable[firstUse[i]];
+			continue;
+		}
+		entry.vertexCount = uint32_t(primitives[i]->vertices.size());
+		entry.indexCount = uint32_t(primitives[i]->indices.size());
+		entry.indexSize = narrowIndices(primitives[i]->indices, shortIndices[i]) ? 2 : 4;
+		entry.vertexOffset = offset = align16(offset);
+		entry.indexOffset = offset = align16(offset + entry.vertexCount * sizeof(PackedSkinnedVertex));
+		offset += size_t(entry.indexCount) * entry.indexSize;
+	}
+	for (size_t i = 0; i < clips.size(); ++i) {
+		CachedClip& entry = clipTable[i];
+		entry.duration = clips[i].duration;
+		entry.channelCount = uint32_t(clips[i].channels.size());
+		entry.keyCount = uint32_t(clips[i].times.size());
+		entry.channelOffset = offset = align16(offset);
+		entry.timeOffset = offset = align16(offset + entry.channelCount * sizeof(CachedClipChannel));
+		entry.valueOffset = offset = align16(offset + entry.keyCount * sizeof(float));
+		offset += entry.keyCount * sizeof(glm::vec4);
+	}
+
+	std::vector<unsigned char> bytes(align16(offset), 0);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + sizeof(header), primitiveTable.data(), primitiveTable.size() * sizeof(CachedPrimitive));
+	std::memcpy(bytes.data() + sizeof(header) + primitiveTable.size() * sizeof(CachedPrimitive), clipTable.data(),
+				clipTable.size() * sizeof(CachedClip));
+
+	unsigned char* dst = bytes.data() + header.dependencyOffset;
+	for (const std::string& name : dependencies) {
+		std::memcpy(dst, name.c_str(), name.size() + 1);
+		dst += name.size() + 1;
+	}
+	std::memcpy(bytes.data() + header.inverseBindOffset, inverseBind.data(), inverseBind.size() * sizeof(glm::mat4));
+	std::vector<int32_t> skeletonTable(skeleton.nodes.begin(), skeleton.nodes.end());
+	skeletonTable.insert(skeletonTable.end(), skeleton.parents.begin(), skeleton.parents.end());
+	skeletonTable.insert(skeletonTable.end(), skeleton.jointEntries.begin(), skeleton.jointEntries.end());
+	std::memcpy(bytes.data() + header.skeletonOffset, skeletonTable.data(), skeletonTable.size() * sizeof(int32_t));
+
+	for (size_t i = 0; i < primitives.size(); ++i) {
+		if (firstUse[i] != i)
+			continue;
+		const CachedPrimitive& entry = primitiveTable[i];
+		std::memcpy(bytes.data() + entry.vertexOffset, primitives[i]->vertices.data(), entry.vertexCount * sizeof(PackedSkinnedVertex));
+		if (entry.indexSize == 2)
+			std::memcpy(bytes.data() + entry.indexOffset, shortIndices[i].data(), shortIndices[i].size() * sizeof(uint16_t));
+		else
+			std::memcpy(bytes.data() + entry.indexOffset, primitives[i]->indices.data(), entry.indexCount * sizeof(uint32_t));
+	}
+	for (size_t i = 0; i < clips.size(); ++i) {
+		const CachedClip& entry = clipTable[i];
+		for (size_t c = 0; c < clips[i].channels.size(); ++c) {
+			const ClipChannel& channel = clips[i].channels[c];
+			CachedClipChannel cached = {channel.node, uint32_t(channel.target), uint32_t(channel.interpolation), channel.firstKey,
+										channel.keyCount};
+			std::memcpy(bytes.data() + entry.channelOffset + c * sizeof(CachedClipChannel), &cached, sizeof(cached));
+		}
+		std::memcpy(bytes.data() + entry.timeOffset, clips[i].times.data(), entry.keyCount * sizeof(float));
+		std::memcpy(bytes.data() + entry.valueOffset, clips[i].values.data(), entry.keyCount * sizeof(glm::vec4));
+	}
+	return bytes;
+}
+
+bool loadModel(const std::string& sourcePath, const std::string& cacheDir, ModelData& out) {
+	std::string cachePath = modelCachePath(sourcePath, cacheDir);
+
+	MappedFile source;
+	bool hasSource = source.open(sourcePath);
+
+	uint64_t cachedHash = 0;
+	std::vector<std::string> dependencies;
+	if (out.file.open(cachePath) && parseCache(out.file.data, out.file.size, out, cachedHash, dependencies)) {
+		if (!hasSource || cachedHash == modelHash(source, sourcePath, dependencies))
+			return true;
+	}
+	out.primitives.clear();
+	out.file.close();
+
+	if (!hasSource) {
+		std::cout << "Failed to load glTF: " << sourcePath << std::endl;
+		return false;
+	}
+
+	// cache miss: the slow path every launch used to take
+	tinygltf::Model model;
+	if (!parseGltf(model, sourcePath))
+		return false;
+
+	// external buffers, a .glb usually has none
+	dependencies.clear();
+	for (const tinygltf::Buffer& buffer : model.buffers) {
+		if (!buffer.uri.empty() && buffer.uri.compare(0, 5, "data:") != 0)
+			dependencies.push_back(buffer.uri);
+	}
+
+	out.storage = importModel(model, modelHash(source, sourcePath, dependencies), dependencies);
+	if (!parseCache(out.storage.data(), out.storage.size(), out, cachedHash, dependencies)) {
+		std::cout << "No triangles to draw in " << sourcePath << std::endl;
+		out.storage.clear();
+		return false;
+	}
+	writeCache(cachePath, cacheDir, out.storage);
+	return true;
+}
@@ -0,0 +1,206 @@
+#include "../cloudWorld/include/profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <set>
+
+Profiler profiler;
+
+uint64_t Profiler::nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::beginSession(const std::string& path) {
+	outputPath = path;
+	enabled = true;
+	frameIndex = 0;
+	sessionStartNs = nowNs();
+	cpuEvents.clear();
+	gpuEvents.clear();
+	openZones.clear();
+	cpuEvents.reserve(1 << 16);
+	gpuEvents.reserve(1 << 14);
+	droppedGpuFrames = 0;
+	gpuActiveZone = -1;
+
+	// all query objects up front, one ring slot per frame in flight
+	for (GpuFrame& gpuFrame : gpuFrames) {
+		glGenQueries(kMaxGpuZonesPerFrame, gpuFrame.queries);
+		gpuFrame.count = 0;
+		gpuFrame.pending = false;
+	}
+	std::cout << "Profiling session started, trace will be written to " << outputPath << std::endl;
+}
+
+void Profiler::endSession() {
+	if (!enabled) return;
+
+	// last frames: here it is fine to wait, the session is over
+	for (GpuFrame& gpuFrame : gpuFrames) {
+		collectGpuFrame(gpuFrame, true);
+		glDeleteQueries(kMaxGpuZonesPerFrame, gpuFrame.queries);
+	}
+	enabled = false;
+
+	if (writeTrace())
+		std::cout << "Wrote profiler trace " << outputPath << " (" << cpuEvents.size() << " CPU zones, "
+				  << gpuEvents.size() << " GPU zones)" << std::endl;
+	printSummary();
+}
+
+void Profiler::beginFrame() {
+	if (!enabled) return;
+
+	// The slot we are about to reuse was recorded kGpuFramesInFlight frames ago. If the GPU
+	// still has not finished it, its timings are dropped instead of waiting for them.
+	GpuFrame& gpuFrame = gpuFrames[frameIndex % kGpuFramesInFlight];
+	collectGpuFrame(gpuFrame, false);
+	if (gpuFrame.pending) {
+		droppedGpuFrames++;
+		gpuFrame.pending = false;
+	}
+	gpuFrame.count = 0;
+	gpuFrame.frame = frameIndex;
+
+	beginZone("frame");
+}
+
+void Profiler::endFrame() {
+	if (!enabled) return;
+	endZone();
+
+	GpuFrame& gpuFrame = gpuFrames[frameIndex % kGpuFramesInFlight];
+	gpuFrame.pending = gpuFrame.count > 0;
+	frameIndex++;
+}
+
+void Profiler::beginZone(const char* name) {
+	if (!enabled) return;
+	CpuEvent event;
+	event.name = name;
+	event.startNs = nowNs();
+	event.durationNs = 0;
+	event.depth = static_cast<int>(openZones.size());
+	event.frame = frameIndex;
+	openZones.push_back(cpuEvents.size());
+	cpuEvents.push_back(event);
+}
+
+void Profiler::endZone() {
+	if (!enabled || openZones.empty()) return;
+	CpuEvent& event = cpuEvents[openZones.back()];
+	event.durationNs = nowNs() - event.startNs;
+	openZones.pop_back();
+}
+
+void Profiler::beginGpuZone(const char* name) {
+	if (!enabled) return;
+	GpuFrame& gpuFrame = gpuFrames[frameIndex % kGpuFramesInFlight];
+	if (gpuActiveZone >= 0 || gpuFrame.count >= kMaxGpuZonesPerFrame) {
+		// TIME_ELAPSED queries cannot nest, and the slot has a fixed size
+		return;
+	}
+	gpuActiveZone = gpuFrame.count++;
+	gpuFrame.names[gpuActiveZone] = name;
+	gpuFrame.issueNs[gpuActiveZone] = nowNs();
+	glBeginQuery(GL_TIME_ELAPSED, gpuFrame.queries[gpuActiveZone]);
+}
+
+void Profiler::endGpuZone() {
+	if (!enabled || gpuActiveZone < 0) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuActiveZone = -1;
+}
+
+void Profiler::collectGpuFrame(GpuFrame& gpuFrame, bool wait) {
+	if (!gpuFrame.pending) return;
+
+	// queries complete in order, so the last one being available means all of them are
+	if (!wait) {
+		GLint available = 0;
+		glGetQueryObjectiv(gpuFrame.queries[gpuFrame.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) return;
+	}
+
+	for (int i = 0; i < gpuFrame.count; ++i) {
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(gpuFrame.queries[i], GL_QUERY_RESULT, &elapsed);
+		gpuEvents.push_back({gpuFrame.names[i], gpuFrame.issueNs[i], elapsed, gpuFrame.frame});
+	}
+	gpuFrame.pending = false;
+}
+
+// JSON string escaping for zone names (they are literals, but keep the file valid anyway)
+static void writeJsonString(FILE* f, const char* s) {
+	fputc('"', f);
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') fputc('\\', f);
+		fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+bool Profiler::writeTrace() const {
+	FILE* f = std::fopen(outputPath.c_str(), "w");
+	if (!f) {
+		std::cerr << "Failed to open profiler trace " << outputPath << std::endl;
+		return false;
+	}
+
+	// Chrome trace-event format: complete events ("ph":"X") with microsecond timestamps.
+	// tid 1 is the main thread, tid 2 the GPU track
+	std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU main\"}},\n");
+	std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+	for (const CpuEvent& e : cpuEvents) {
+		std::fprintf(f, ",\n{\"name\":");
+		writeJsonString(f, e.name);
+		std::fprintf(f, ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+					 (e.startNs - sessionStartNs) / 1000.0, e.durationNs / 1000.0, e.frame);
+	}
+
+	// GL_TIME_ELAPSED only gives durations. Each pass is placed at the time it was issued,
+	// pushed back so it never overlaps the previous pass (the GPU runs them in order)
+	std::vector<GpuEvent> sorted = gpuEvents;
+	std::sort(sorted.begin(), sorted.end(), [](const GpuEvent& a, const GpuEvent& b) { return a.issueNs < b.issueNs; });
+	uint64_t gpuCursor = 0;
+	for (const GpuEvent& e : sorted) {
+		uint64_t start = std::max(e.issueNs, gpuCursor);
+		gpuCursor = start + e.durationNs;
+		std::fprintf(f, ",\n{\"name\":");
+		writeJsonString(f, e.name);
+		std::fprintf(f, ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+					 (start - sessionStartNs) / 1000.0, e.durationNs / 1000.0, e.frame);
+	}
+
+	std::fprintf(f, "\n]}\n");
+	std::fclose(f);
+	return true;
+}
+
+void Profiler::printSummary() const {
+	if (frameIndex == 0) return;
+
+	// average milliseconds per frame for every zone name
+	std::map<std::string, double> cpuTotals, gpuTotals;
+	for (const CpuEvent& e : cpuEvents) cpuTotals[e.name] += e.durationNs / 1e6;
+	for (const GpuEvent& e : gpuEvents) gpuTotals[e.name] += e.durationNs / 1e6;
+
+	std::cout << "Profiler summary over " << frameIndex << " frames (avg ms per frame)" << std::endl;
+	for (const auto& entry : cpuTotals) {
+		std::printf("  cpu %-24s %8.3f\n", entry.first.c_str(), entry.second / frameIndex);
+	}
+	// GPU frames that were dropped are not part of the average
+	std::set<uint32_t> measuredFrames;
+	for (const GpuEvent& e : gpuEvents) measuredFrames.insert(e.frame);
+	for (const auto& entry : gpuTotals) {
+		std::printf("  gpu %-24s %8.3f\n", entry.first.c_str(), entry.second / measuredFrames.size());
+	}
+	if (droppedGpuFrames > 0)
+		std::cout << "  (" << droppedGpuFrames << " GPU frames dropped because results were not ready in time)" << std::endl;
+}
@@ -0,0 +1,117 @@
+#include "../cloudWorld/include/render_queue.h"
+#include "../cloudWorld/include/profiler.h"
+
+#include <algorithm>
+
+void RenderQueue::setInstanceBinder(InstanceSource source, std::function<void(size_t)> binder) {
+	instanceBinders[source] = std::move(binder);
+}
+
+void RenderQueue::submit(const DrawItem& item, RenderLayer layer, float depth) {
+	uint64_t quantized = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * 0xFFFFFF);
+	items.push_back(item);
+	items.back().key = (uint64_t(layer & 0xF) << 60) |
+					   (uint64_t(item.program ? item.program->id & 0xFFF : 0) << 48) |
+					   (uint64_t(item.vao & 0xFFF) << 36) |
+					   (uint64_t(item.textures[0].id & 0xFFF) << 24) |
+					   quantized;
+}
+
+void RenderQueue::execute(const UniformBlockBuffer& drawBlocks) {
+	keys.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i)
+		keys[i] = items[i].key;
+	radixSortKeys(keys, order, scratch);
+
+	// nothing is known to be bound yet, the first item binds all of its state
+	const DrawItem* last = nullptr;
+	const char* zone = nullptr;
+	stateChanges = 0;
+	for (uint32_t index : order) {
+		DrawItem& item = items[index];
+		if (item.zone != zone) {
+			if (zone) {
+				profiler.endGpuZone();
+				profiler.endZone();
+			}
+			zone = item.zone;
+			if (zone) {
+				profiler.beginZone(zone);
+				profiler.beginGpuZone(zone);
+			}
+		}
+
+		if (!last || item.program != last->program) {
+			if (item.program)
+				item.program->use();
+			else
+				glUseProgram(0);
+			++stateChanges;
+		}
+		bool vaoChanged = !last || item.vao != last->vao;
+		if (vaoChanged) {
+			glBindVertexArray(item.vao);
+			++stateChanges;
+		}
+		for (int unit = 0; unit < MAX_ITEM_TEXTURES; ++unit) {
+			const TextureBinding& texture = item.textures[unit];
+			if (texture.id == 0)
+				continue;
+			if (last && last->textures[unit].id == texture.id && last->textures[unit].target == texture.target)
+				continue;
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(texture.target, texture.id);
+			++stateChanges;
+		}
+		if (item.drawSlot >= 0 && (!last || item.drawSlot != last->drawSlot)) {
+			drawBlocks.bind(DRAW_DATA_BINDING, item.drawSlot);
+			++stateChanges;
+		}
+		if (!last || item.depthWrite != last->depthWrite) {
+			glDepthMask(item.depthWrite ? GL_TRUE : GL_FALSE);
+			++stateChanges;
+		}
+		if (!last || item.depthFunc != last->depthFunc) {
+			glDepthFunc(item.depthFunc);
+			++stateChanges;
+		}
+		glActiveTexture(GL_TEXTURE0);
+
+		// the instance attributes are VAO state
+		if (item.instances != INSTANCES_NONE &&
+			(vaoChanged || item.instances != last->instances || item.firstInstance != last->firstInstance)) {
+			instanceBinders[item.instances](item.firstInstance);
+			++stateChanges;
+		}
+		if (item.program) {
+			for (const ItemUniform& uniform : item.uniforms)
+				item.program->set(uniform.handle, uniform.value);
+		}
+
+		if (item.indexType != 0) {
+			const void* indices = reinterpret_cast<const void*>(item.indexOffset);
+			if (item.instanceCount > 0)
+				glDrawElementsInstancedBaseVertex(item.mode, item.count, item.indexType, indices, item.instanceCount,
+												  item.baseVertex);
+			else
+				glDrawElementsBaseVertex(item.mode, item.count, item.indexType, indices, item.baseVertex);
+		} else {
+			if (item.instanceCount > 0)
+				glDrawArraysInstanced(item.mode, item.baseVertex, item.count, item.instanceCount);
+			else
+				glDrawArrays(item.mode, item.baseVertex, item.count);
+		}
+		last = &item;
+	}
+	if (zone) {
+		profiler.endGpuZone();
+		profiler.endZone();
+	}
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	executedItems = items.size();
+	items.clear();
+}
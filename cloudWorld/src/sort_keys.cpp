@@ -0,0 +1,30 @@
+#include "../cloudWorld/include/sort_keys.h"
+
+#include <cstddef>
+
+void radixSortKeys(const std::vector<uint64_t>& keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch) {
+	order.resize(keys.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = static_cast<uint32_t>(i);
+	scratch.resize(keys.size());
+	if (keys.size() < 2)
+		return;
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t counts[256] = {};
+		for (uint64_t key : keys)
+			++counts[(key >> shift) & 0xFF];
+		if (counts[(keys[0] >> shift) & 0xFF] == keys.size())
+			continue;	// every key has this byte, the order stays as it is
+
+		size_t offsets[256];
+		size_t sum = 0;
+		for (int b = 0; b < 256; ++b) {
+			offsets[b] = sum;
+			sum += counts[b];
+		}
+		for (uint32_t index : order)
+			scratch[offsets[(keys[index] >> shift) & 0xFF]++] = index;
+		order.swap(scratch);
+	}
+}
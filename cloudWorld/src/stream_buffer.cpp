@@ -0,0 +1,144 @@
+#include "../cloudWorld/include/stream_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// GL 4.4 / GL_ARB_buffer_storage, glad is generated for 3.3 without extensions
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (GLAD_API_PTR *BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static BufferStorageProc bufferStorage = nullptr;
+static bool persistentMapping = false;
+
+static const GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+void loadBufferStorage(GLADloadfunc load) {
+	bufferStorage = nullptr;
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool supported = major > 4 || (major == 4 && minor >= 4);
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count && !supported; ++i) {
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		supported = name && std::strcmp(name, "GL_ARB_buffer_storage") == 0;
+	}
+	if (supported)
+		bufferStorage = reinterpret_cast<BufferStorageProc>(load("glBufferStorage"));
+}
+
+bool setPersistentMapping(bool enabled) {
+	persistentMapping = enabled && bufferStorage != nullptr;
+	return persistentMapping;
+}
+
+void StreamBuffer::create(GLenum bufferTarget, size_t regionBytes, size_t regionAlignment) {
+	target = bufferTarget;
+	alignment = std::max<size_t>(regionAlignment, 1);
+	persistent = persistentMapping;
+	allocate(regionBytes);
+}
+
+void StreamBuffer::allocate(size_t bytes) {
+	regionSize = (std::max<size_t>(bytes, 1) + alignment - 1) / alignment * alignment;
+	size_t total = regionSize * STREAM_REGIONS;
+	// new storage, nothing reads it yet
+	for (GLsync& fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	region = STREAM_REGIONS - 1;
+	offset = 0;
+
+	if (persistent) {
+		// immutable storage cannot grow: a new buffer, made before the old one is deleted so its name differs
+		GLuint grown;
+		glGenBuffers(1, &grown);
+		glBindBuffer(target, grown);
+		bufferStorage(target, total, nullptr, PERSISTENT_FLAGS);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, total, PERSISTENT_FLAGS));
+		glBindBuffer(target, 0);
+		if (buffer)
+			glDeleteBuffers(1, &buffer);	// unmaps it, draws still reading it keep the storage alive
+		buffer = grown;
+		if (mapped)
+			return;
+		// the driver refused the mapping, stream like GL 3.3 from now on
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		persistent = false;
+	}
+
+	if (!buffer)
+		glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	glBufferData(target, total, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(target, 0);
+}
+
+void StreamBuffer::destroy() {
+	for (GLsync& fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	mapped = nullptr;
+	regionSize = 0;
+	offset = 0;
+}
+
+size_t StreamBuffer::write(const void* data, size_t bytes) {
+	if (bytes == 0)
+		return offset;
+
+	// every draw reading the last write has been issued by now
+	if (persistent) {
+		if (fences[region])
+			glDeleteSync(fences[region]);
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	if (bytes > regionSize)
+		allocate(std::max(bytes, regionSize * 2));
+
+	region = (region + 1) % STREAM_REGIONS;
+	offset = region * regionSize;
+
+	if (persistent) {
+		if (GLsync fence = fences[region]) {
+			// put two writes ago, only waits when the GPU is that far behind
+			GLenum status;
+			do {
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			} while (status == GL_TIMEOUT_EXPIRED);
+			glDeleteSync(fence);
+			fences[region] = nullptr;
+		}
+		std::memcpy(mapped + offset, data, bytes);
+		return offset;
+	}
+
+	glBindBuffer(target, buffer);
+	// back at the first region: orphan, the draws of the last round keep reading the old storage
+	if (region == 0)
+		glBufferData(target, regionSize * STREAM_REGIONS, nullptr, GL_STREAM_DRAW);
+	// nothing in flight reads this region of the current storage, so no need to synchronize
+	void* destination = glMapBufferRange(target, offset, bytes,
+									 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (destination) {
+		std::memcpy(destination, data, bytes);
+		glUnmapBuffer(target);
+	} else {
+		glBufferSubData(target, offset, bytes, data);
+	}
+	glBindBuffer(target, 0);
+	return offset;
+}
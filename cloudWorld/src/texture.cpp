@@ -0,0 +1,178 @@
+#include "../cloudWorld/include/texture.h"
+#include "../cloudWorld/include/texture_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+bool textureCompressionSupported() {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+			return true;
+	}
+	return false;
+}
+
+GLuint createPlaceholderTexture(const glm::vec4& color) {
+	unsigned char texel[4];
+	for (int i = 0; i < 4; ++i)
+		texel[i] = static_cast<unsigned char>(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+}
+
+// One level of a 2D texture, either format
+static void uploadLevel(GLenum target, int level, TextureFormat format, const TextureData::Level& data) {
+	if (format == TEXTURE_BC1)
+		glCompressedTexImage2D(target, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, data.width, data.height, 0,
+							   static_cast<GLsizei>(data.size), data.data);
+	else
+		glTexImage2D(target, level, GL_RGBA8, data.width, data.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data);
+}
+
+// Practically the same as lab2 loadTextureTileBox(), except the mipmaps come prebuilt from the cache
+void uploadTexture(GLuint textureID, const TextureData& texture) {
+	if (!texture.valid())
+		return;
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	for (size_t level = 0; level < texture.levels.size(); ++level)
+		uploadLevel(GL_TEXTURE_2D, static_cast<int>(level), texture.format, texture.levels[level]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size() - 1));
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+static int mipLevels(int size) {
+	return 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(size, 1)))));
+}
+
+void TextureArray::create(int arraySize, int layerCount, const glm::vec4& placeholder, TextureFormat arrayFormat) {
+	size = std::max(arraySize, 1);
+	layers = layerCount;
+	levels = mipLevels(size);
+	format = arrayFormat;
+
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+	for (int level = 0; level < levels; ++level) {
+		int levelSize = std::max(1, size >> level);
+		if (format == TEXTURE_BC1)
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, levelSize, levelSize, layers, 0,
+								   static_cast<GLsizei>(bc1Size(levelSize, levelSize) * layers), nullptr);
+		else
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelSize, levelSize, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glGenFramebuffers(1, &readFBO);
+	glGenFramebuffers(1, &drawFBO);
+	for (int layer = 0; layer < layers; ++layer)
+		fillLayer(layer, placeholder);
+}
+
+void TextureArray::destroy() {
+	glDeleteTextures(1, &id);
+	glDeleteFramebuffers(1, &readFBO);
+	glDeleteFramebuffers(1, &drawFBO);
+	id = readFBO = drawFBO = 0;
+}
+
+bool TextureArray::setLayer(int layer, const TextureData& texture) {
+	if (!texture.valid() || layer < 0 || layer >= layers || texture.format != format)
+		return false;
+
+	// smallest level that is still at least as big as the layer
+	size_t base = 0;
+	while (base + 1 < texture.levels.size() &&
+		   std::max(texture.levels[base + 1].width, texture.levels[base + 1].height) >= size)
+		++base;
+	const TextureData::Level& first = texture.levels[base];
+
+	if (first.width == size && first.height == size) {
+		// square at the layer size: the rest of the chain lines up level by level, straight copies
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		for (int level = 0; level < levels && base + level < texture.levels.size(); ++level) {
+			const TextureData::Level& data = texture.levels[base + level];
+			if (format == TEXTURE_BC1)
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, data.width, data.height, 1,
+										  GL_COMPRESSED_RGB_S3TC_DXT1_EXT, static_cast<GLsizei>(data.size), data.data);
+			else
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, data.width, data.height, 1,
+								GL_RGBA, GL_UNSIGNED_BYTE, data.data);
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		return true;
+	}
+
+	// compressed blocks cannot be rendered into, so no scaling for those
+	if (format == TEXTURE_BC1)
+		return false;
+
+	// other sizes: the chain goes into a staging texture and every level is scaled into the layer by a blit
+	GLuint staging;
+	glGenTextures(1, &staging);
+	uploadTexture(staging, texture);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+	for (int level = 0; level < levels; ++level) {
+		size_t source = std::min(base + level, texture.levels.size() - 1);
+		int levelSize = std::max(1, size >> level);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, staging, static_cast<GLint>(source));
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id, level, layer);
+		glBlitFramebuffer(0, 0, texture.levels[source].width, texture.levels[source].height,
+						  0, 0, levelSize, levelSize, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteTextures(1, &staging);
+	return true;
+}
+
+void TextureArray::fillLayer(int layer, const glm::vec4& color) {
+	if (format == TEXTURE_BC1) {
+		// not renderable either, upload solid blocks instead
+		unsigned char block[8];
+		solidBC1Block(static_cast<unsigned char>(glm::clamp(color.r, 0.0f, 1.0f) * 255.0f + 0.5f),
+					  static_cast<unsigned char>(glm::clamp(color.g, 0.0f, 1.0f) * 255.0f + 0.5f),
+					  static_cast<unsigned char>(glm::clamp(color.b, 0.0f, 1.0f) * 255.0f + 0.5f), block);
+		std::vector<unsigned char> blocks;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		for (int level = 0; level < levels; ++level) {
+			int levelSize = std::max(1, size >> level);
+			size_t bytes = bc1Size(levelSize, levelSize);
+			blocks.resize(bytes);
+			for (size_t i = 0; i < bytes; i += 8)
+				std::memcpy(&blocks[i], block, 8);
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelSize, levelSize, 1,
+									  GL_COMPRESSED_RGB_S3TC_DXT1_EXT, static_cast<GLsizei>(bytes), blocks.data());
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		return;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+	for (int level = 0; level < levels; ++level) {
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id, level, layer);
+		glClearBufferfv(GL_COLOR, 0, &color[0]);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
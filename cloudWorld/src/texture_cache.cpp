@@ -0,0 +1,206 @@
+#include "../cloudWorld/include/texture_cache.h"
+#include "../cloudWorld/include/texture_codec.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char CACHE_MAGIC[4] = {'C', 'W', 'T', 'X'};
+static const uint32_t CACHE_VERSION = 1;
+
+bool MappedFile::open(const std::string& path) {
+	close();
+#ifdef _WIN32
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	fallback.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (fallback.empty() || !file.read(reinterpret_cast<char*>(fallback.data()), fallback.size())) {
+		fallback.clear();
+		return false;
+	}
+	data = fallback.data();
+	size = fallback.size();
+	return true;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);	// the mapping stays valid
+	if (mapped == MAP_FAILED)
+		return false;
+	data = static_cast<const unsigned char*>(mapped);
+	size = static_cast<size_t>(info.st_size);
+	return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+	if (data)
+		munmap(const_cast<unsigned char*>(data), size);
+#endif
+	fallback.clear();
+	data = nullptr;
+	size = 0;
+}
+
+std::string textureCachePath(const std::string& sourcePath, const std::string& cacheDir, bool compress) {
+	size_t slash = sourcePath.find_last_of("/\\");
+	std::string name = slash == std::string::npos ? sourcePath : sourcePath.substr(slash + 1);
+	return cacheDir + "/" + name + (compress ? ".bc1" : "") + ".cwtex";
+}
+
+// Checks the container and points the levels of out at it, false if it is truncated or not a .cwtex
+static bool parseCache(const unsigned char* data, size_t size, TextureData& out, uint64_t& sourceHash) {
+	if (size < sizeof(CachedTextureHeader))
+		return false;
+	CachedTextureHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != CACHE_VERSION)
+		return false;
+	if (header.format != TEXTURE_RGBA8 && header.format != TEXTURE_BC1)
+		return false;
+	if (header.levels == 0 || size < sizeof(header) + size_t(header.levels) * sizeof(CachedTextureLevel))
+		return false;
+
+	out.levels.clear();
+	for (uint32_t i = 0; i < header.levels; ++i) {
+		CachedTextureLevel level;
+		std::memcpy(&level, data + sizeof(header) + i * sizeof(CachedTextureLevel), sizeof(level));
+		if (level.offset > size || level.size > size - level.offset)
+			return false;
+		out.levels.push_back({int(level.width), int(level.height), data + level.offset, size_t(level.size)});
+	}
+	out.format = static_cast<TextureFormat>(header.format);
+	out.width = int(header.width);
+	out.height = int(header.height);
+	sourceHash = header.sourceHash;
+	return true;
+}
+
+// Writes through a temporary file so other instances starting at the same time never map half a cache
+void writeCache(const std::string& path, const std::string& cacheDir, const std::vector<unsigned char>& bytes) {
+#ifdef _WIN32
+	_mkdir(cacheDir.c_str());
+	std::string temporary = path + "." + std::to_string(_getpid()) + ".tmp";
+#else
+	mkdir(cacheDir.c_str(), 0755);
+	std::string temporary = path + "." + std::to_string(getpid()) + ".tmp";
+#endif
+	FILE* file = std::fopen(temporary.c_str(), "wb");
+	if (!file) {
+		std::cerr << "Cannot write cache " << path << std::endl;
+		return;
+	}
+	bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	written = std::fclose(file) == 0 && written;
+	if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+		std::remove(temporary.c_str());
+		std::cerr << "Cannot write cache " << path << std::endl;
+	}
+}
+
+static size_t align16(size_t offset) {
+	return (offset + 15) & ~size_t(15);
+}
+
+bool loadTexture(const std::string& sourcePath, const std::string& cacheDir, bool compress, TextureData& out) {
+	std::string cachePath = textureCachePath(sourcePath, cacheDir, compress);
+
+	MappedFile source;
+	bool hasSource = source.open(sourcePath);
+	uint64_t hash = hasSource ? fnv1a64(source.data, source.size) : 0;
+
+	uint64_t cachedHash = 0;
+	if (out.file.open(cachePath) && parseCache(out.file.data, out.file.size, out, cachedHash)) {
+		bool wantedFormat = out.format == (compress ? TEXTURE_BC1 : TEXTURE_RGBA8);
+		if (wantedFormat && (!hasSource || cachedHash == hash))
+			return true;
+	}
+	out.levels.clear();
+	out.file.close();
+
+	if (!hasSource) {
+		std::cout << "Failed to load texture: " << sourcePath << std::endl;
+		return false;
+	}
+
+	// cache miss: the slow path every launch used to take
+	int width, height, channels;
+	unsigned char* pixels = stbi_load_from_memory(source.data, static_cast<int>(source.size), &width, &height, &channels, 4);
+	if (!pixels) {
+		std::cout << "Failed to load texture: " << sourcePath << std::endl;
+		return false;
+	}
+	std::vector<ImageLevel> chain = buildMipChain(pixels, width, height);
+	stbi_image_free(pixels);
+
+	CachedTextureHeader header;
+	std::memcpy(header.magic, CACHE_MAGIC, 4);
+	header.version = CACHE_VERSION;
+	header.sourceHash = hash;
+	header.format = compress ? TEXTURE_BC1 : TEXTURE_RGBA8;
+	header.width = uint32_t(width);
+	header.height = uint32_t(height);
+	header.levels = uint32_t(chain.size());
+
+	std::vector<CachedTextureLevel> table(chain.size());
+	size_t offset = align16(sizeof(header) + table.size() * sizeof(CachedTextureLevel));
+	for (size_t i = 0; i < chain.size(); ++i) {
+		table[i].width = uint32_t(chain[i].width);
+		table[i].height = uint32_t(chain[i].height);
+		table[i].offset = offset;
+		table[i].size = compress ? bc1Size(chain[i].width, chain[i].height) : chain[i].pixels.size();
+		offset = align16(offset + table[i].size);
+	}
+
+	std::vector<unsigned char>& bytes = out.storage;
+	bytes.assign(offset, 0);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + sizeof(header), table.data(), table.size() * sizeof(CachedTextureLevel));
+	for (size_t i = 0; i < chain.size(); ++i) {
+		unsigned char* dst = bytes.data() + table[i].offset;
+		if (compress)
+			compressBC1(chain[i].pixels.data(), chain[i].width, chain[i].height, dst);
+		else
+			std::memcpy(dst, chain[i].pixels.data(), chain[i].pixels.size());
+	}
+
+	writeCache(cachePath, cacheDir, bytes);
+	return parseCache(bytes.data(), bytes.size(), out, cachedHash);
+}
+
+int textureSize(const std::string& sourcePath, const std::string& cacheDir, bool compress) {
+	std::ifstream cache(textureCachePath(sourcePath, cacheDir, compress), std::ios::binary);
+	CachedTextureHeader header;
+	if (cache.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+		std::memcmp(header.magic, CACHE_MAGIC, 4) == 0 && header.version == CACHE_VERSION)
+		return int(std::max(header.width, header.height));
+
+	int width, height, channels;
+	if (!stbi_info(sourcePath.c_str(), &width, &height, &channels))
+		return 0;
+	return std::max(width, height);
+}
@@ -0,0 +1,154 @@
+#include "../cloudWorld/include/texture_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+uint64_t fnv1a64(const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::vector<ImageLevel> buildMipChain(const unsigned char* rgba, int width, int height) {
+	std::vector<ImageLevel> chain(1);
+	chain[0].width = width;
+	chain[0].height = height;
+	chain[0].pixels.assign(rgba, rgba + size_t(width) * height * 4);
+
+	while (chain.back().width > 1 || chain.back().height > 1) {
+		const ImageLevel& src = chain.back();
+		ImageLevel dst;
+		dst.width = std::max(1, src.width / 2);
+		dst.height = std::max(1, src.height / 2);
+		dst.pixels.resize(size_t(dst.width) * dst.height * 4);
+
+		for (int y = 0; y < dst.height; ++y) {
+			// odd sizes and 1 pixel wide levels reuse the last row/column
+			int y0 = std::min(2 * y, src.height - 1);
+			int y1 = std::min(2 * y + 1, src.height - 1);
+			for (int x = 0; x < dst.width; ++x) {
+				int x0 = std::min(2 * x, src.width - 1);
+				int x1 = std::min(2 * x + 1, src.width - 1);
+				const unsigned char* a = &src.pixels[(size_t(y0) * src.width + x0) * 4];
+				const unsigned char* b = &src.pixels[(size_t(y0) * src.width + x1) * 4];
+				const unsigned char* c = &src.pixels[(size_t(y1) * src.width + x0) * 4];
+				const unsigned char* d = &src.pixels[(size_t(y1) * src.width + x1) * 4];
+				unsigned char* out = &dst.pixels[(size_t(y) * dst.width + x) * 4];
+				for (int ch = 0; ch < 4; ++ch)
+					out[ch] = static_cast<unsigned char>((a[ch] + b[ch] + c[ch] + d[ch] + 2) / 4);
+			}
+		}
+		chain.push_back(std::move(dst));
+	}
+	return chain;
+}
+
+size_t bc1Size(int width, int height) {
+	return size_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+static uint16_t toRGB565(const int color[3]) {
+	int r = (color[0] * 31 + 127) / 255;
+	int g = (color[1] * 63 + 127) / 255;
+	int b = (color[2] * 31 + 127) / 255;
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void fromRGB565(uint16_t c, int color[3]) {
+	int r = (c >> 11) & 31;
+	int g = (c >> 5) & 63;
+	int b = c & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void writeBlock(uint16_t c0, uint16_t c1, uint32_t indices, unsigned char out[8]) {
+	out[0] = c0 & 0xff;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xff;
+	out[3] = c1 >> 8;
+	for (int i = 0; i < 4; ++i)
+		out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+static void compressBlock(const unsigned char block[16][4], unsigned char out[8]) {
+	int lo[3] = {255, 255, 255};
+	int hi[3] = {0, 0, 0};
+	for (int i = 0; i < 16; ++i) {
+		for (int ch = 0; ch < 3; ++ch) {
+			lo[ch] = std::min(lo[ch], int(block[i][ch]));
+			hi[ch] = std::max(hi[ch], int(block[i][ch]));
+		}
+	}
+	// pull the endpoints in by 1/16 of the range, the extremes are often single noisy texels
+	for (int ch = 0; ch < 3; ++ch) {
+		int inset = (hi[ch] - lo[ch]) >> 4;
+		lo[ch] = std::min(255, lo[ch] + inset);
+		hi[ch] = std::max(0, hi[ch] - inset);
+	}
+
+	uint16_t c0 = toRGB565(hi);
+	uint16_t c1 = toRGB565(lo);
+	if (c0 == c1) {
+		writeBlock(c0, c1, 0, out);
+		return;
+	}
+	// c0 > c1 selects the four color mode
+	if (c0 < c1) std::swap(c0, c1);
+
+	int palette[4][3];
+	fromRGB565(c0, palette[0]);
+	fromRGB565(c1, palette[1]);
+	for (int ch = 0; ch < 3; ++ch) {
+		palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+		palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+	}
+
+	uint32_t indices = 0;
+	for (int i = 0; i < 16; ++i) {
+		int best = 0;
+		int bestDistance = 1 << 30;
+		for (int p = 0; p < 4; ++p) {
+			int distance = 0;
+			for (int ch = 0; ch < 3; ++ch) {
+				int d = int(block[i][ch]) - palette[p][ch];
+				distance += d * d;
+			}
+			if (distance < bestDistance) {
+				bestDistance = distance;
+				best = p;
+			}
+		}
+		indices |= uint32_t(best) << (2 * i);
+	}
+	writeBlock(c0, c1, indices, out);
+}
+
+void compressBC1(const unsigned char* rgba, int width, int height, unsigned char* out) {
+	unsigned char block[16][4];
+	for (int by = 0; by < height; by += 4) {
+		for (int bx = 0; bx < width; bx += 4) {
+			// edge blocks repeat the last texels, the padding is never sampled
+			for (int y = 0; y < 4; ++y) {
+				int sy = std::min(by + y, height - 1);
+				for (int x = 0; x < 4; ++x) {
+					int sx = std::min(bx + x, width - 1);
+					std::memcpy(block[y * 4 + x], rgba + (size_t(sy) * width + sx) * 4, 4);
+				}
+			}
+			compressBlock(block, out);
+			out += 8;
+		}
+	}
+}
+
+void solidBC1Block(unsigned char r, unsigned char g, unsigned char b, unsigned char out[8]) {
+	int color[3] = {r, g, b};
+	uint16_t c = toRGB565(color);
+	writeBlock(c, c, 0, out);
+}
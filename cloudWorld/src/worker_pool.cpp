@@ -0,0 +1,50 @@
+#include "../cloudWorld/include/worker_pool.h"
+
+void WorkerPool::start(unsigned count) {
+	if (!threads.empty())
+		return;
+
+	if (count == 0) {
+		unsigned hardware = std::thread::hardware_concurrency();	// 0 when unknown
+		count = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	stopping = false;
+	for (unsigned i = 0; i < count; ++i)
+		threads.emplace_back(&WorkerPool::run, this);
+}
+
+void WorkerPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	wake.notify_all();
+	for (std::thread& t : threads)
+		t.join();
+	threads.clear();
+}
+
+void WorkerPool::submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	wake.notify_one();
+}
+
+void WorkerPool::run() {
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
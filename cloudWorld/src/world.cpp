@@ -0,0 +1,189 @@
+#include "../cloudWorld/include/world.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+float wrapFloat(float value, float period) {
+	float half = period * 0.5f;
+	value = fmod(value + half, period);
+	if (value < 0.0f) value += period;
+	return value - half;
+}
+
+void wrapPosition(glm::vec3& p, float size) {
+	p.x = wrapFloat(p.x, size);
+	p.y = wrapFloat(p.y, size);
+	p.z = wrapFloat(p.z, size);
+}
+
+glm::vec3 wrapPlanetPosition(const glm::vec3& planetPos, const glm::vec3& eye) {
+	glm::vec3 p = planetPos;
+	p.x = wrapFloat(p.x - eye.x, WORLD_SIZE) + eye.x;
+	p.y = wrapFloat(p.y - eye.y, WORLD_SIZE) + eye.y;
+	p.z = wrapFloat(p.z - eye.z, WORLD_SIZE) + eye.z;
+	return p;
+}
+
+glm::vec3 randomInSphere(float radius) {
+	glm::vec3 p;
+	do {
+		p = glm::vec3(
+			(float(rand()) / RAND_MAX) * 2.0f - 1.0f,
+			(float(rand()) / RAND_MAX) * 2.0f - 1.0f,
+			(float(rand()) / RAND_MAX) * 2.0f - 1.0f
+		);
+	} while (glm::length(p) > 1.0f);
+	return p * radius;
+}
+
+// Spatial hash over the wrapped planet positions (the background grid of Bridson's Poisson disk sampling).
+// Radii vary a lot (gas giants are 35x an asteroid), so every planet is stored in all cells its sphere
+// overlaps, and a candidate looks at the cells its sphere grown by the separation overlaps: any planet
+// closer than the two radii plus the separation shares at least one of those cells with it.
+// The world is a torus, so the grid is too: a whole number of cells spans WORLD_SIZE and cell coordinates
+// wrap around, a sphere that crosses a face of the cube also lands in the cells on the opposite side.
+// Cells hash into a fixed table of chains, so sparse fields and dense ones use the same memory.
+struct PlanetHash {
+	int cells;						// per axis
+	float cellSize;					// WORLD_SIZE / cells
+	std::vector<int> heads;			// first entry per hash bucket, -1 if empty
+	struct Entry { int planet; int next; };
+	std::vector<Entry> entries;
+
+	// minCell: smallest cell size that keeps the number of cells a sphere overlaps low
+	PlanetHash(float minCell, size_t expectedPlanets) {
+		cells = std::max(1, static_cast<int>(WORLD_SIZE / minCell));
+		cellSize = WORLD_SIZE / cells;
+		size_t buckets = 1024;
+		while (buckets < expectedPlanets * 8) buckets *= 2;
+		heads.assign(buckets, -1);
+	}
+
+	size_t bucket(int x, int y, int z) const {
+		x = wrap(x);
+		y = wrap(y);
+		z = wrap(z);
+		uint32_t h = uint32_t(x) * 73856093u ^ uint32_t(y) * 19349663u ^ uint32_t(z) * 83492791u;
+		return h & (heads.size() - 1);
+	}
+
+	int wrap(int c) const {
+		c %= cells;
+		return c < 0 ? c + cells : c;
+	}
+
+	int cell(float v) const { return static_cast<int>(std::floor(v / cellSize)); }
+
+	// cells covered by [v - radius, v + radius] along one axis, at most all of them once
+	void range(float v, float radius, int& first, int& last) const {
+		first = cell(v - radius);
+		last = std::min(cell(v + radius), first + cells - 1);
+	}
+
+	void insert(int planet, const glm::vec3& center, float radius) {
+		int x0, x1, y0, y1, z0, z1;
+		range(center.x, radius, x0, x1);
+		range(center.y, radius, y0, y1);
+		range(center.z, radius, z0, z1);
+		for (int z = z0; z <= z1; ++z)
+			for (int y = y0; y <= y1; ++y)
+				for (int x = x0; x <= x1; ++x) {
+					size_t b = bucket(x, y, z);
+					entries.push_back({planet, heads[b]});
+					heads[b] = static_cast<int>(entries.size() - 1);
+				}
+	}
+
+	// calls fn for every planet that may be within reach of the sphere (duplicates and hash collisions included)
+	template <typename Fn>
+	bool anyNear(const glm::vec3& center, float reach, Fn fn) const {
+		int x0, x1, y0, y1, z0, z1;
+		range(center.x, reach, x0, x1);
+		range(center.y, reach, y0, y1);
+		range(center.z, reach, z0, z1);
+		for (int z = z0; z <= z1; ++z)
+			for (int y = y0; y <= y1; ++y)
+				for (int x = x0; x <= x1; ++x)
+					for (int e = heads[bucket(x, y, z)]; e >= 0; e = entries[e].next)
+						if (fn(entries[e].planet)) return true;
+		return false;
+	}
+};
+
+float wrappedDistance(const glm::vec3& a, const glm::vec3& b) {
+	glm::vec3 delta = a - b;
+	return glm::length(glm::vec3(wrapFloat(delta.x, WORLD_SIZE), wrapFloat(delta.y, WORLD_SIZE),
+								 wrapFloat(delta.z, WORLD_SIZE)));
+}
+
+std::vector<Planet> placePlanets(int count, float minDistance, int textureCount, float radiusScale) {
+	std::vector<Planet> planets;
+	planets.reserve(count);
+
+	// Candidates are still drawn one by one from rand() exactly like before, so a seed gives the same field as
+	// it always did; only the overlap test went from every accepted planet to the few sharing hash cells.
+	// (Bridson's active list would grow partial fields as one blob around the first planet.)
+	// Planets are drawn wrapped around the camera wherever it goes, so the separation holds on the torus:
+	// positions are wrapped into the world cube once and compared with wrappedDistance().
+	std::vector<glm::vec3> wrapped;
+	wrapped.reserve(count);
+	PlanetHash hash(std::max(minDistance + 12.0f * radiusScale, 0.5f), static_cast<size_t>(count));
+
+	const int MAX_FAILED_IN_A_ROW = 64;	// the field is full, the remaining planets would only burn attempts
+	int failedInARow = 0;
+
+	for (int i = 0; i < count && failedInARow < MAX_FAILED_IN_A_ROW; ++i) {
+		Planet p;
+		bool valid = false;
+		int attempts = 0;
+		const int MAX_ATTEMPTS = 1000;  // Add safety limit if it reaches more than 1000 attempts to get a valid planet
+		glm::vec3 pWrapped;
+
+		while (!valid && attempts < MAX_ATTEMPTS) {
+			attempts++;
+			// randomly placed planets need to respect minimal distances between other already created planets
+			p.position = randomInSphere(PLANET_FIELD_RADIUS);
+			pWrapped = p.position;
+			wrapPosition(pWrapped, WORLD_SIZE);
+			float t = float(rand()) / RAND_MAX;   // [0,1]
+
+			// like the universe, I decided to make small planets common, big ones rare
+			float scaleType = float(rand()) / RAND_MAX;
+			if (scaleType < 0.7f) {
+				// Small planets/asteroids have very high change (70% chance)
+				p.radius = (1.0f + t * 5.0f) * radiusScale;  // 1-6 units
+			} else if (scaleType < 0.95f) {
+				// Medium planets (25% chance)
+				p.radius = (8.0f + t * 8.0f) * radiusScale;  // 8-16 units
+			} else {
+				// Gas giants (5% chance)
+				p.radius = (20.0f + t * 15.0f) * radiusScale;  // 20-35 units
+			}
+			p.textureIndex = static_cast<int>((float(rand()) / RAND_MAX) * textureCount);
+			// random rotation axis
+			p.rotationAxis = glm::normalize(randomInSphere(1.0f));
+			// random angular speed (slow)
+			p.rotationSpeed = 0.1f + (float(rand()) / RAND_MAX) * 0.3f;
+			// initial angle
+			p.rotationAngle = (float(rand()) / RAND_MAX) * glm::two_pi<float>();
+			p.modelMatrix = glm::mat4(1.0f);
+			valid = !hash.anyNear(pWrapped, p.radius + minDistance, [&](int other) {
+				float minDist = p.radius + planets[other].radius + minDistance;
+				return wrappedDistance(pWrapped, wrapped[other]) < minDist;
+			});
+		}
+		if (valid) {  // Only add if it found valid position
+			hash.insert(static_cast<int>(planets.size()), pWrapped, p.radius);
+			planets.push_back(p);
+			wrapped.push_back(pWrapped);
+			failedInARow = 0;
+		} else {
+			failedInARow++;
+		}
+	}
+	return planets;
+}
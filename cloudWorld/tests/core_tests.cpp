@@ -0,0 +1,383 @@
+// cloudWorld_core_tests: invariants of the cloudworld_core kernels and of the asset caches, no GL context needed.
+//
+//   cloudWorld_core_tests [scratch dir]
+//
+// Runs from cloudWorld/ (ctest sets the working directory) so the bot model resolves like it does for the
+// renderer. The cache round trips write into the scratch dir (default core_tests_cache), created if missing.
+// Prints every failed check and exits with 1 if there was one.
+
+#include "../include/culling.h"
+#include "../include/mesh.h"
+#include "../include/model_cache.h"
+#include "../include/sort_keys.h"
+#include "../include/texture_cache.h"
+#include "../include/world.h"
+
+#include <stb/stb_image_write.h>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static int checks = 0;
+static int failures = 0;
+
+static bool check(bool ok, const std::string& what) {
+	++checks;
+	if (!ok) {
+		std::printf("FAIL %s\n", what.c_str());
+		++failures;
+	}
+	return ok;
+}
+
+static float randomFloat(float low, float high) {
+	return low + (high - low) * (float(std::rand()) / RAND_MAX);
+}
+
+// the SIMD paths against the scalar reference, with counts that leave partial 4 and 8 wide batches
+static void testCulling() {
+	std::srand(7);
+	for (size_t count : {0, 1, 3, 7, 8, 9, 31, 1000, 4099}) {
+		BoundingSpheres spheres;
+		spheres.resize(count);
+		for (size_t i = 0; i < count; ++i)
+			spheres.set(i, randomInSphere(PLANET_FIELD_RADIUS), randomFloat(0.1f, 35.0f));
+
+		for (int view = 0; view < 8; ++view) {
+			glm::vec3 eye = randomInSphere(100.0f);
+			glm::mat4 viewMatrix = glm::lookAt(eye, eye + glm::normalize(randomInSphere(1.0f) + glm::vec3(0.0f, 0.0f, 1e-3f)),
+											   glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 projection = glm::perspective(glm::radians(randomFloat(30.0f, 90.0f)), randomFloat(0.5f, 2.0f),
+													0.1f, randomFloat(50.0f, 400.0f));
+			Frustum frustum = Frustum::fromMatrix(projection * viewMatrix);
+
+			std::vector<uint32_t> simd, scalar;
+			size_t simdCount = cullSpheres(frustum, spheres, simd);
+			size_t scalarCount = cullSpheresScalar(frustum, spheres, scalar);
+			std::string name = std::string("cullSpheres (") + cullingPath() + ") count=" + std::to_string(count) +
+							   " view=" + std::to_string(view);
+			if (!check(simdCount == scalarCount, name + ": visible count differs from cullSpheresScalar"))
+				continue;
+			simd.resize(simdCount);
+			scalar.resize(scalarCount);
+			check(simd == scalar, name + ": visible spheres differ from cullSpheresScalar");
+			size_t contained = 0;
+			for (size_t i = 0; i < count; ++i)
+				contained += frustum.contains(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+			check(contained == scalarCount, name + ": Frustum::contains disagrees");
+		}
+	}
+}
+
+// sorted, and equal keys keep their submission order (the render queue relies on both)
+static void testRadixSort() {
+	std::srand(11);
+	std::vector<uint32_t> order, scratch;
+	for (size_t count : {0, 1, 2, 100, 5000}) {
+		// few distinct keys so there are plenty of ties, spread over every byte, and some bytes shared by all
+		for (uint64_t mask : {0x00000000000000FFull, 0xF0F0F0F0F0F0F0F0ull, 0xFF00000000000003ull}) {
+			std::vector<uint64_t> keys(count);
+			for (uint64_t& key : keys) {
+				key = 0;
+				for (int i = 0; i < 4; ++i)
+					key = (key << 16) ^ uint64_t(std::rand());
+				key = (key & mask) | 0x0000100000000000ull;
+			}
+			radixSortKeys(keys, order, scratch);
+
+			std::string name = "radixSortKeys count=" + std::to_string(count);
+			if (!check(order.size() == count, name + ": order has the wrong size"))
+				continue;
+			std::vector<bool> seen(count, false);
+			bool permutation = true;
+			for (uint32_t index : order) {
+				if (index >= count || seen[index])
+					permutation = false;
+				else
+					seen[index] = true;
+			}
+			if (!check(permutation, name + ": order is not a permutation"))
+				continue;
+			bool sorted = true;
+			bool stable = true;
+			for (size_t i = 1; i < count; ++i) {
+				if (keys[order[i - 1]] > keys[order[i]])
+					sorted = false;
+				else if (keys[order[i - 1]] == keys[order[i]] && order[i - 1] > order[i])
+					stable = false;
+			}
+			check(sorted, name + ": keys out of order");
+			check(stable, name + ": equal keys changed their order");
+		}
+	}
+}
+
+// no two planets closer than their radii plus the separation, the short way around the world torus
+static void testPlacement() {
+	const struct { int count; float minDistance; float radiusScale; unsigned seed; } fields[] = {
+		{20, 40.0f, 1.0f, 1337}, {20, 40.0f, 1.0f, 42}, {100, 20.0f, 1.0f, 42}, {500, 6.0f, 1.0f, 1337}, {2000, 1.0f, 1.0f, 1337},
+		{2000, 1.0f, 1.0f, 7}, {10000, 1.0f, 0.2f, 1337}
+	};
+	for (const auto& field : fields) {
+		std::srand(field.seed);
+		std::vector<Planet> planets = placePlanets(field.count, field.minDistance, 20, field.radiusScale);
+		std::string name = "placePlanets count=" + std::to_string(field.count) + " seed=" + std::to_string(field.seed);
+		check(!planets.empty() && planets.size() <= size_t(field.count), name + ": placed " +
+			  std::to_string(planets.size()) + " planets");
+		int tooClose = 0;
+		for (size_t i = 0; i < planets.size(); ++i)
+			for (size_t j = i + 1; j < planets.size(); ++j)
+				if (wrappedDistance(planets[i].position, planets[j].position) <
+					planets[i].radius + planets[j].radius + field.minDistance)
+					++tooClose;
+		check(tooClose == 0, name + ": " + std::to_string(tooClose) + " pairs closer than the separation");
+	}
+
+	// the default scene (SceneConfig::numPlanets and minPlanetDistance) has room for all of its planets
+	for (unsigned seed : {42u, 1337u}) {
+		std::srand(seed);
+		check(placePlanets(20, 40.0f, 20).size() == 20, "placePlanets default scene seed=" + std::to_string(seed) +
+			  ": planets dropped");
+	}
+
+	// the wrapped distance is the same from either side of a face of the world cube
+	glm::vec3 a(WORLD_SIZE * 0.5f - 1.0f, 0.0f, 0.0f), b(-WORLD_SIZE * 0.5f + 1.0f, 0.0f, 0.0f);
+	check(std::abs(wrappedDistance(a, b) - 2.0f) < 1e-3f, "wrappedDistance across a face of the world cube");
+	check(std::abs(wrappedDistance(a, b + glm::vec3(WORLD_SIZE * 3.0f, 0.0f, 0.0f)) - 2.0f) < 1e-3f,
+		  "wrappedDistance of a point several periods away");
+}
+
+// snorm16 octahedral normals come back within a fraction of a milliradian
+static void testOctahedral() {
+	std::srand(3);
+	std::vector<glm::vec3> normals = {
+		{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+		glm::normalize(glm::vec3(1, 1, 1)), glm::normalize(glm::vec3(-1, 1, -1)), glm::normalize(glm::vec3(1, -1, -1)),
+		glm::normalize(glm::vec3(-1, -1, -1))
+	};
+	for (int i = 0; i < 100000; ++i)
+		normals.push_back(glm::normalize(randomInSphere(1.0f) + glm::vec3(0.0f, 0.0f, 1e-6f)));
+
+	float worstAngle = 0.0f;
+	for (const glm::vec3& normal : normals) {
+		int16_t packed[2];
+		packOctahedral(normal, packed);
+		// acos of a float dot product cannot resolve angles this small
+		glm::dvec3 n(normal), unpacked(unpackOctahedral(packed));
+		double angle = std::atan2(glm::length(glm::cross(n, unpacked)), glm::dot(n, unpacked));
+		worstAngle = std::max(worstAngle, static_cast<float>(angle));
+	}
+	check(worstAngle < 1e-4f, "octahedral round trip error " + std::to_string(worstAngle) + " rad");
+}
+
+static std::vector<std::array<uint32_t, 3>> sortedTriangles(const std::vector<uint32_t>& indices,
+															 const std::vector<uint32_t>& map) {
+	// rotated so the smallest index comes first, which keeps the winding
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		std::array<uint32_t, 3> t = {map[indices[i]], map[indices[i + 1]], map[indices[i + 2]]};
+		while (t[0] > t[1] || t[0] > t[2])
+			t = {t[1], t[2], t[0]};
+		triangles.push_back(t);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// the cache and fetch optimisations only reorder: same triangles with the same winding, vertices renumbered 1:1
+static void testVertexOptimization() {
+	for (int mesh = 0; mesh < 2; ++mesh) {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		if (mesh == 0)
+			generateIcosphere(3, vertices, indices);
+		else
+			generateSphere(16, 32, vertices, indices);
+		std::string name = mesh == 0 ? "icosphere" : "UV sphere";
+
+		std::vector<uint32_t> identity(vertices.size());
+		for (size_t i = 0; i < identity.size(); ++i)
+			identity[i] = static_cast<uint32_t>(i);
+		std::vector<std::array<uint32_t, 3>> original = sortedTriangles(indices, identity);
+
+		std::vector<uint32_t> optimized = indices;
+		optimizeVertexCache(optimized, vertices.size());
+		check(sortedTriangles(optimized, identity) == original, name + ": optimizeVertexCache changed the triangles");
+		check(vertexCacheAcmr(optimized, vertices.size()) <= vertexCacheAcmr(indices, vertices.size()),
+			  name + ": optimizeVertexCache made the ACMR worse");
+
+		std::vector<uint32_t> fetched = optimized;
+		std::vector<uint32_t> remap = optimizeVertexFetch(fetched, vertices.size());
+		if (!check(remap.size() == vertices.size(), name + ": remap has the wrong size"))
+			continue;
+		std::vector<bool> taken(vertices.size(), false);
+		bool permutation = true;
+		size_t used = 0;
+		for (uint32_t target : remap) {
+			if (target == UINT32_MAX)
+				continue;
+			++used;
+			if (target >= vertices.size() || taken[target])
+				permutation = false;
+			else
+				taken[target] = true;
+		}
+		check(permutation, name + ": remap is not one to one");
+		check(sortedTriangles(optimized, remap) == sortedTriangles(fetched, identity),
+			  name + ": optimizeVertexFetch indices do not follow the remap");
+
+		// first use order: every index is at most one past the largest before it
+		uint32_t next = 0;
+		bool firstUse = true;
+		for (uint32_t index : fetched) {
+			if (index > next)
+				firstUse = false;
+			else if (index == next)
+				++next;
+		}
+		check(firstUse && next == used, name + ": vertices are not numbered in the order of first use");
+
+		std::vector<Vertex> reordered = vertices;
+		remapVertices(reordered, remap);
+		bool same = reordered.size() == used;
+		for (size_t i = 0; same && i < fetched.size(); ++i)
+			same = reordered[fetched[i]].position == vertices[optimized[i]].position;
+		check(same, name + ": remapVertices moved the wrong vertices");
+	}
+}
+
+static void makeDirectory(const std::string& path) {
+#ifdef _WIN32
+	_mkdir(path.c_str());
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+static bool sameLevels(const TextureData& a, const TextureData& b) {
+	if (a.format != b.format || a.width != b.width || a.height != b.height || a.levels.size() != b.levels.size())
+		return false;
+	for (size_t i = 0; i < a.levels.size(); ++i) {
+		const TextureData::Level& x = a.levels[i];
+		const TextureData::Level& y = b.levels[i];
+		if (x.width != y.width || x.height != y.height || x.size != y.size || std::memcmp(x.data, y.data, x.size) != 0)
+			return false;
+	}
+	return true;
+}
+
+// the levels built on a cache miss and the ones mapped from the .cwtex it wrote are the same bytes,
+// and a changed source is rebuilt
+static void testTextureCache(const std::string& scratch) {
+	const int width = 37, height = 20;  // not a power of two, levels round down
+	std::vector<unsigned char> pixels(width * height * 4);
+	for (size_t i = 0; i < pixels.size(); ++i)
+		pixels[i] = static_cast<unsigned char>((i * 7) ^ (i >> 5));
+	std::string source = scratch + "/core_tests.png";
+	if (!check(stbi_write_png(source.c_str(), width, height, 4, pixels.data(), width * 4) != 0,
+			   "cannot write " + source))
+		return;
+
+	for (bool compress : {false, true}) {
+		std::string name = compress ? ".bc1.cwtex" : ".cwtex";
+		std::string cachePath = textureCachePath(source, scratch, compress);
+		std::remove(cachePath.c_str());
+
+		TextureData built;
+		if (!check(loadTexture(source, scratch, compress, built), name + ": cache miss failed"))
+			continue;
+		check(!built.file.data, name + ": a cache was mapped before one was written");
+		check(built.levels.size() == 6 && built.levels.back().width == 1 && built.levels.back().height == 1,
+			  name + ": mip chain does not end at 1x1 after 6 levels");
+		if (!compress)
+			check(built.levels[0].size == pixels.size() &&
+				  std::memcmp(built.levels[0].data, pixels.data(), pixels.size()) == 0, name + ": level 0 is not the image");
+
+		TextureData mapped;
+		if (!check(loadTexture(source, scratch, compress, mapped), name + ": cache hit failed"))
+			continue;
+		check(mapped.file.data != nullptr, name + ": the written cache was not used");
+		check(sameLevels(built, mapped), name + ": mapped levels differ from the built ones");
+	}
+
+	pixels[0] ^= 0xFF;
+	stbi_write_png(source.c_str(), width, height, 4, pixels.data(), width * 4);
+	TextureData rebuilt;
+	if (check(loadTexture(source, scratch, false, rebuilt), ".cwtex: changed source failed to load"))
+		check(!rebuilt.file.data && rebuilt.levels[0].data[0] == pixels[0], ".cwtex: stale cache used for a changed source");
+}
+
+// the bot imported on a cache miss and mapped from the .cwmesh it wrote are the same model
+static void testModelCache(const std::string& scratch) {
+	const std::string source = "../cloudWorld/assets/models/bot/bot.gltf";
+	std::remove(modelCachePath(source, scratch).c_str());
+
+	ModelData imported;
+	if (!check(loadModel(source, scratch, imported), ".cwmesh: importing " + source + " failed"))
+		return;
+	check(!imported.file.data, ".cwmesh: a cache was mapped before one was written");
+	ModelData mapped;
+	if (!check(loadModel(source, scratch, mapped), ".cwmesh: cache hit failed"))
+		return;
+	check(mapped.file.data != nullptr, ".cwmesh: the written cache was not used");
+
+	check(imported.boundsMin == mapped.boundsMin && imported.boundsMax == mapped.boundsMax &&
+		  imported.nodeCount == mapped.nodeCount, ".cwmesh: bounds or node count differ");
+	bool samePrimitives = imported.primitives.size() == mapped.primitives.size();
+	for (size_t i = 0; samePrimitives && i < imported.primitives.size(); ++i) {
+		const ModelData::Primitive& a = imported.primitives[i];
+		const ModelData::Primitive& b = mapped.primitives[i];
+		samePrimitives = a.vertexCount == b.vertexCount && a.indexCount == b.indexCount && a.indexSize == b.indexSize &&
+						 std::memcmp(a.vertices, b.vertices, a.vertexCount * sizeof(PackedSkinnedVertex)) == 0 &&
+						 std::memcmp(a.indices, b.indices, a.indexCount * a.indexSize) == 0;
+	}
+	check(samePrimitives, ".cwmesh: primitives differ");
+	check(imported.skeleton.nodes == mapped.skeleton.nodes && imported.skeleton.parents == mapped.skeleton.parents &&
+		  imported.skeleton.jointEntries == mapped.skeleton.jointEntries &&
+		  imported.inverseBindMatrices == mapped.inverseBindMatrices, ".cwmesh: skeleton differs");
+	bool sameClips = imported.clips.size() == mapped.clips.size();
+	for (size_t i = 0; sameClips && i < imported.clips.size(); ++i) {
+		const AnimationClip& a = imported.clips[i];
+		const AnimationClip& b = mapped.clips[i];
+		sameClips = a.duration == b.duration && a.channels.size() == b.channels.size() && a.times == b.times &&
+					a.values == b.values;
+		for (size_t c = 0; sameClips && c < a.channels.size(); ++c)
+			sameClips = std::memcmp(&a.channels[c], &b.channels[c], sizeof(ClipChannel)) == 0;
+	}
+	check(sameClips, ".cwmesh: animation clips differ");
+}
+
+int main(int argc, char** argv) {
+	if (argc > 2) {
+		std::printf("Usage: %s [scratch dir]\n", argv[0]);
+		return -1;
+	}
+	std::string scratch = argc > 1 ? argv[1] : "core_tests_cache";
+	makeDirectory(scratch);
+
+	testCulling();
+	testRadixSort();
+	testPlacement();
+	testOctahedral();
+	testVertexOptimization();
+	testTextureCache(scratch);
+	testModelCache(scratch);
+
+	std::printf("%d checks, %d failed\n", checks, failures);
+	return failures > 0 ? 1 : 0;
+}